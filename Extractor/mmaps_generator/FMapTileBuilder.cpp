@@ -0,0 +1,165 @@
+/*
+* This file is part of Project SkyFire https://www.projectskyfire.org. 
+* See LICENSE.md file for Copyright information
+*/
+
+#include "FMapTileBuilder.h"
+#include "TerrainBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace MMAP
+{
+    FMapTileBuilder::FMapTileBuilder(int vertexPerMap) :
+        m_vertexPerMap  (vertexPerMap),
+        m_hasData       (false),
+        m_solids        (FMAP_CELL_COUNT)
+    {
+    }
+
+    /**************************************************************************/
+    void FMapTileBuilder::addHeightfield(const rcHeightfield& hf, int borderSize, int firstX, int firstZ)
+    {
+        int coreWidth = hf.width - borderSize * 2;
+        int coreHeight = hf.height - borderSize * 2;
+
+        for (int j = 0; j < coreHeight; ++j)
+        {
+            int hz = firstZ + j;
+            if (hz < 0 || hz >= m_vertexPerMap)
+                continue;
+
+            // FMap cells this heightfield column overlaps: gy runs along recast Z (WoW X)
+            int gyLo = hz * FMAP_GRID_SIZE / m_vertexPerMap;
+            int gyHi = ((hz + 1) * FMAP_GRID_SIZE - 1) / m_vertexPerMap;
+
+            for (int i = 0; i < coreWidth; ++i)
+            {
+                int hx = firstX + i;
+                if (hx < 0 || hx >= m_vertexPerMap)
+                    continue;
+
+                // ... and gx along recast X (WoW Y)
+                int gxLo = hx * FMAP_GRID_SIZE / m_vertexPerMap;
+                int gxHi = ((hx + 1) * FMAP_GRID_SIZE - 1) / m_vertexPerMap;
+
+                for (const rcSpan* s = hf.spans[(i + borderSize) + (j + borderSize) * hf.width]; s; s = s->next)
+                {
+                    float bottom = hf.bmin[1] + s->smin * hf.ch;
+                    float top = hf.bmin[1] + s->smax * hf.ch;
+
+                    for (int gy = gyLo; gy <= gyHi; ++gy)
+                        for (int gx = gxLo; gx <= gxHi; ++gx)
+                            addSolid(gy * FMAP_GRID_SIZE + gx, bottom, top, hf.ch);
+
+                    m_hasData = true;
+                }
+            }
+        }
+    }
+
+    /**************************************************************************/
+    void FMapTileBuilder::addSolid(int cell, float bottom, float top, float mergeGap)
+    {
+        // Gaps thinner than one heightfield voxel are rasterization noise (e.g. between the
+        // spans of neighbouring columns on a slope), not space anything can be in
+        std::vector<Interval>& solids = m_solids[cell];
+
+        size_t first = 0;
+        while (first < solids.size() && solids[first].top + mergeGap < bottom)
+            ++first;
+
+        size_t last = first;
+        while (last < solids.size() && solids[last].bottom - mergeGap <= top)
+        {
+            bottom = std::min(bottom, solids[last].bottom);
+            top = std::max(top, solids[last].top);
+            ++last;
+        }
+
+        Interval merged = { bottom, top };
+        if (first == last)
+            solids.insert(solids.begin() + first, merged);
+        else
+        {
+            solids[first] = merged;
+            solids.erase(solids.begin() + first + 1, solids.begin() + last);
+        }
+    }
+
+    /**************************************************************************/
+    static uint16 quantizeFloor(float z)
+    {
+        // Floors round up and ceilings down, so a layer never claims space that is solid
+        float raw = std::ceil((z + FMAP_HEIGHT_BASE) / FMAP_HEIGHT_PRECISION);
+        return uint16(std::max(0.0f, std::min(65535.0f, raw)));
+    }
+
+    static uint16 quantizeCeiling(float z)
+    {
+        float raw = std::floor((z + FMAP_HEIGHT_BASE) / FMAP_HEIGHT_PRECISION);
+        return uint16(std::max(0.0f, std::min(65535.0f, raw)));
+    }
+
+    /**************************************************************************/
+    bool FMapTileBuilder::writeFile(const char* fileName) const
+    {
+        std::vector<uint32> offsets(FMAP_CELL_COUNT + 1, 0);
+        std::vector<uint16> layers;
+
+        for (int cell = 0; cell < FMAP_CELL_COUNT; ++cell)
+        {
+            const std::vector<Interval>& solids = m_solids[cell];
+
+            if (solids.empty())
+            {
+                // Nothing was rasterized here (terrain hole): open from the lowest height up
+                layers.push_back(0);
+                layers.push_back(0xFFFF);
+            }
+            else
+            {
+                for (size_t k = 0; k < solids.size(); ++k)
+                {
+                    uint16 floorRaw = quantizeFloor(solids[k].top);
+                    uint16 ceilingRaw = (k + 1 < solids.size()) ? quantizeCeiling(solids[k + 1].bottom) : uint16(0xFFFF);
+                    if (ceilingRaw <= floorRaw)
+                        continue;
+
+                    layers.push_back(floorRaw);
+                    layers.push_back(ceilingRaw);
+                }
+            }
+
+            offsets[cell + 1] = uint32(layers.size() / 2);
+        }
+
+        FILE* file = fopen(fileName, "wb");
+        if (!file)
+            return false;
+
+        uint32 cellCount = FMAP_CELL_COUNT;
+        uint32 layerCount = offsets[FMAP_CELL_COUNT];
+        float cellSize = GRID_SIZE / FMAP_GRID_SIZE;
+        uint32 indexOffset = FMAP_HEADER_SIZE;
+        uint32 layersOffset = indexOffset + (FMAP_CELL_COUNT + 1) * sizeof(uint32);
+
+        fwrite("PAMF", 1, 4, file);
+        fwrite(&FMAP_VERSION, sizeof(uint32), 1, file);
+        fwrite(&cellCount, sizeof(uint32), 1, file);
+        fwrite(&layerCount, sizeof(uint32), 1, file);
+        fwrite(&cellSize, sizeof(float), 1, file);
+        fwrite(&cellSize, sizeof(float), 1, file);
+        fwrite(&indexOffset, sizeof(uint32), 1, file);
+        fwrite(&layersOffset, sizeof(uint32), 1, file);
+        fwrite(&offsets[0], sizeof(uint32), offsets.size(), file);
+        if (!layers.empty())
+            fwrite(&layers[0], sizeof(uint16), layers.size(), file);
+
+        bool ok = !ferror(file);
+        fclose(file);
+        return ok;
+    }
+}
@@ -0,0 +1,57 @@
+/*
+* This file is part of Project SkyFire https://www.projectskyfire.org. 
+* See LICENSE.md file for Copyright information
+*/
+
+#ifndef _FMAP_TILE_BUILDER_H
+#define _FMAP_TILE_BUILDER_H
+
+#include <vector>
+
+#include "PathCommon.h"
+#include "Recast.h"
+
+namespace MMAP
+{
+    // .fmtile layout shared with FMapLoader.cpp (v2, see convert_fmtile.py)
+    static const int FMAP_GRID_SIZE = 160;                 // columns per tile side
+    static const int FMAP_CELL_COUNT = FMAP_GRID_SIZE * FMAP_GRID_SIZE;
+    static const float FMAP_HEIGHT_PRECISION = 0.1f;
+    static const float FMAP_HEIGHT_BASE = 2000.0f;
+    static const uint32 FMAP_VERSION = 2;
+    static const uint32 FMAP_HEADER_SIZE = 32;
+
+    // Turns the solid spans of one ADT tile's heightfields into FMap columns: for each
+    // of the 160x160 cells, the free gaps between the solid spans of every heightfield
+    // column it overlaps, plus the open sky above the highest one.
+    // Heightfield columns are 0.2666 (or 0.5333) wide, so one straddling an FMap cell
+    // border counts as solid in both cells.
+    class FMapTileBuilder
+    {
+        public:
+            // vertexPerMap: heightfield columns along one side of the ADT tile
+            FMapTileBuilder(int vertexPerMap);
+
+            // Adds the core (non-border) columns of one sub-tile heightfield whose first
+            // core column is (firstX, firstZ) in tile-wide heightfield columns
+            void addHeightfield(const rcHeightfield& hf, int borderSize, int firstX, int firstZ);
+
+            bool hasData() const { return m_hasData; }
+
+            bool writeFile(const char* fileName) const;
+
+        private:
+            struct Interval
+            {
+                float bottom, top;
+            };
+
+            void addSolid(int cell, float bottom, float top, float mergeGap);
+
+            int m_vertexPerMap;
+            bool m_hasData;
+            std::vector<std::vector<Interval> > m_solids;  // Merged and sorted, per cell (row-major, gy * 160 + gx)
+    };
+}
+
+#endif
@@ -5,6 +5,7 @@
 
 #include "PathCommon.h"
 #include "MapBuilder.h"
+#include "FMapTileBuilder.h"
 
 #include "MapTree.h"
 #include "ModelInstance.h"
@@ -15,6 +16,10 @@
 #include "DisableMgr.h"
 #include <ace/OS_NS_unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 #ifndef STATIC_POLY_BITS
 #define STATIC_POLY_BITS 31  // Allows up to 2048 polygons per tile
 #endif
@@ -29,6 +34,10 @@ namespace DisableMgr
 #define MMAP_MAGIC 0x4d4d4150   // 'MMAP'
 #define MMAP_VERSION 5.2f
 
+// .mmpack layout, shared with MmapPackFile/MmapTileIndex in the bot's Pathfinding2.h
+#define MMPACK_VERSION 1
+#define MMPACK_ALIGNMENT 16     // Detour tile data starts on this boundary
+
 struct MmapTileHeader
 {
     uint32 mmapMagic;
@@ -45,7 +54,7 @@ namespace MMAP
 {
     MapBuilder::MapBuilder(float maxWalkableAngle, bool skipLiquid,
         bool skipContinents, bool skipJunkMaps, bool skipBattlegrounds,
-        bool debugOutput, bool bigBaseUnit, const char* offMeshFilePath) :
+        bool debugOutput, bool bigBaseUnit, const char* offMeshFilePath, bool fmapOutput, bool packOutput) :
         m_terrainBuilder     (NULL),
         m_debugOutput        (debugOutput),
         m_offMeshFilePath    (offMeshFilePath),
@@ -54,6 +63,8 @@ namespace MMAP
         m_skipBattlegrounds  (skipBattlegrounds),
         m_maxWalkableAngle   (maxWalkableAngle),
         m_bigBaseUnit        (bigBaseUnit),
+        m_fmapOutput         (fmapOutput),
+        m_packOutput         (packOutput),
         m_rcContext          (NULL)
     {
         m_terrainBuilder = new TerrainBuilder(skipLiquid);
@@ -300,10 +311,13 @@ namespace MMAP
 
         buildTile(mapID, tileX, tileY, navMesh);
         dtFreeNavMesh(navMesh);
+
+        if (m_packOutput)
+            buildMapPack(mapID);
     }
 
     /**************************************************************************/
-    void MapBuilder::buildMap(uint32 mapID)
+    void MapBuilder::buildMap(uint32 mapID, unsigned int tileThreads)
     {
         printf("[Thread %u] Building map %04u:\n", uint32(ACE_Thread::self()), mapID);
 
@@ -334,6 +348,7 @@ namespace MMAP
             }
             // now start building mmtiles for each tile
             printf("[Map %04i] We have %u tiles. \n", mapID, (unsigned int)tiles->size());
+            std::vector<uint32> pending;
             for (std::set<uint32>::iterator it = tiles->begin(); it != tiles->end(); ++it)
             {
                 uint32 tileX, tileY;
@@ -344,10 +359,39 @@ namespace MMAP
                 if (shouldSkipTile(mapID, tileX, tileY))
                     continue;
 
-                buildTile(mapID, tileX, tileY, navMesh);
+                pending.push_back(*it);
+            }
+
+            // each worker takes the next tile until none are left
+            std::atomic<size_t> next(0);
+            auto buildPending = [&]()
+            {
+                size_t i;
+                while ((i = next++) < pending.size())
+                {
+                    uint32 tileX, tileY;
+                    StaticMapTree::unpackTileID(pending[i], tileX, tileY);
+                    buildTile(mapID, tileX, tileY, navMesh);
+                }
+            };
+
+            unsigned int workerCount = std::min<size_t>(tileThreads, pending.size());
+            if (workerCount > 1)
+            {
+                printf("[Map %04i] Using %u threads to build tiles\n", mapID, workerCount);
+                std::vector<std::thread> workers;
+                for (unsigned int i = 0; i < workerCount; ++i)
+                    workers.push_back(std::thread(buildPending));
+                for (size_t i = 0; i < workers.size(); ++i)
+                    workers[i].join();
             }
+            else
+                buildPending();
 
             dtFreeNavMesh(navMesh);
+
+            if (m_packOutput)
+                buildMapPack(mapID);
         }
 
         printf("[Map %04u] Complete!\n", mapID);
@@ -579,6 +623,9 @@ namespace MMAP
         // allocate subregions : tiles
         Tile* tiles = new Tile[TILES_PER_MAP * TILES_PER_MAP];
 
+        // flight map columns, filled from each tile heightfield before liquids go in
+        FMapTileBuilder fmap(VERTEX_PER_MAP);
+
         // Initialize per tile config.
         rcConfig tileCfg = config;
         tileCfg.width = config.tileSize + config.borderSize*2;
@@ -637,6 +684,9 @@ namespace MMAP
                 rcFilterLedgeSpans(m_rcContext, tileCfg.walkableHeight, tileCfg.walkableClimb, *tile.solid);
                 rcFilterWalkableLowHeightSpans(m_rcContext, tileCfg.walkableHeight, *tile.solid);
 
+                if (m_fmapOutput)
+                    fmap.addHeightfield(*tile.solid, tileCfg.borderSize, x * config.tileSize, y * config.tileSize);
+
                 rcRasterizeTriangles(m_rcContext, lVerts, lVertCount, lTris, lTriFlags, lTriCount, *tile.solid, config.walkableClimb);
 
                 // compact heightfield spans
@@ -707,6 +757,20 @@ namespace MMAP
             }
         }
 
+        if (m_fmapOutput && fmap.hasData())
+        {
+            char fileName[255];
+            snprintf(fileName, sizeof(fileName), "fmaps/%04u_%02i_%02i.fmtile", mapID, tileY, tileX);
+            if (fmap.writeFile(fileName))
+                printf("%s Wrote %s\n", tileString, fileName);
+            else
+            {
+                char message[1024];
+                snprintf(message, sizeof(message), "[Map %04u] Failed to write %s!\n", mapID, fileName);
+                perror(message);
+            }
+        }
+
         iv.polyMesh = rcAllocPolyMesh();
         if (!iv.polyMesh)
         {
@@ -823,6 +887,9 @@ namespace MMAP
             printf("%s Tile coords: tileX=%d, tileY=%d (from params)\n",
                 tileString, params.tileX, params.tileY);
 
+            // held until the tile is written and removed again (leaving this block)
+            std::lock_guard<std::mutex> navMeshGuard(m_navMeshLock);
+
             dtTileRef tileRef = 0;
             printf("%s Adding tile to navmesh...\n", tileString);
 
@@ -1050,10 +1117,139 @@ namespace MMAP
         }
     }
 
+    /**************************************************************************/
+    void MapBuilder::buildMapPack(uint32 mapID)
+    {
+        struct PackedTile
+        {
+            int x, y, layer;
+            uint32 size;        // MmapTileHeader + tile data
+            uint32 offset;      // of the MmapTileHeader in the pack
+            std::string fileName;
+
+            bool operator<(const PackedTile& other) const
+            {
+                if (x != other.x) return x < other.x;
+                if (y != other.y) return y < other.y;
+                return layer < other.layer;
+            }
+        };
+
+        // pack whatever is on disk, so tiles skipped as up to date go in too
+        char filter[32];
+        snprintf(filter, sizeof(filter), "%04u_*.mmtile", mapID);
+        std::vector<std::string> files;
+        getDirContents(files, "mmaps", filter);
+
+        std::vector<PackedTile> tiles;
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            std::string fileName = "mmaps/" + files[i];
+            FILE* file = fopen(fileName.c_str(), "rb");
+            if (!file)
+                continue;
+
+            MmapTileHeader header;
+            dtMeshHeader meshHeader;
+            bool valid = fread(&header, sizeof(MmapTileHeader), 1, file) == 1 &&
+                fread(&meshHeader, sizeof(dtMeshHeader), 1, file) == 1;
+            fclose(file);
+
+            if (!valid || header.mmapMagic != MMAP_MAGIC || header.dtVersion != uint32(DT_NAVMESH_VERSION) ||
+                header.mmapVersion != MMAP_VERSION || header.size < sizeof(dtMeshHeader))
+            {
+                printf("[Map %04u] Not packing %s: stale or broken tile\n", mapID, fileName.c_str());
+                continue;
+            }
+
+            PackedTile tile = { meshHeader.x, meshHeader.y, meshHeader.layer, uint32(sizeof(MmapTileHeader) + header.size), 0, fileName };
+            tiles.push_back(tile);
+        }
+
+        if (tiles.empty())
+            return;
+
+        std::sort(tiles.begin(), tiles.end());
+
+        // header, directory, then the tiles, each placed so its data (after the
+        // MmapTileHeader) is aligned for the runtime to hand straight to Detour
+        uint32 tileCount = uint32(tiles.size());
+        uint32 directoryOffset = 16;
+        uint32 offset = directoryOffset + tileCount * 16;
+        for (size_t i = 0; i < tiles.size(); ++i)
+        {
+            uint32 dataOffset = (offset + uint32(sizeof(MmapTileHeader)) + MMPACK_ALIGNMENT - 1) & ~uint32(MMPACK_ALIGNMENT - 1);
+            tiles[i].offset = dataOffset - uint32(sizeof(MmapTileHeader));
+            offset = tiles[i].offset + tiles[i].size;
+        }
+
+        char packName[255];
+        snprintf(packName, sizeof(packName), "mmaps/%04u.mmpack", mapID);
+        FILE* pack = fopen(packName, "wb");
+        if (!pack)
+        {
+            char message[1024];
+            snprintf(message, sizeof(message), "[Map %04u] Failed to open %s for writing!\n", mapID, packName);
+            perror(message);
+            return;
+        }
+
+        uint32 version = MMPACK_VERSION;
+        fwrite("MPAK", 1, 4, pack);
+        fwrite(&version, sizeof(uint32), 1, pack);
+        fwrite(&tileCount, sizeof(uint32), 1, pack);
+        fwrite(&directoryOffset, sizeof(uint32), 1, pack);
+
+        for (size_t i = 0; i < tiles.size(); ++i)
+        {
+            int32 record[4] = { tiles[i].x, tiles[i].y, tiles[i].layer, int32(tiles[i].offset) };
+            fwrite(record, sizeof(int32), 4, pack);
+        }
+
+        std::vector<unsigned char> buffer;
+        bool ok = true;
+        for (size_t i = 0; i < tiles.size() && ok; ++i)
+        {
+            long position = ftell(pack);
+            buffer.assign(tiles[i].offset - position, 0);
+            if (!buffer.empty())
+                fwrite(&buffer[0], 1, buffer.size(), pack);
+
+            buffer.resize(tiles[i].size);
+            FILE* file = fopen(tiles[i].fileName.c_str(), "rb");
+            ok = file && fread(&buffer[0], 1, buffer.size(), file) == buffer.size();
+            if (file)
+                fclose(file);
+            if (ok)
+                fwrite(&buffer[0], 1, buffer.size(), pack);
+        }
+
+        ok = ok && !ferror(pack);
+        fclose(pack);
+        if (!ok)
+        {
+            printf("[Map %04u] Failed writing %s, removing it\n", mapID, packName);
+            remove(packName);
+            return;
+        }
+
+        printf("[Map %04u] Packed %u tiles into %s\n", mapID, tileCount, packName);
+    }
+
     /**************************************************************************/
     bool MapBuilder::shouldSkipTile(uint32 mapID, uint32 tileX, uint32 tileY)
     {
         char fileName[255];
+        if (m_fmapOutput)
+        {
+            // the flight map comes out of the same pass, so a missing one means a rebuild
+            snprintf(fileName, sizeof(fileName), "fmaps/%04u_%02i_%02i.fmtile", mapID, tileY, tileX);
+            FILE* fmapFile = fopen(fileName, "rb");
+            if (!fmapFile)
+                return false;
+            fclose(fmapFile);
+        }
+
         snprintf(fileName, sizeof(fileName), "mmaps/%04u_%02i_%02i.mmtile", mapID, tileY, tileX);
         FILE* file = fopen(fileName, "rb");
         if (!file)
@@ -9,6 +9,7 @@
 #include <vector>
 #include <set>
 #include <map>
+#include <mutex>
 
 #include "TerrainBuilder.h"
 #include "IntermediateValues.h"
@@ -55,12 +56,15 @@ namespace MMAP
                 bool skipBattlegrounds   = false,
                 bool debugOutput         = false,
                 bool bigBaseUnit         = false,
-                const char* offMeshFilePath = NULL);
+                const char* offMeshFilePath = NULL,
+                bool fmapOutput          = false,
+                bool packOutput          = false);
 
             ~MapBuilder();
 
             // builds all mmap tiles for the specified map id (ignores skip settings)
-            void buildMap(uint32 mapID);
+            // tileThreads > 1 builds that many tiles at once
+            void buildMap(uint32 mapID, unsigned int tileThreads = 0);
             void buildMeshFromFile(char* name);
 
             // builds an mmap tile for the specified map and its mesh
@@ -96,6 +100,9 @@ namespace MMAP
             bool isTransportMap(uint32 mapID);
             bool shouldSkipTile(uint32 mapID, uint32 tileX, uint32 tileY);
 
+            // packs every mmaps/MMMM_*.mmtile of the map into mmaps/MMMM.mmpack
+            void buildMapPack(uint32 mapID);
+
             TerrainBuilder* m_terrainBuilder;
             TileList m_tiles;
 
@@ -109,6 +116,15 @@ namespace MMAP
             float m_maxWalkableAngle;
             bool m_bigBaseUnit;
 
+            // also write fmaps/*.fmtile from the same heightfields
+            bool m_fmapOutput;
+
+            // also write mmaps/*.mmpack once a map's tiles are built
+            bool m_packOutput;
+
+            // navMesh is shared by the tiles of a map that build in parallel
+            std::mutex m_navMeshLock;
+
             // build performance - not really used for now
             rcContext* m_rcContext;
     };
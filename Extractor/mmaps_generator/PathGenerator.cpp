@@ -11,7 +11,7 @@
 
 using namespace MMAP;
 
-bool checkDirectories(bool debugOutput)
+bool checkDirectories(bool debugOutput, bool fmapOutput)
 {
     std::vector<std::string> dirFiles;
 
@@ -35,6 +35,16 @@ bool checkDirectories(bool debugOutput)
         return false;
     }
 
+    dirFiles.clear();
+    if (fmapOutput)
+    {
+        if (getDirContents(dirFiles, "fmaps") == LISTFILE_DIRECTORY_NOT_FOUND)
+        {
+            printf("'fmaps' directory does not exist\n");
+            return false;
+        }
+    }
+
     dirFiles.clear();
     if (debugOutput)
     {
@@ -60,6 +70,8 @@ bool handleArgs(int argc, char** argv,
                bool &debugOutput,
                bool &silent,
                bool &bigBaseUnit,
+               bool &fmapOutput,
+               bool &packOutput,
                char* &offMeshInputPath,
                char* &file,
                unsigned int& threads)
@@ -197,6 +209,32 @@ bool handleArgs(int argc, char** argv,
             else
                 printf("invalid option for '--bigBaseUnit', using default false\n");
         }
+        else if (strcmp(argv[i], "--fmaps") == 0)
+        {
+            param = argv[++i];
+            if (!param)
+                return false;
+
+            if (strcmp(param, "true") == 0)
+                fmapOutput = true;
+            else if (strcmp(param, "false") == 0)
+                fmapOutput = false;
+            else
+                printf("invalid option for '--fmaps', using default false\n");
+        }
+        else if (strcmp(argv[i], "--mmpack") == 0)
+        {
+            param = argv[++i];
+            if (!param)
+                return false;
+
+            if (strcmp(param, "true") == 0)
+                packOutput = true;
+            else if (strcmp(param, "false") == 0)
+                packOutput = false;
+            else
+                printf("invalid option for '--mmpack', using default false\n");
+        }
         else if (strcmp(argv[i], "--offMeshInput") == 0)
         {
             param = argv[++i];
@@ -240,14 +278,16 @@ int main(int argc, char** argv)
          skipBattlegrounds = false,
          debugOutput = false,
          silent = false,
-         bigBaseUnit = false;
+         bigBaseUnit = false,
+         fmapOutput = false,
+         packOutput = false;
     char* offMeshInputPath = NULL;
     char* file = NULL;
 
     bool validParam = handleArgs(argc, argv, mapnum,
                                  tileX, tileY, maxAngle,
                                  skipLiquid, skipContinents, skipJunkMaps, skipBattlegrounds,
-                                 debugOutput, silent, bigBaseUnit, offMeshInputPath, file, threads);
+                                 debugOutput, silent, bigBaseUnit, fmapOutput, packOutput, offMeshInputPath, file, threads);
 
     if (!validParam)
         return silent ? -1 : finish("You have specified invalid parameters", -1);
@@ -264,11 +304,11 @@ int main(int argc, char** argv)
             return 0;
     }
 
-    if (!checkDirectories(debugOutput))
+    if (!checkDirectories(debugOutput, fmapOutput))
         return silent ? -3 : finish("Press ENTER to close...", -3);
 
     MapBuilder builder(maxAngle, skipLiquid, skipContinents, skipJunkMaps,
-                       skipBattlegrounds, debugOutput, bigBaseUnit, offMeshInputPath);
+                       skipBattlegrounds, debugOutput, bigBaseUnit, offMeshInputPath, fmapOutput, packOutput);
 
     uint32 start = getMSTime();
     if (file)
@@ -276,7 +316,7 @@ int main(int argc, char** argv)
     else if (tileX > -1 && tileY > -1 && mapnum >= 0)
         builder.buildSingleTile(mapnum, tileX, tileY);
     else if (mapnum >= 0)
-        builder.buildMap(uint32(mapnum));
+        builder.buildMap(uint32(mapnum), threads);
     else
         builder.buildAllMaps(threads);
 
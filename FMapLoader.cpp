@@ -1,9 +1,27 @@
 ﻿// FMapLoader.cpp
     // Voxel-based Flight Map Loader - Compact Vertical Heightfield
     // Grid: 160x160 cells, Row-Major ordering, 0.1 height precision
+    //
+    // On-disk formats (both start with magic "PAMF", version at offset 4):
+    //   v1: 24-byte header, then per cell (row-major) a uint8 layer count
+    //       followed by that many (uint16 floor, uint16 ceiling) pairs.
+    //   v2: 32-byte header, uint32 offset index (cells + 1 entries), then the
+    //       packed layer array. Mapped read-only and queried in place.
+    //       Use convert_fmtile.py to produce v2 tiles from v1.
 
 #define _CRT_SECURE_NO_WARNINGS
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #include <cstdio>
+#include <cstdint>
 #include <vector>
 #include <map>
 #include <string>
@@ -11,28 +29,56 @@
 #include <fstream>
 #include <iomanip>
 #include <chrono>
+#include <random>
+#include <thread>
 #include <cstring>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <unordered_map>
+#include <algorithm>
+
+#include "TileResidency.h"
 
 // --- CONFIGURATION ---
 const int FMAP_GRID_WIDTH = 160;
 const int FMAP_GRID_HEIGHT = 160;
 const int FMAP_TOTAL_CELLS = 25600;  // 160x160
 const float FMAP_CELL_SIZE = 3.33333f;  // Game units per cell
+const float FMAP_TILE_SIZE = 533.33333f;  // Game units per tile (160 cells)
 const float FMAP_HEIGHT_PRECISION = 0.1f;  // Quantization scale
 const float FMAP_HEIGHT_BASE = 2000.0f;   // Base height that data is stored at
 const float FMAP_AGENT_HEIGHT = 2.0f;     // Agent collision height
 const float FMAP_HEIGHT_RANGE = 5.0f;  // Range within which a height value is valid
 const bool DEBUG_FMAP = false;
 
+// --- CLEARANCE FIELD ---
+const float FMAP_CLEARANCE_QUANTUM = 0.125f;  // Yards per field step (int8)
+const float FMAP_CLEARANCE_MAX = 127 * FMAP_CLEARANCE_QUANTUM;  // Saturation distance (15.875)
+const float FMAP_CLEARANCE_SLAB = 1.0f;       // Vertical voxel size
+const int FMAP_CLEARANCE_MARGIN = 5;          // Neighbour-tile columns within FMAP_CLEARANCE_MAX
+
+// --- HEIGHT PYRAMID ---
+const int FMAP_PYRAMID_LEVELS = 6;  // 160, 80, 40, 20, 10, 5 blocks per side
+const int FMAP_PYRAMID_COLUMN_LEVEL = 3;  // Failing 8x8 blocks walk their columns directly
+
+// --- FILE FORMAT ---
+const uint32_t FMAP_VERSION_V2 = 2;        // Anything else is parsed as v1
+const size_t FMAP_V1_HEADER_SIZE = 24;
+const size_t FMAP_V2_HEADER_SIZE = 32;
+
 // --- DEBUG LOGGER ---
 class FMapLogger {
 private:
     std::ofstream logFile;
+    std::mutex logMutex;   // Queries run on several threads
     bool enabled;
-    int totalChecks = 0;
-    int totalHits = 0;
-    int totalFloorQueries = 0;
+    std::atomic<int> totalChecks{ 0 };
+    std::atomic<int> totalHits{ 0 };
+    std::atomic<int> totalFloorQueries{ 0 };
 
 public:
     FMapLogger() : enabled(DEBUG_FMAP) {
@@ -63,17 +109,19 @@ public:
 
     void Log(const std::string& msg) {
         if (enabled && logFile.is_open()) {
+            std::lock_guard<std::mutex> lock(logMutex);
             logFile << "[FMAP] " << msg << std::endl;
             logFile.flush();
         }
     }
 
     void LogCheck(int mapId, float x1, float y1, float z1, float x2, float y2, float z2, bool hit) {
-        totalChecks++;
+        int checkNo = ++totalChecks;
         if (hit) totalHits++;
 
-        if ((enabled && logFile.is_open() && (totalChecks % 50 == 1))) {
-            logFile << "[LOS#" << totalChecks << "] Map=" << mapId << " | ";
+        if ((enabled && logFile.is_open() && (checkNo % 50 == 1))) {
+            std::lock_guard<std::mutex> lock(logMutex);
+            logFile << "[LOS#" << checkNo << "] Map=" << mapId << " | ";
             logFile << std::fixed << std::setprecision(2);
             logFile << "(" << x1 << "," << y1 << "," << z1 << ")->(" << x2 << "," << y2 << "," << z2 << ") | ";
             float dist = std::sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1) + (z2 - z1) * (z2 - z1));
@@ -83,9 +131,10 @@ public:
     }
 
     void LogFloorQuery(float x, float y, float z, float result) {
-        totalFloorQueries++;
+        int queryNo = ++totalFloorQueries;
         if (enabled && logFile.is_open()) {
-            logFile << "[FLOOR#" << totalFloorQueries << "] (" << std::fixed << std::setprecision(2)
+            std::lock_guard<std::mutex> lock(logMutex);
+            logFile << "[FLOOR#" << queryNo << "] (" << std::fixed << std::setprecision(2)
                 << x << "," << y << "," << z << ") -> " << result << std::endl;
             logFile.flush();
         }
@@ -93,6 +142,7 @@ public:
 
     void LogTileLoad(const std::string& filename, bool success, int cellsWithData = 0, int totalLayers = 0) {
         if (enabled && logFile.is_open()) {
+            std::lock_guard<std::mutex> lock(logMutex);
             if (success) {
                 logFile << "[TILE] ? " << filename << " | Cells: " << cellsWithData
                     << "/" << FMAP_TOTAL_CELLS << " | Layers: " << totalLayers << std::endl;
@@ -106,6 +156,7 @@ public:
 
     void LogSampleCell(int x, int y, int layerCount, float floor, float ceiling) {
         if (enabled && logFile.is_open()) {
+            std::lock_guard<std::mutex> lock(logMutex);
             logFile << "  Sample[" << x << "," << y << "]: " << layerCount << " layer(s) | ";
             if (layerCount > 0) {
                 logFile << "Floor=" << floor << " Ceiling=" << ceiling;
@@ -153,18 +204,22 @@ struct VoxelLayer {
 };
 
 // --- VOXEL CELL (vertical column at one X,Y) ---
+// Lightweight view into the owning tile's packed layer array (see FMapTile).
 struct VoxelCell {
-    std::vector<VoxelLayer> layers;
+    const VoxelLayer* layers = nullptr;
+    uint32_t layerCount = 0;
 
-    bool isEmpty() const { return layers.empty(); }
+    bool isEmpty() const { return layerCount == 0; }
+    const VoxelLayer* begin() const { return layers; }
+    const VoxelLayer* end() const { return layers + layerCount; }
 
     // Get the floor height at or below a given Z
     float getFloorBelow(float z, bool nearest = false) const {
-        if (layers.empty()) return -99999.0f;
+        if (isEmpty()) return -99999.0f;
 
         float bestFloor = -99999.0f;
 
-        for (const auto& layer : layers) {
+        for (const auto& layer : *this) {
             float floor = layer.getFloorZ();
             float ceiling = layer.getCeilingZ();
 
@@ -188,11 +243,11 @@ struct VoxelCell {
     }
 
     float getCeilingAbove(float z) const {
-        if (layers.empty()) return 99999.0f;
+        if (isEmpty()) return 99999.0f;
 
         float bestCeiling = 99999.0f;
 
-        for (const auto& layer : layers) {
+        for (const auto& layer : *this) {
             float floor = layer.getFloorZ();
             float ceiling = layer.getCeilingZ();
 
@@ -216,9 +271,9 @@ struct VoxelCell {
         // OVERLOADED
         return true;
 
-        if (layers.empty()) return false;
+        if (isEmpty()) return false;
 
-        for (const auto& layer : layers) {
+        for (const auto& layer : *this) {
             float floor = layer.getFloorZ();
             float ceiling = layer.getCeilingZ();
 
@@ -234,11 +289,11 @@ struct VoxelCell {
 
     // Check if clear sky at coord
     bool isClearSky(float z) const {
-        if (layers.empty()) return false;
+        if (isEmpty()) return false;
         /*std::ofstream logFile;
         logFile.open("C:\\SMM\\SMM_Debug.log", std::ios::app);*/
 
-        for (const auto& layer : layers) {
+        for (const auto& layer : *this) {
             float floor = layer.getFloorZ();
             float ceiling = layer.getCeilingZ();
             //logFile << floor << std::endl;
@@ -255,12 +310,12 @@ struct VoxelCell {
 
     // Check if line segment from z1 to z2 is clear
     bool isVerticalClear(float z1, float z2) const {
-        if (layers.empty()) return false;  // Solid
+        if (isEmpty()) return false;  // Solid
 
         float minZ = std::min(z1, z2);
         float maxZ = std::max(z1, z2);
 
-        for (const auto& layer : layers) {
+        for (const auto& layer : *this) {
             float floor = layer.getFloorZ();
             float ceiling = layer.getCeilingZ();
 
@@ -275,6 +330,251 @@ struct VoxelCell {
     }
 };
 
+// --- 2D GRID WALK (Amanatides-Woo) ---
+// Visits, in order, every cell of a uniform grid that the segment p(t) = s + t * d
+// crosses for t in [tStart, tEnd]. Coordinates are in cell units; cells outside
+// [uMin, uMax] x [vMin, vMax] are clamped onto the border.
+struct GridWalk2D {
+    int u, v;               // Current cell
+    float tEnter, tExit;    // Segment parameter range inside the current cell
+
+    GridWalk2D(float su, float sv, float du, float dv, float tStart, float tEnd,
+        int uMin, int uMax, int vMin, int vMax)
+        : tStart(tStart), tEnd(tEnd) {
+        const float inf = std::numeric_limits<float>::infinity();
+
+        u = clampCell(su + du * tStart, uMin, uMax);
+        v = clampCell(sv + dv * tStart, vMin, vMax);
+        stepsU = std::abs(clampCell(su + du * tEnd, uMin, uMax) - u);
+        stepsV = std::abs(clampCell(sv + dv * tEnd, vMin, vMax) - v);
+        stepU = (du > 0.0f) ? 1 : -1;
+        stepV = (dv > 0.0f) ? 1 : -1;
+
+        // Parameter at the next cell boundary on each axis, and per whole cell
+        tDeltaU = (du != 0.0f) ? 1.0f / std::abs(du) : inf;
+        tDeltaV = (dv != 0.0f) ? 1.0f / std::abs(dv) : inf;
+        tMaxU = (du > 0.0f) ? ((u + 1) - su) / du : (du < 0.0f) ? (u - su) / du : inf;
+        tMaxV = (dv > 0.0f) ? ((v + 1) - sv) / dv : (dv < 0.0f) ? (v - sv) / dv : inf;
+
+        tEnter = tStart;
+        tExit = exitParam();
+    }
+
+    // Moves to the next cell; returns false once the last cell has been visited
+    bool next() {
+        if (stepsU == 0 && stepsV == 0) return false;
+
+        if (advanceU()) {
+            u += stepU;
+            tEnter = tMaxU;
+            tMaxU += tDeltaU;
+            --stepsU;
+        }
+        else {
+            v += stepV;
+            tEnter = tMaxV;
+            tMaxV += tDeltaV;
+            --stepsV;
+        }
+        tEnter = std::min(std::max(tEnter, tStart), tEnd);
+        tExit = exitParam();
+        return true;
+    }
+
+private:
+    float tStart, tEnd;
+    float tMaxU, tMaxV, tDeltaU, tDeltaV;
+    int stepU, stepV, stepsU, stepsV;
+
+    static int clampCell(float c, int lo, int hi) {
+        float f = std::floor(c);
+        if (f <= (float)lo) return lo;
+        if (f >= (float)hi) return hi;
+        return (int)f;
+    }
+
+    bool advanceU() const { return stepsV == 0 || (stepsU > 0 && tMaxU < tMaxV); }
+
+    float exitParam() const {
+        if (stepsU == 0 && stepsV == 0) return tEnd;
+        return std::max(std::min(advanceU() ? tMaxU : tMaxV, tEnd), tStart);
+    }
+};
+
+// --- READ-ONLY FILE MAPPING ---
+// Keeps a whole tile file mapped for the lifetime of the owning FMapTile.
+class FMapMappedFile {
+public:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    FMapMappedFile() = default;
+    FMapMappedFile(const FMapMappedFile&) = delete;
+    FMapMappedFile& operator=(const FMapMappedFile&) = delete;
+    ~FMapMappedFile() { close(); }
+
+    bool open(const std::string& filepath) {
+        close();
+#ifdef _WIN32
+        fileHandle = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (fileHandle == INVALID_HANDLE_VALUE) return false;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+            close();
+            return false;
+        }
+
+        mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mappingHandle) {
+            close();
+            return false;
+        }
+
+        data = (const uint8_t*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        if (!data) {
+            close();
+            return false;
+        }
+        size = (size_t)fileSize.QuadPart;
+#else
+        int fd = ::open(filepath.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+
+        void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED) return false;
+
+        data = (const uint8_t*)view;
+        size = (size_t)st.st_size;
+#endif
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (data) UnmapViewOfFile(data);
+        if (mappingHandle) CloseHandle(mappingHandle);
+        if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+        mappingHandle = NULL;
+        fileHandle = INVALID_HANDLE_VALUE;
+#else
+        if (data) munmap((void*)data, size);
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    bool isOpen() const { return data != nullptr; }
+
+private:
+#ifdef _WIN32
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mappingHandle = NULL;
+#endif
+};
+
+// --- CLEARANCE FIELD ---
+// Signed distance from each voxel (one column x FMAP_CLEARANCE_SLAB) to the solid space
+// of the surrounding columns, in FMAP_CLEARANCE_QUANTUM steps:
+//   > 0  voxel is free; every point in it is at least this far from anything solid
+//   = 0  voxel touches both free and solid space
+//   < 0  voxel is solid; every point in it is at least this deep
+// Values are box-to-box distances, so they are lower bounds for any point in the voxel.
+// Each column only stores the slabs between its first and last change; everything
+// below and above is the column's saturated 'below'/'above' value.
+struct FMapClearanceField {
+    float zBase = 0.0f;                   // Bottom of slab 0
+    std::vector<uint32_t> offsets;        // FMAP_TOTAL_CELLS + 1 entries into values
+    std::vector<uint16_t> firstSlab;
+    std::vector<int8_t> below, above;
+    std::vector<int8_t> values;
+
+    int8_t sample(int gx, int gy, float z) const {
+        int col = gy * FMAP_GRID_WIDTH + gx;
+        int s = (int)std::floor((z - zBase) / FMAP_CLEARANCE_SLAB);
+        int first = firstSlab[col];
+        int count = (int)(offsets[col + 1] - offsets[col]);
+
+        if (s < first) return below[col];
+        if (s >= first + count) return above[col];
+        return values[offsets[col] + (s - first)];
+    }
+
+    size_t memoryBytes() const {
+        return sizeof(FMapClearanceField) + offsets.capacity() * sizeof(uint32_t) +
+            firstSlab.capacity() * sizeof(uint16_t) + below.capacity() + above.capacity() + values.capacity();
+    }
+};
+
+// Per-block bounds of the topmost layer of every column, over 1x1, 2x2, ... 32x32 cell
+// blocks. A Z span that lies inside [topFloorMax, topCeilingMin] of a block is inside
+// the top layer of each of its columns, so none of them can block it. Empty columns
+// get an inverted range and never pass.
+struct FMapHeightBounds {
+    uint16_t topFloorMax;
+    uint16_t topCeilingMin;
+};
+
+struct FMapHeightPyramid {
+    std::vector<FMapHeightBounds> levels[FMAP_PYRAMID_LEVELS];  // Row-major, (160 >> level)^2 each
+
+    static int sizeAt(int level) { return FMAP_GRID_WIDTH >> level; }
+
+    const FMapHeightBounds& at(int level, int bu, int bv) const {
+        return levels[level][bv * sizeAt(level) + bu];
+    }
+
+    // Is [zLow, zHigh] inside the top layer of every column in block (bu, bv)?
+    bool spanClear(int level, int bu, int bv, float zLow, float zHigh) const {
+        const FMapHeightBounds& b = at(level, bu, bv);
+        return zLow >= (float)b.topFloorMax * FMAP_HEIGHT_PRECISION - FMAP_HEIGHT_BASE &&
+            zHigh <= (float)b.topCeilingMin * FMAP_HEIGHT_PRECISION - FMAP_HEIGHT_BASE;
+    }
+
+    void build(const uint32_t* cellOffsets, const VoxelLayer* layerData) {
+        std::vector<FMapHeightBounds>& leaves = levels[0];
+        leaves.assign(FMAP_TOTAL_CELLS, FMapHeightBounds{ 0xFFFF, 0 });
+
+        for (int i = 0; i < FMAP_TOTAL_CELLS; ++i) {
+            const VoxelLayer* top = nullptr;
+            for (uint32_t l = cellOffsets[i]; l < cellOffsets[i + 1]; ++l) {
+                if (!top || layerData[l].floorRaw > top->floorRaw) top = &layerData[l];
+            }
+            if (top) leaves[i] = FMapHeightBounds{ top->floorRaw, top->ceilingRaw };
+        }
+
+        for (int level = 1; level < FMAP_PYRAMID_LEVELS; ++level) {
+            int size = sizeAt(level);
+            levels[level].resize((size_t)size * size);
+            for (int bv = 0; bv < size; ++bv) {
+                for (int bu = 0; bu < size; ++bu) {
+                    FMapHeightBounds b{ 0, 0xFFFF };
+                    for (int c = 0; c < 4; ++c) {
+                        const FMapHeightBounds& child = at(level - 1, bu * 2 + (c & 1), bv * 2 + (c >> 1));
+                        b.topFloorMax = (std::max)(b.topFloorMax, child.topFloorMax);
+                        b.topCeilingMin = (std::min)(b.topCeilingMin, child.topCeilingMin);
+                    }
+                    levels[level][bv * size + bu] = b;
+                }
+            }
+        }
+    }
+
+    size_t memoryBytes() const {
+        size_t bytes = sizeof(FMapHeightPyramid);
+        for (const auto& level : levels) bytes += level.capacity() * sizeof(FMapHeightBounds);
+        return bytes;
+    }
+};
+
 // --- FMAP TILE (160x160 grid) ---
 class FMapTile {
 public:
@@ -282,28 +582,50 @@ public:
     int tileX, tileY;
     float originX, originY;  // World coordinates of tile origin
 
-    VoxelCell grid[FMAP_GRID_HEIGHT][FMAP_GRID_WIDTH];  // [Y][X] for row-major
+    // Column data in compressed-sparse-row form. The layers of cell i (row-major,
+    // i = gy * FMAP_GRID_WIDTH + gx) are layerData[cellOffsets[i] .. cellOffsets[i + 1]).
+    // Both point into the mapped file for v2 tiles, or into the owned arrays for v1.
+    const uint32_t* cellOffsets = nullptr;   // FMAP_TOTAL_CELLS + 1 entries
+    const VoxelLayer* layerData = nullptr;
+    uint32_t layerTotal = 0;
+
+    TileResidencyPtr residency;
+    FMapHeightPyramid heights;  // Built on load
+
+    // Built on the prefetch thread by FMapSystem::buildClearance; queries only use it
+    // once clearanceReady is set
+    mutable std::once_flag clearanceOnce;
+    mutable std::unique_ptr<FMapClearanceField> clearance;
+    mutable std::atomic<bool> clearanceReady{ false };
 
     FMapTile() : mapId(0), tileX(0), tileY(0), originX(0), originY(0) {}
+    FMapTile(const FMapTile&) = delete;
+    FMapTile& operator=(const FMapTile&) = delete;
+
+    bool isMapped() const { return mappedFile.isOpen(); }
+
+    // Bytes held for this tile (mapped view or owned arrays), for the residency budget
+    size_t memoryBytes() const {
+        return sizeof(FMapTile) + (FMAP_TOTAL_CELLS + 1) * sizeof(uint32_t) + (size_t)layerTotal * sizeof(VoxelLayer) +
+            heights.memoryBytes();
+    }
 
     bool loadFromFile(const std::string& filepath) {
-        FILE* f = fopen(filepath.c_str(), "rb");
-        if (!f) {
+        if (!mappedFile.open(filepath)) {
             g_Logger.LogTileLoad(filepath, false);
             return false;
         }
 
-        // Read 24-byte header (NOT 32!)
-        char header[24];
-        if (fread(header, 1, 24, f) != 24) {
-            fclose(f);
+        const uint8_t* header = mappedFile.data;
+        if (mappedFile.size < FMAP_V1_HEADER_SIZE) {
+            mappedFile.close();
             g_Logger.LogTileLoad(filepath, false);
             return false;
         }
 
         // Verify magic "PAMF" at offset 0
         if (memcmp(header, "PAMF", 4) != 0) {
-            fclose(f);
+            mappedFile.close();
             g_Logger.Log("Invalid magic signature in " + filepath);
             g_Logger.LogTileLoad(filepath, false);
             return false;
@@ -324,58 +646,16 @@ public:
             g_Logger.Log(msg);
         }
 
-        // Grid data starts at byte 24 (immediately after header)
-
-        // Read grid data - Row-Major: Y outer loop, X inner loop
-        int cellsWithData = 0;
-        int totalLayers = 0;
-
-        for (int y = 0; y < FMAP_GRID_HEIGHT; ++y) {
-            for (int x = 0; x < FMAP_GRID_WIDTH; ++x) {
-                uint8_t layerCount;
-                if (fread(&layerCount, 1, 1, f) != 1) {
-                    fclose(f);
-                    g_Logger.LogTileLoad(filepath, false);
-                    return false;
-                }
-
-                if (layerCount > 0) {
-                    cellsWithData++;
-                    totalLayers += layerCount;
-                }
-
-                // Read each layer
-                for (int i = 0; i < layerCount; ++i) {
-                    VoxelLayer layer;
-
-                    if (fread(&layer.floorRaw, 2, 1, f) != 1) {
-                        fclose(f);
-                        g_Logger.LogTileLoad(filepath, false);
-                        return false;
-                    }
-
-                    if (fread(&layer.ceilingRaw, 2, 1, f) != 1) {
-                        fclose(f);
-                        g_Logger.LogTileLoad(filepath, false);
-                        return false;
-                    }
-
-                    grid[y][x].layers.push_back(layer);
-                }
-
-                // Log first few non-empty cells
-                if (cellsWithData <= 3 && layerCount > 0) {
-                    const VoxelLayer& firstLayer = grid[y][x].layers[0];
-                    g_Logger.LogSampleCell(x, y, layerCount,
-                        firstLayer.getFloorZ(),
-                        firstLayer.getCeilingZ());
-                }
-            }
+        bool ok = (version == FMAP_VERSION_V2) ? bindV2(filepath) : parseV1(filepath);
+        if (!ok) {
+            mappedFile.close();
+            cellOffsets = nullptr;
+            layerData = nullptr;
+            layerTotal = 0;
+            return false;
         }
 
-        fclose(f);
-        g_Logger.LogTileLoad(filepath, true, cellsWithData, totalLayers);
-
+        heights.build(cellOffsets, layerData);
         return true;
     }
 
@@ -409,7 +689,15 @@ public:
         return gx >= 0 && gx < FMAP_GRID_WIDTH && gy >= 0 && gy < FMAP_GRID_HEIGHT;
     }
 
-    const VoxelCell* getCell(float worldX, float worldY) const {
+    // View of the column at grid (gx, gy). Caller guarantees bounds.
+    VoxelCell cellAt(int gx, int gy) const {
+        int idx = gy * FMAP_GRID_WIDTH + gx;
+        uint32_t first = cellOffsets[idx];
+        return VoxelCell{ layerData + first, cellOffsets[idx + 1] - first };
+    }
+
+    // Returns false if the position falls outside this tile
+    bool getCell(float worldX, float worldY, VoxelCell& out) const {
         int gx, gy;
         worldToGrid(worldX, worldY, gx, gy);
 
@@ -426,31 +714,32 @@ public:
             if (DEBUG_FMAP) {
                 g_Logger.Log("  -> OUT OF BOUNDS!");
             }
-            return nullptr;
+            return false;
         }
         // Grid access: same as visualizer
-        return &grid[gy][gx];
+        out = cellAt(gx, gy);
+        return true;
     }
 
     // Get floor height at world position
     float getFloorHeight(float worldX, float worldY, float worldZ, bool nearest = false) const {
-        const VoxelCell* cell = getCell(worldX, worldY);
-        if (!cell) return -99999.0f;
+        VoxelCell cell;
+        if (!getCell(worldX, worldY, cell)) return -99999.0f;
 
-        if (DEBUG_FMAP && !cell->isEmpty()) {
+        if (DEBUG_FMAP && !cell.isEmpty()) {
             char msg[256];
-            sprintf(msg, "  Cell has %d layer(s)", (int)cell->layers.size());
+            sprintf(msg, "  Cell has %d layer(s)", (int)cell.layerCount);
             g_Logger.Log(msg);
 
-            for (size_t i = 0; i < cell->layers.size() && i < 3; ++i) {
+            for (uint32_t i = 0; i < cell.layerCount && i < 3; ++i) {
                 sprintf(msg, "    Layer %d: Floor=%.1f Ceiling=%.1f (raw: %u, %u)",
-                    (int)i, cell->layers[i].getFloorZ(), cell->layers[i].getCeilingZ(),
-                    cell->layers[i].floorRaw, cell->layers[i].ceilingRaw);
+                    (int)i, cell.layers[i].getFloorZ(), cell.layers[i].getCeilingZ(),
+                    cell.layers[i].floorRaw, cell.layers[i].ceilingRaw);
                 g_Logger.Log(msg);
             }
         }
 
-        float result = cell->getFloorBelow(worldZ, nearest);
+        float result = cell.getFloorBelow(worldZ, nearest);
 
         if (DEBUG_FMAP) {
             char msg[128];
@@ -462,23 +751,23 @@ public:
     }
 
     float getCeilingHeight(float worldX, float worldY, float worldZ) const {
-        const VoxelCell* cell = getCell(worldX, worldY);
-        if (!cell) return -99999.0f;
+        VoxelCell cell;
+        if (!getCell(worldX, worldY, cell)) return -99999.0f;
 
-        if (DEBUG_FMAP && !cell->isEmpty()) {
+        if (DEBUG_FMAP && !cell.isEmpty()) {
             char msg[256];
-            sprintf(msg, "  Cell has %d layer(s)", (int)cell->layers.size());
+            sprintf(msg, "  Cell has %d layer(s)", (int)cell.layerCount);
             g_Logger.Log(msg);
 
-            for (size_t i = 0; i < cell->layers.size() && i < 3; ++i) {
+            for (uint32_t i = 0; i < cell.layerCount && i < 3; ++i) {
                 sprintf(msg, "    Layer %d: Floor=%.1f Ceiling=%.1f (raw: %u, %u)",
-                    (int)i, cell->layers[i].getFloorZ(), cell->layers[i].getCeilingZ(),
-                    cell->layers[i].floorRaw, cell->layers[i].ceilingRaw);
+                    (int)i, cell.layers[i].getFloorZ(), cell.layers[i].getCeilingZ(),
+                    cell.layers[i].floorRaw, cell.layers[i].ceilingRaw);
                 g_Logger.Log(msg);
             }
         }
 
-        float result = cell->getCeilingAbove(worldZ);
+        float result = cell.getCeilingAbove(worldZ);
 
         if (DEBUG_FMAP) {
             char msg[128];
@@ -491,16 +780,23 @@ public:
 
     // Check if position is flyable
     bool canFlyAt(float worldX, float worldY, float worldZ) const {
-        const VoxelCell* cell = getCell(worldX, worldY);
-        if (!cell) return false;
-        return cell->canFlyAt(worldZ);
+        VoxelCell cell;
+        if (!getCell(worldX, worldY, cell)) return false;
+        return cell.canFlyAt(worldZ);
     }
 
-    // Check if position has clear sky
+    // Check if position has clear sky. The column's top-layer bounds answer it without
+    // touching the layer data unless the top layer is not open to the sky.
     bool isClearSky(float worldX, float worldY, float worldZ) const {
-        const VoxelCell* cell = getCell(worldX, worldY);
-        if (!cell) return false;
-        return cell->isClearSky(worldZ);
+        int gx, gy;
+        worldToGrid(worldX, worldY, gx, gy);
+        if (!isInBounds(gx, gy)) return false;
+
+        const FMapHeightBounds& top = heights.at(0, gx, gy);
+        float topFloor = (float)top.topFloorMax * FMAP_HEIGHT_PRECISION - FMAP_HEIGHT_BASE;
+        float topCeiling = (float)top.topCeilingMin * FMAP_HEIGHT_PRECISION - FMAP_HEIGHT_BASE;
+        if (topCeiling > 4000.0f && worldZ >= topFloor - 1.5f) return true;
+        return cellAt(gx, gy).isClearSky(worldZ);
     }
 
     bool checkLineOfSight(float x1, float y1, float z1, float x2, float y2, float z2) const {
@@ -520,17 +816,16 @@ public:
             float t = (float)i / (float)steps;
             Vector3 pos = start + (delta * t);
 
-            const VoxelCell* cell = getCell(pos.x, pos.y);
-
-            if (!cell) continue;  // Outside tile
+            VoxelCell cell;
+            if (!getCell(pos.x, pos.y, cell)) continue;  // Outside tile
 
-            if (cell->isEmpty()) {
+            if (cell.isEmpty()) {
                 // Solid geometry - blocked
                 return false;
             }
 
             // Check if our Z height can pass through this cell
-            if (!cell->isVerticalClear(pos.z - FMAP_AGENT_HEIGHT * 0.5f,
+            if (!cell.isVerticalClear(pos.z - FMAP_AGENT_HEIGHT * 0.5f,
                 pos.z + FMAP_AGENT_HEIGHT * 0.5f)) {
                 return false;
             }
@@ -538,44 +833,690 @@ public:
 
         return true;
     }
+
+private:
+    FMapMappedFile mappedFile;
+    std::vector<uint32_t> ownedOffsets;
+    std::vector<VoxelLayer> ownedLayers;
+
+    // v1: unpack the byte-packed columns into owned CSR arrays, then drop the mapping
+    bool parseV1(const std::string& filepath) {
+        // Grid data starts at byte 24 (immediately after header)
+        const uint8_t* body = mappedFile.data + FMAP_V1_HEADER_SIZE;
+        size_t bodySize = mappedFile.size - FMAP_V1_HEADER_SIZE;
+
+        // Every cell costs at least its count byte, so this bounds the layer total
+        ownedOffsets.assign(FMAP_TOTAL_CELLS + 1, 0);
+        ownedLayers.clear();
+        ownedLayers.reserve(bodySize / sizeof(VoxelLayer));
+
+        // Read grid data - Row-Major: Y outer loop, X inner loop
+        int cellsWithData = 0;
+        size_t pos = 0;
+
+        for (int y = 0; y < FMAP_GRID_HEIGHT; ++y) {
+            for (int x = 0; x < FMAP_GRID_WIDTH; ++x) {
+                int idx = y * FMAP_GRID_WIDTH + x;
+
+                if (pos >= bodySize) {
+                    g_Logger.LogTileLoad(filepath, false);
+                    return false;
+                }
+                uint8_t layerCount = body[pos++];
+
+                // Each layer is (uint16 floor, uint16 ceiling), same as VoxelLayer
+                size_t layerBytes = (size_t)layerCount * sizeof(VoxelLayer);
+                if (pos + layerBytes > bodySize) {
+                    g_Logger.LogTileLoad(filepath, false);
+                    return false;
+                }
+
+                if (layerCount > 0) {
+                    cellsWithData++;
+
+                    size_t first = ownedLayers.size();
+                    ownedLayers.resize(first + layerCount);
+                    memcpy(&ownedLayers[first], body + pos, layerBytes);
+                    pos += layerBytes;
+
+                    // Log first few non-empty cells
+                    if (cellsWithData <= 3) {
+                        const VoxelLayer& firstLayer = ownedLayers[first];
+                        g_Logger.LogSampleCell(x, y, layerCount,
+                            firstLayer.getFloorZ(),
+                            firstLayer.getCeilingZ());
+                    }
+                }
+
+                ownedOffsets[idx + 1] = (uint32_t)ownedLayers.size();
+            }
+        }
+
+        mappedFile.close();
+
+        cellOffsets = ownedOffsets.data();
+        layerData = ownedLayers.data();
+        layerTotal = (uint32_t)ownedLayers.size();
+
+        g_Logger.LogTileLoad(filepath, true, cellsWithData, (int)layerTotal);
+        return true;
+    }
+
+    // v2: validate the header and index, then serve queries straight from the mapping
+    //   0  char[4]  magic "PAMF"
+    //   4  uint32   version (2)
+    //   8  uint32   cell count (FMAP_TOTAL_CELLS)
+    //  12  uint32   total layer count
+    //  16  float    cell size X
+    //  20  float    cell size Y
+    //  24  uint32   byte offset of the cell offset index
+    //  28  uint32   byte offset of the layer array
+    bool bindV2(const std::string& filepath) {
+        const uint8_t* base = mappedFile.data;
+        size_t fileSize = mappedFile.size;
+
+        if (fileSize < FMAP_V2_HEADER_SIZE) {
+            g_Logger.LogTileLoad(filepath, false);
+            return false;
+        }
+
+        uint32_t cellCount, layerCount, indexOffset, layersOffset;
+        memcpy(&cellCount, base + 8, 4);
+        memcpy(&layerCount, base + 12, 4);
+        memcpy(&indexOffset, base + 24, 4);
+        memcpy(&layersOffset, base + 28, 4);
+
+        size_t indexBytes = (size_t)(FMAP_TOTAL_CELLS + 1) * sizeof(uint32_t);
+        size_t layerBytes = (size_t)layerCount * sizeof(VoxelLayer);
+
+        if (cellCount != FMAP_TOTAL_CELLS ||
+            indexOffset < FMAP_V2_HEADER_SIZE || indexOffset % alignof(uint32_t) != 0 ||
+            (size_t)indexOffset + indexBytes > fileSize ||
+            layersOffset % alignof(VoxelLayer) != 0 ||
+            (size_t)layersOffset + layerBytes > fileSize) {
+            g_Logger.Log("Invalid v2 header in " + filepath);
+            g_Logger.LogTileLoad(filepath, false);
+            return false;
+        }
+
+        const uint32_t* offsets = (const uint32_t*)(base + indexOffset);
+        const VoxelLayer* layers = (const VoxelLayer*)(base + layersOffset);
+
+        // The index must be monotonic and end exactly at the layer count, otherwise a
+        // bad file could make a column view run off the end of the mapping
+        if (offsets[0] != 0 || offsets[FMAP_TOTAL_CELLS] != layerCount) {
+            g_Logger.Log("Invalid v2 offset index in " + filepath);
+            g_Logger.LogTileLoad(filepath, false);
+            return false;
+        }
+
+        int cellsWithData = 0;
+        for (int i = 0; i < FMAP_TOTAL_CELLS; ++i) {
+            if (offsets[i + 1] < offsets[i]) {
+                g_Logger.Log("Invalid v2 offset index in " + filepath);
+                g_Logger.LogTileLoad(filepath, false);
+                return false;
+            }
+            if (offsets[i + 1] > offsets[i]) {
+                cellsWithData++;
+                if (DEBUG_FMAP && cellsWithData <= 3) {
+                    g_Logger.LogSampleCell(i % FMAP_GRID_WIDTH, i / FMAP_GRID_WIDTH,
+                        (int)(offsets[i + 1] - offsets[i]),
+                        layers[offsets[i]].getFloorZ(),
+                        layers[offsets[i]].getCeilingZ());
+                }
+            }
+        }
+
+        cellOffsets = offsets;
+        layerData = layers;
+        layerTotal = layerCount;
+
+        g_Logger.LogTileLoad(filepath, true, cellsWithData, (int)layerTotal);
+        return true;
+    }
 };
 
 // --- FMAP SYSTEM MANAGER ---
+// Tiles are shared between the table and the queries using them. A tile evicted by
+// CleanupTiles or the residency manager is only freed once the last query holding it
+// lets go.
+typedef std::shared_ptr<FMapTile> FMapTilePtr;
+
 class FMapSystem {
 private:
     std::string basePath;
-    std::map<uint64_t, FMapTile*> loadedTiles;
+
+    // One table entry per tile key. The first thread to ask for a tile loads it under
+    // loadOnce; concurrent askers for the same tile wait on that latch only.
+    struct TileSlot {
+        std::once_flag loadOnce;
+        std::atomic<bool> ready{ false };
+        FMapTilePtr tile;   // Null if the file is missing or invalid
+    };
+
+    // Sharded so readers of different tiles rarely touch the same lock, and loads
+    // never hold a shard lock while reading from disk
+    static const int TILE_SHARDS = 16;
+    struct TileShard {
+        std::shared_mutex mutex;
+        std::unordered_map<uint64_t, std::shared_ptr<TileSlot>> slots;
+    };
+    TileShard shards[TILE_SHARDS];
 
     uint64_t packKey(int mapId, int x, int y) const {
         return ((uint64_t)mapId << 32) | ((uint64_t)x << 16) | (uint64_t)y;
     }
 
-public:
-    FMapTile* getTileAt(int mapId, float x, float y) {
-        // CONFIRMED: Detour/Recast coordinate system
-        // tx derives from WoW Y, ty derives from WoW X
-        int tx = (int)(32 - (y / 533.33333f));  // tx from WoW Y
-        int ty = (int)(32 - (x / 533.33333f));  // ty from WoW X
-
-        uint64_t key = packKey(mapId, tx, ty);
+    TileShard& shardFor(uint64_t key) {
+        return shards[(key ^ (key >> 16) ^ (key >> 32)) % TILE_SHARDS];
+    }
 
-        auto it = loadedTiles.find(key);
-        if (it != loadedTiles.end()) {
-            return it->second;
+    std::shared_ptr<TileSlot> findOrAddSlot(uint64_t key) {
+        TileShard& shard = shardFor(key);
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            auto it = shard.slots.find(key);
+            if (it != shard.slots.end()) return it->second;
         }
 
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        std::shared_ptr<TileSlot>& slot = shard.slots[key];
+        if (!slot) slot = std::make_shared<TileSlot>();
+        return slot;
+    }
+
+    FMapTilePtr loadTile(int mapId, int tx, int ty) {
         // Filename format: MAPID_TY_TX (confirmed from generator)
         char filename[64];
         sprintf(filename, "%04d_%02d_%02d.fmtile", mapId, ty, tx);
 
-        FMapTile* tile = new FMapTile();
+        FMapTilePtr tile = std::make_shared<FMapTile>();
         tile->mapId = mapId;
         tile->tileX = tx;
         tile->tileY = ty;
 
         // Origins (confirmed): originX from ty, originY from tx
-        tile->originX = (31 - ty) * 533.33333f;  // X origin from ty
-        tile->originY = (31 - tx) * 533.33333f;  // Y origin from tx
+        tile->originX = (31 - ty) * FMAP_TILE_SIZE;  // X origin from ty
+        tile->originY = (31 - tx) * FMAP_TILE_SIZE;  // Y origin from tx
+
+        if (DEBUG_FMAP) {
+            char msg[256];
+            sprintf(msg, "  Filename: %s", filename);
+            g_Logger.Log(msg);
+        }
+
+        if (!tile->loadFromFile(basePath + filename)) {
+            return nullptr;
+        }
+
+        if (DEBUG_FMAP) {
+            char msg[256];
+            sprintf(msg, "  Loaded successfully. Origin=(%.2f, %.2f)", tile->originX, tile->originY);
+            g_Logger.Log(msg);
+        }
+        return tile;
+    }
+
+    // Most recently used tiles of one line check or batch, so rays that run close
+    // together pay for one table lookup per tile instead of one per ray
+    struct TileLookup {
+        static const int SLOTS = 4;
+        int tx[SLOTS], ty[SLOTS];
+        FMapTilePtr tile[SLOTS];
+        int used = 0;
+        int next = 0;
+    };
+
+    FMapTile* lookupTile(TileLookup& lookup, int mapId, int tx, int ty) {
+        for (int i = 0; i < lookup.used; ++i) {
+            if (lookup.tx[i] == tx && lookup.ty[i] == ty) return lookup.tile[i].get();
+        }
+
+        FMapTilePtr tile = getTile(mapId, tx, ty);
+        int slot = lookup.next;
+        lookup.next = (lookup.next + 1) % TileLookup::SLOTS;
+        if (lookup.used < TileLookup::SLOTS) lookup.used++;
+        lookup.tx[slot] = tx;
+        lookup.ty[slot] = ty;
+        lookup.tile[slot] = std::move(tile);
+        return lookup.tile[slot].get();
+    }
+
+    // One segment as seen from a tile: world start/delta, and the same in the tile's cell
+    // units (u = gx from WoW Y, v = gy from WoW X; see worldToGrid)
+    struct TileSegment {
+        float x1, y1, z1, dx, dy, dz;
+        float su, sv, du, dv;
+    };
+
+    // Walks the blocks of one pyramid level inside [uMin, uMax] x [vMin, vMax] that the
+    // segment crosses over [tStart, tEnd]. A block whose top-layer bounds contain the
+    // segment's Z span there is skipped whole; otherwise its four children are walked,
+    // down to single columns, which get the exact layer test. Blocks are visited in ray
+    // order, so the first blocking column found is the first one along the segment.
+    bool walkBlocks(const FMapTile& tile, const TileSegment& seg, int level,
+        int uMin, int uMax, int vMin, int vMax, float tStart, float tEnd, float& hitT, bool debug) {
+        float scale = 1.0f / (float)(1 << level);
+        GridWalk2D blocks(seg.su * scale, seg.sv * scale, seg.du * scale, seg.dv * scale,
+            tStart, tEnd, uMin, uMax, vMin, vMax);
+
+        do {
+            float zEnter = seg.z1 + seg.dz * blocks.tEnter;
+            float zExit = seg.z1 + seg.dz * blocks.tExit;
+            float zLow = std::min(zEnter, zExit) - 0.5f;
+            float zHigh = std::max(zEnter, zExit) + 0.5f;
+
+            if (level > 0) {
+                if (tile.heights.spanClear(level, blocks.u, blocks.v, zLow, zHigh)) continue;
+
+                // Small blocks that fail go straight to their columns; another level of
+                // bounds rarely pays for its own walk there
+                int child = (level <= FMAP_PYRAMID_COLUMN_LEVEL) ? 0 : level - 1;
+                int span = 1 << (level - child);
+                if (walkBlocks(tile, seg, child, blocks.u * span, blocks.u * span + span - 1,
+                    blocks.v * span, blocks.v * span + span - 1, blocks.tEnter, blocks.tExit, hitT, debug)) {
+                    return true;
+                }
+                continue;
+            }
+
+            VoxelCell cell = tile.cellAt(blocks.u, blocks.v);
+
+            if (cell.isEmpty()) {
+                if (debug) {
+                    std::ofstream logFile("C:\\SMM\\SMM_FMap_Debug.log", std::ios::app);
+                    logFile << "Line check for: " << seg.x1 << ", " << seg.y1 << ", " << seg.z1 << " to " << seg.x1 + seg.dx << ", " << seg.y1 + seg.dy << ", " << seg.z1 + seg.dz << " cell is empty" << "\n";
+                }
+                hitT = blocks.tEnter;
+                return true;
+            }
+
+            if (!cell.isVerticalClear(zLow, zHigh)) {
+                if (debug) {
+                    float px = seg.x1 + seg.dx * blocks.tEnter, py = seg.y1 + seg.dy * blocks.tEnter;
+                    std::ofstream logFile("C:\\SMM\\SMM_FMap_Debug.log", std::ios::app);
+                    logFile << "Line check for: " << px << ", " << py << ", " << zLow << " to " << px << ", " << py << ", " << zHigh << " not clear" << "\n";
+                }
+                hitT = blocks.tEnter;
+                return true; // Hit Ceiling or Floor
+            }
+        } while (blocks.next());
+
+        return false;
+    }
+
+    // Column walk behind checkLine/checkLines. On BLOCKED, hitT is the segment
+    // parameter where the blocking column is entered.
+    bool walkSegment(int mapId, TileLookup& lookup, float x1, float y1, float z1,
+        float dx, float dy, float dz, float& hitT, bool debug) {
+        const int intMin = std::numeric_limits<int>::min();
+        const int intMax = std::numeric_limits<int>::max();
+        const int topLevel = FMAP_PYRAMID_LEVELS - 1;
+        const int topSize = FMapHeightPyramid::sizeAt(topLevel);
+
+        // Tile blocks: u along WoW Y (tx = 31 - u), v along WoW X (ty = 31 - v)
+        GridWalk2D tiles(y1 / FMAP_TILE_SIZE, x1 / FMAP_TILE_SIZE,
+            dy / FMAP_TILE_SIZE, dx / FMAP_TILE_SIZE,
+            0.0f, 1.0f, intMin, intMax, intMin, intMax);
+
+        do {
+            FMapTile* tile = lookupTile(lookup, mapId, 31 - tiles.u, 31 - tiles.v);
+            if (!tile) continue;
+
+            TileSegment seg{ x1, y1, z1, dx, dy, dz,
+                (y1 - tile->originY) / FMAP_CELL_SIZE, (x1 - tile->originX) / FMAP_CELL_SIZE,
+                dy / FMAP_CELL_SIZE, dx / FMAP_CELL_SIZE };
+
+            if (walkBlocks(*tile, seg, topLevel, 0, topSize - 1, 0, topSize - 1,
+                tiles.tEnter, tiles.tExit, hitT, debug)) {
+                return true;
+            }
+        } while (tiles.next());
+
+        return false;
+    }
+
+    // --- CLEARANCE ---
+    struct ClearanceSpan {
+        float lo, hi;
+    };
+
+    // Free vertical spans of a column, sorted and merged. Open-sky layers are unbounded
+    // above and layers from the lowest storable height (terrain holes) below; an empty
+    // column has none (solid all the way).
+    static void collectFreeSpans(const VoxelCell& cell, std::vector<ClearanceSpan>& out) {
+        const float inf = std::numeric_limits<float>::infinity();
+        out.clear();
+        for (const VoxelLayer& layer : cell) {
+            out.push_back({ layer.floorRaw == 0 ? -inf : layer.getFloorZ(), layer.isOpenSky() ? inf : layer.getCeilingZ() });
+        }
+        std::sort(out.begin(), out.end(), [](const ClearanceSpan& a, const ClearanceSpan& b) { return a.lo < b.lo; });
+
+        size_t merged = 0;
+        for (size_t i = 0; i < out.size(); ++i) {
+            if (merged > 0 && out[i].lo <= out[merged - 1].hi) {
+                out[merged - 1].hi = std::max(out[merged - 1].hi, out[i].hi);
+            }
+            else {
+                out[merged++] = out[i];
+            }
+        }
+        out.resize(merged);
+    }
+
+    // Column (gx, gy) in the cell grid of tile (tx, ty), reaching into the neighbouring
+    // tiles for coordinates outside 0..159. Returns false if that tile has no data.
+    bool columnNear(TileLookup& lookup, int mapId, int tx, int ty, int gx, int gy, VoxelCell& out) {
+        // gx runs along WoW Y and gy along WoW X; both tile indices count the other way
+        if (gx < 0) { gx += FMAP_GRID_WIDTH; tx++; }
+        else if (gx >= FMAP_GRID_WIDTH) { gx -= FMAP_GRID_WIDTH; tx--; }
+        if (gy < 0) { gy += FMAP_GRID_HEIGHT; ty++; }
+        else if (gy >= FMAP_GRID_HEIGHT) { gy -= FMAP_GRID_HEIGHT; ty--; }
+
+        const FMapTile* source = lookupTile(lookup, mapId, tx, ty);
+        if (!source) return false;
+        out = source->cellAt(gx, gy);
+        return true;
+    }
+
+    // Vertical gaps from [z0, z1] to the solid and to the free space of one column
+    static void slabGaps(const std::vector<ClearanceSpan>& spans, bool known, float z0, float z1,
+        float& toSolid, float& toFree) {
+        const float inf = std::numeric_limits<float>::infinity();
+        if (!known) { toSolid = inf; toFree = 0.0f; return; }   // No tile: treated as open, like checkLine
+
+        toSolid = 0.0f;
+        toFree = inf;
+        for (const ClearanceSpan& span : spans) {
+            if (span.lo <= z0 && z1 <= span.hi) {
+                toSolid = std::min(z0 - span.lo, span.hi - z1);
+                toFree = 0.0f;
+                return;
+            }
+            if (span.lo < z1 && span.hi > z0) toFree = 0.0f;    // Partly free
+            else toFree = std::min(toFree, std::max(span.lo - z1, z0 - span.hi));
+        }
+    }
+
+    // Squared horizontal gap between two columns k cells apart
+    static float columnGapSq(int k) {
+        float gap = (float)std::max(std::abs(k) - 1, 0) * FMAP_CELL_SIZE;
+        return gap * gap;
+    }
+
+    static int8_t quantizeClearance(float toSolid, float toFree) {
+        if (toSolid > 0.0f) return (int8_t)(int)(std::min(toSolid, FMAP_CLEARANCE_MAX) / FMAP_CLEARANCE_QUANTUM);
+        if (toFree > 0.0f) return (int8_t)-(int)(std::min(toFree, FMAP_CLEARANCE_MAX) / FMAP_CLEARANCE_QUANTUM);
+        return 0;
+    }
+
+    // A range of slabs, empty when first > last
+    struct SlabWindow {
+        int first = 0, last = -1;
+
+        bool empty() const { return first > last; }
+        void add(const SlabWindow& other) {
+            if (other.empty()) return;
+            if (empty()) { *this = other; return; }
+            first = std::min(first, other.first);
+            last = std::max(last, other.last);
+        }
+    };
+
+    // Builds the clearance field of one tile. Columns of the neighbouring tiles within
+    // FMAP_CLEARANCE_MARGIN are taken into account. Per slab, the vertical gaps of every
+    // column are combined with the horizontal gaps in two separable passes (rows, then
+    // columns), each a min over the 2 * FMAP_CLEARANCE_MARGIN + 1 cells in reach.
+    // A cell only changes within FMAP_CLEARANCE_MAX of the finite span boundaries in its
+    // reach, so each one is only worked out over that window of slabs; the open ends of
+    // terrain holes and open sky add none. A cell with no boundary in reach is the same
+    // at every height and is worked out once.
+    std::unique_ptr<FMapClearanceField> buildClearanceField(const FMapTile& tile) {
+        const int margin = FMAP_CLEARANCE_MARGIN;
+        const int width = FMAP_GRID_WIDTH + 2 * margin;
+        const int height = FMAP_GRID_HEIGHT + 2 * margin;
+        const int pad = (int)std::ceil(FMAP_CLEARANCE_MAX / FMAP_CLEARANCE_SLAB) + 1;
+        const float inf = std::numeric_limits<float>::infinity();
+
+        // 1. Free spans of every column in reach, and the lowest and highest finite boundary of each
+        TileLookup lookup;
+        std::vector<std::vector<ClearanceSpan>> spans(width * height);
+        std::vector<uint8_t> known(width * height, 0);
+        std::vector<float> boundLow(width * height, inf), boundHigh(width * height, -inf);
+        float zLow = inf;
+
+        for (int py = 0; py < height; ++py) {
+            for (int px = 0; px < width; ++px) {
+                int i = py * width + px;
+                VoxelCell cell;
+                if (!columnNear(lookup, tile.mapId, tile.tileX, tile.tileY, px - margin, py - margin, cell)) continue;
+
+                known[i] = 1;
+                collectFreeSpans(cell, spans[i]);
+                for (const ClearanceSpan& span : spans[i]) {
+                    for (float z : { span.lo, span.hi }) {
+                        if (z == inf || z == -inf) continue;
+                        boundLow[i] = std::min(boundLow[i], z);
+                        boundHigh[i] = std::max(boundHigh[i], z);
+                    }
+                }
+                zLow = std::min(zLow, boundLow[i]);
+            }
+        }
+
+        auto field = std::make_unique<FMapClearanceField>();
+        if (zLow == inf) zLow = 0.0f;
+        field->zBase = std::floor(zLow) - pad * FMAP_CLEARANCE_SLAB;
+
+        // 2. Slab windows. A cell needs the slabs within FMAP_CLEARANCE_MAX of the boundaries
+        // in its reach (beyond them it is saturated, so the window's end slabs stand for all
+        // below and above); a row-pass entry needs what the cells reading it need, and a
+        // column what the row-pass entries reading it need.
+        std::vector<SlabWindow> boundWin(width * height);
+        for (int i = 0; i < width * height; ++i) {
+            if (boundLow[i] > boundHigh[i]) continue;
+            boundWin[i].first = (int)std::floor((boundLow[i] - field->zBase) / FMAP_CLEARANCE_SLAB) - pad;
+            boundWin[i].last = (int)std::floor((boundHigh[i] - field->zBase) / FMAP_CLEARANCE_SLAB) + pad;
+        }
+
+        std::vector<SlabWindow> rowReach(width * height), cellWin(FMAP_TOTAL_CELLS);
+        for (int py = 0; py < height; ++py) {
+            for (int px = margin; px < margin + FMAP_GRID_WIDTH; ++px) {
+                for (int k = -margin; k <= margin; ++k) rowReach[py * width + px].add(boundWin[py * width + px + k]);
+            }
+        }
+        for (int gy = 0; gy < FMAP_GRID_HEIGHT; ++gy) {
+            for (int gx = 0; gx < FMAP_GRID_WIDTH; ++gx) {
+                for (int k = -margin; k <= margin; ++k) {
+                    cellWin[gy * FMAP_GRID_WIDTH + gx].add(rowReach[(gy + margin + k) * width + gx + margin]);
+                }
+            }
+        }
+
+        std::vector<SlabWindow> rowWin(width * height), columnWin(width * height);
+        for (int gy = 0; gy < FMAP_GRID_HEIGHT; ++gy) {
+            for (int gx = 0; gx < FMAP_GRID_WIDTH; ++gx) {
+                for (int k = -margin; k <= margin; ++k) {
+                    rowWin[(gy + margin + k) * width + gx + margin].add(cellWin[gy * FMAP_GRID_WIDTH + gx]);
+                }
+            }
+        }
+        for (int py = 0; py < height; ++py) {
+            for (int px = margin; px < margin + FMAP_GRID_WIDTH; ++px) {
+                for (int k = -margin; k <= margin; ++k) columnWin[py * width + px + k].add(rowWin[py * width + px]);
+            }
+        }
+
+        int slabs = 1;
+        std::vector<uint32_t> cellOffset(FMAP_TOTAL_CELLS + 1, 0);
+        for (int col = 0; col < FMAP_TOTAL_CELLS; ++col) {
+            const SlabWindow& win = cellWin[col];
+            if (!win.empty()) slabs = std::max(slabs, win.last + 1);
+            cellOffset[col + 1] = cellOffset[col] + (win.empty() ? 1 : (uint32_t)(win.last - win.first + 1));
+        }
+
+        // Cells with no boundary in reach: one direct evaluation at any height
+        std::vector<int8_t> dense(cellOffset[FMAP_TOTAL_CELLS]);
+        for (int gy = 0; gy < FMAP_GRID_HEIGHT; ++gy) {
+            for (int gx = 0; gx < FMAP_GRID_WIDTH; ++gx) {
+                int col = gy * FMAP_GRID_WIDTH + gx;
+                if (!cellWin[col].empty()) continue;
+
+                float bestSolid = inf, bestFree = inf;
+                for (int ky = -margin; ky <= margin; ++ky) {
+                    for (int kx = -margin; kx <= margin; ++kx) {
+                        int j = (gy + margin + ky) * width + gx + margin + kx;
+                        float toSolid, toFree;
+                        slabGaps(spans[j], known[j] != 0, field->zBase, field->zBase + FMAP_CLEARANCE_SLAB, toSolid, toFree);
+                        toSolid = std::min(toSolid, FMAP_CLEARANCE_MAX + 1.0f);
+                        toFree = std::min(toFree, FMAP_CLEARANCE_MAX + 1.0f);
+                        float g = columnGapSq(kx) + columnGapSq(ky);
+                        bestSolid = std::min(bestSolid, g + toSolid * toSolid);
+                        bestFree = std::min(bestFree, g + toFree * toFree);
+                    }
+                }
+                dense[cellOffset[col]] = quantizeClearance(std::sqrt(bestSolid), std::sqrt(bestFree));
+            }
+        }
+
+        // 3. Distance transform, one slab at a time over the entries whose window holds it
+        std::vector<std::vector<int>> columnsFrom(slabs), rowsFrom(slabs), cellsFrom(slabs);
+        for (int i = 0; i < width * height; ++i) {
+            if (!columnWin[i].empty()) columnsFrom[columnWin[i].first].push_back(i);
+            if (!rowWin[i].empty()) rowsFrom[rowWin[i].first].push_back(i);
+        }
+        for (int col = 0; col < FMAP_TOTAL_CELLS; ++col) {
+            if (!cellWin[col].empty()) cellsFrom[cellWin[col].first].push_back(col);
+        }
+        auto advance = [](std::vector<int>& active, const std::vector<int>& starting,
+            const std::vector<SlabWindow>& windows, int s) {
+            active.erase(std::remove_if(active.begin(), active.end(),
+                [&](int i) { return windows[i].last < s; }), active.end());
+            active.insert(active.end(), starting.begin(), starting.end());
+        };
+
+        std::vector<int> columns, rows, cells;
+        std::vector<float> solidSq(width * height), freeSq(width * height);
+        std::vector<float> rowSolid(width * height), rowFree(width * height);
+
+        for (int s = 0; s < slabs; ++s) {
+            float z0 = field->zBase + s * FMAP_CLEARANCE_SLAB;
+            float z1 = z0 + FMAP_CLEARANCE_SLAB;
+            advance(columns, columnsFrom[s], columnWin, s);
+            advance(rows, rowsFrom[s], rowWin, s);
+            advance(cells, cellsFrom[s], cellWin, s);
+
+            for (int i : columns) {
+                float toSolid, toFree;
+                slabGaps(spans[i], known[i] != 0, z0, z1, toSolid, toFree);
+                toSolid = std::min(toSolid, FMAP_CLEARANCE_MAX + 1.0f);
+                toFree = std::min(toFree, FMAP_CLEARANCE_MAX + 1.0f);
+                solidSq[i] = toSolid * toSolid;
+                freeSq[i] = toFree * toFree;
+            }
+
+            // Rows (along gx), for the tile's own gx only
+            for (int i : rows) {
+                float bestSolid = inf, bestFree = inf;
+                for (int k = -margin; k <= margin; ++k) {
+                    float g = columnGapSq(k);
+                    bestSolid = std::min(bestSolid, g + solidSq[i + k]);
+                    bestFree = std::min(bestFree, g + freeSq[i + k]);
+                }
+                rowSolid[i] = bestSolid;
+                rowFree[i] = bestFree;
+            }
+
+            // Columns (along gy), for the tile's own cells
+            for (int col : cells) {
+                int gx = col % FMAP_GRID_WIDTH, gy = col / FMAP_GRID_WIDTH;
+                float bestSolid = inf, bestFree = inf;
+                for (int k = -margin; k <= margin; ++k) {
+                    int j = (gy + margin + k) * width + gx + margin;
+                    float g = columnGapSq(k);
+                    bestSolid = std::min(bestSolid, g + rowSolid[j]);
+                    bestFree = std::min(bestFree, g + rowFree[j]);
+                }
+                dense[cellOffset[col] + (s - cellWin[col].first)] =
+                    quantizeClearance(std::sqrt(bestSolid), std::sqrt(bestFree));
+            }
+        }
+
+        // 4. Keep each column's slabs between its first and last change
+        field->offsets.assign(FMAP_TOTAL_CELLS + 1, 0);
+        field->firstSlab.resize(FMAP_TOTAL_CELLS);
+        field->below.resize(FMAP_TOTAL_CELLS);
+        field->above.resize(FMAP_TOTAL_CELLS);
+
+        for (int col = 0; col < FMAP_TOTAL_CELLS; ++col) {
+            const int8_t* v = &dense[cellOffset[col]];
+            int count = (int)(cellOffset[col + 1] - cellOffset[col]);
+            int8_t below = v[0], above = v[count - 1];
+
+            int first = 0;
+            while (first < count && v[first] == below) ++first;
+            int last = count - 1;
+            while (last >= 0 && v[last] == above) --last;
+
+            field->firstSlab[col] = (uint16_t)((cellWin[col].empty() ? 0 : cellWin[col].first) + first);
+            field->below[col] = below;
+            field->above[col] = above;
+            for (int s = first; s <= last; ++s) field->values.push_back(v[s]);
+            field->offsets[col + 1] = (uint32_t)field->values.size();
+        }
+        field->values.shrink_to_fit();
+
+        if (DEBUG_FMAP) {
+            char msg[256];
+            sprintf(msg, "Clearance field tile[%d,%d]: %d slabs from %.1f, %zu bytes",
+                tile.tileX, tile.tileY, slabs, field->zBase, field->memoryBytes());
+            g_Logger.Log(msg);
+        }
+        return field;
+    }
+
+    // Exact distance from a point to the solid space of the columns around it, up to
+    // maxDist (at most FMAP_CLEARANCE_MAX). Used where the field can't decide; works on
+    // points outside any tile too, which can still be near the edge of a neighbour.
+    float exactClearance(int mapId, float x, float y, float z, float maxDist) {
+        int tx = (int)(32 - (y / FMAP_TILE_SIZE));
+        int ty = (int)(32 - (x / FMAP_TILE_SIZE));
+        float localX = y - (31 - tx) * FMAP_TILE_SIZE, localY = x - (31 - ty) * FMAP_TILE_SIZE;
+        int gx = std::min(std::max((int)(localX / FMAP_CELL_SIZE), 0), FMAP_GRID_WIDTH - 1);
+        int gy = std::min(std::max((int)(localY / FMAP_CELL_SIZE), 0), FMAP_GRID_HEIGHT - 1);
+        float fx = localX - gx * FMAP_CELL_SIZE, fy = localY - gy * FMAP_CELL_SIZE; // Offset inside the cell
+
+        int reach = (int)std::ceil(maxDist / FMAP_CELL_SIZE) + 1;
+        TileLookup lookup;
+        std::vector<ClearanceSpan> spans;
+        float best = maxDist;
+
+        for (int a = -reach; a <= reach; ++a) {
+            float dx = a > 0 ? a * FMAP_CELL_SIZE - fx : (a < 0 ? fx + (-a - 1) * FMAP_CELL_SIZE : 0.0f);
+            for (int b = -reach; b <= reach; ++b) {
+                float dy = b > 0 ? b * FMAP_CELL_SIZE - fy : (b < 0 ? fy + (-b - 1) * FMAP_CELL_SIZE : 0.0f);
+                float horizSq = dx * dx + dy * dy;
+                if (horizSq >= best * best) continue;
+
+                VoxelCell cell;
+                if (!columnNear(lookup, mapId, tx, ty, gx + a, gy + b, cell)) continue;
+                collectFreeSpans(cell, spans);
+
+                float toSolid, toFree;
+                slabGaps(spans, true, z, z, toSolid, toFree);
+                best = std::min(best, std::sqrt(horizSq + toSolid * toSolid));
+            }
+        }
+        return best;
+    }
+
+public:
+    FMapTilePtr getTileAt(int mapId, float x, float y) {
+        // CONFIRMED: Detour/Recast coordinate system
+        // tx derives from WoW Y, ty derives from WoW X
+        int tx = (int)(32 - (y / FMAP_TILE_SIZE));  // tx from WoW Y
+        int ty = (int)(32 - (x / FMAP_TILE_SIZE));  // ty from WoW X
 
         if (DEBUG_FMAP) {
             char msg[256];
@@ -583,24 +1524,49 @@ public:
             g_Logger.Log(msg);
             sprintf(msg, "  Calculated: tx=%d (from y), ty=%d (from x)", tx, ty);
             g_Logger.Log(msg);
-            sprintf(msg, "  Filename: %s", filename);
-            g_Logger.Log(msg);
         }
 
-        if (tile->loadFromFile(basePath + filename)) {
-            if (DEBUG_FMAP) {
-                char msg[256];
-                sprintf(msg, "  Loaded successfully. Origin=(%.2f, %.2f)", tile->originX, tile->originY);
-                g_Logger.Log(msg);
+        return getTile(mapId, tx, ty);
+    }
+
+    // Safe to call from any thread. Loads the tile on first use.
+    FMapTilePtr getTile(int mapId, int tx, int ty) {
+        uint64_t key = packKey(mapId, tx, ty);
+        std::shared_ptr<TileSlot> slot = findOrAddSlot(key);
+
+        bool loaded = false;
+        std::call_once(slot->loadOnce, [&]() {
+            g_TileResidency.RecordMiss(TILE_CACHE_FMAP);
+            slot->tile = loadTile(mapId, tx, ty);
+            if (slot->tile) {
+                slot->tile->residency = g_TileResidency.Add(TILE_CACHE_FMAP, key, mapId,
+                    slot->tile->originX + FMAP_TILE_SIZE * 0.5f, slot->tile->originY + FMAP_TILE_SIZE * 0.5f,
+                    slot->tile->memoryBytes());
             }
-            loadedTiles[key] = tile;
-            return tile;
+            slot->ready = true;
+            loaded = true;
+        });
+
+        if (loaded) {
+            // No shard lock is held here, so our evictor is free to take one
+            if (slot->tile) g_TileResidency.Trim(TILE_CACHE_MASK_FMAP, slot->tile->residency);
         }
-        else {
-            delete tile;
-            loadedTiles[key] = nullptr;
-            return nullptr;
+        else if (slot->tile) {
+            g_TileResidency.Touch(slot->tile->residency);
         }
+        return slot->tile;
+    }
+
+    // Residency manager evictor: drops one tile from the table
+    bool evictTile(uint64_t key) {
+        TileShard& shard = shardFor(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+        auto it = shard.slots.find(key);
+        if (it == shard.slots.end()) return true;   // Already gone
+        if (!it->second->ready) return false;       // Being reloaded right now
+        shard.slots.erase(it);
+        return true;
     }
 
     void init(const std::string& path) {
@@ -609,115 +1575,407 @@ public:
             basePath += "/";
         }
         g_Logger.Log("FMap system initialized: " + basePath);
-    }
 
-    ~FMapSystem() {
-        for (auto& pair : loadedTiles) {
-            delete pair.second;
-        }
+        g_TileResidency.SetEvictor(TILE_CACHE_FMAP, [this](uint64_t key) { return evictTile(key); });
     }
 
-    // Cleanup tiles retentionRadius away from player or on a diffrent map
+    // Cleanup tiles retentionRadius away from player or on a diffrent map.
+    // Tiles still held by running queries stay alive until those queries finish.
     void CleanupTiles(int currentMapId, float playerX, float playerY, float retentionRadius) {
-        auto it = loadedTiles.begin();
-        while (it != loadedTiles.end()) {
-            uint64_t key = it->first;
-            FMapTile* tile = it->second;
-
-            // CRITICAL FIX 1: If tile failed to load previously (nullptr), remove it or skip it.
-            // We remove it so we can try loading it again later if needed, or just to clean the map key.
-            if (tile == nullptr) {
-                it = loadedTiles.erase(it);
-                continue;
-            }
+        for (TileShard& shard : shards) {
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+            auto it = shard.slots.begin();
+            while (it != shard.slots.end()) {
+                uint64_t key = it->first;
+                TileSlot& slot = *it->second;
+
+                // Leave tiles that are still being loaded to their loader
+                if (!slot.ready) {
+                    ++it;
+                    continue;
+                }
+
+                // CRITICAL FIX 1: If tile failed to load previously (nullptr), remove it or skip it.
+                // We remove it so we can try loading it again later if needed, or just to clean the map key.
+                if (!slot.tile) {
+                    it = shard.slots.erase(it);
+                    continue;
+                }
 
-            // Extract mapId from key (upper 32 bits)
-            int tileMapId = (int)(key >> 32);
+                // Extract mapId from key (upper 32 bits)
+                int tileMapId = (int)(key >> 32);
 
-            // CRITICAL FIX 2: Correct X/Y mapping. 
-            // originX corresponds to WoW X, originY corresponds to WoW Y.
-            float dist = std::sqrt(std::pow(tile->originX - playerX, 2) + std::pow(tile->originY - playerY, 2));
+                // CRITICAL FIX 2: Correct X/Y mapping.
+                // originX corresponds to WoW X, originY corresponds to WoW Y.
+                const FMapTile& tile = *slot.tile;
+                float dist = std::sqrt(std::pow(tile.originX - playerX, 2) + std::pow(tile.originY - playerY, 2));
 
-            // Unload if different map OR too far away
-            if (tileMapId != currentMapId || dist > retentionRadius) {
-                if (DEBUG_FMAP) {
-                    // Optional logging
-                    // char msg[128];
-                    // sprintf(msg, "Unloading Tile: %04d (Dist: %.2f)", tile->mapId, dist);
-                    // g_Logger.Log(msg);
+                // Unload if different map OR too far away
+                if (tileMapId != currentMapId || dist > retentionRadius) {
+                    g_TileResidency.Remove(TILE_CACHE_FMAP, key);
+                    it = shard.slots.erase(it); // Freed once the last reader drops it
+                }
+                else {
+                    ++it;
                 }
-                delete tile; // Free memory
-                it = loadedTiles.erase(it); // Remove from map
-            }
-            else {
-                ++it;
             }
         }
     }
 
+    // Exact grid walk for line checks. The segment is walked across the tiles it
+    // touches, then across the columns inside each tile using the same cell boundaries
+    // as FMapTile::getCell. Every crossed column is visited once and the Z span the
+    // segment covers inside it (+-0.5) must fit in a single free layer. Whole blocks
+    // of columns the segment passes above are skipped via the tile's height pyramid.
+    // Columns on tiles with no data are skipped. Returns true if BLOCKED.
     bool checkLine(int mapId, float x1, float y1, float z1, float x2, float y2, float z2, bool debug = false) {
+        float dx = x2 - x1, dy = y2 - y1, dz = z2 - z1;
+
+        if (dx * dx + dy * dy + dz * dz < 0.001f * 0.001f) {
+            g_Logger.LogCheck(mapId, x1, y1, z1, x2, y2, z2, false);
+            return false; // Zero length = Clear
+        }
+
+        TileLookup lookup;
+        float hitT;
+        bool blocked = walkSegment(mapId, lookup, x1, y1, z1, dx, dy, dz, hitT, debug);
+
+        g_Logger.LogCheck(mapId, x1, y1, z1, x2, y2, z2, blocked);
+        return blocked;
+    }
+
+    // Batched checkLine over segments given as separate coordinate arrays (SoA).
+    // Bit i of outBlockedMask (32 segments per word) is set if segment i is BLOCKED;
+    // outHitDist[i] receives the distance from the start to the first blocking column,
+    // or -1 if clear. Either output may be null. With stopOnFirstHit the batch ends at
+    // the first blocked segment and later entries are left clear.
+    // Each segment is still walked on its own, one walkSegment after another; the batch
+    // only shares the setup pass and the tile lookups (TileLookup), not the column
+    // reads. Returns the number blocked.
+    int checkLines(int mapId, int count,
+        const float* x1, const float* y1, const float* z1,
+        const float* x2, const float* y2, const float* z2,
+        uint32_t* outBlockedMask, float* outHitDist, bool stopOnFirstHit, bool debug = false) {
+        if (count <= 0) return 0;
+
+        if (outBlockedMask) {
+            memset(outBlockedMask, 0, ((size_t)(count + 31) / 32) * sizeof(uint32_t));
+        }
+
+        // Per-segment setup in one straight pass (vectorizes; no tile access)
+        std::vector<float> dx(count), dy(count), dz(count), lenSq(count);
+        for (int i = 0; i < count; ++i) {
+            dx[i] = x2[i] - x1[i];
+            dy[i] = y2[i] - y1[i];
+            dz[i] = z2[i] - z1[i];
+            lenSq[i] = dx[i] * dx[i] + dy[i] * dy[i] + dz[i] * dz[i];
+        }
+
+        TileLookup lookup;
+        int blockedCount = 0;
+
+        for (int i = 0; i < count; ++i) {
+            float hitT = 1.0f;
+            bool blocked = (lenSq[i] >= 0.001f * 0.001f) &&
+                walkSegment(mapId, lookup, x1[i], y1[i], z1[i], dx[i], dy[i], dz[i], hitT, debug);
+
+            g_Logger.LogCheck(mapId, x1[i], y1[i], z1[i], x2[i], y2[i], z2[i], blocked);
+
+            if (outHitDist) {
+                outHitDist[i] = blocked ? hitT * std::sqrt(lenSq[i]) : -1.0f;
+            }
+
+            if (blocked) {
+                ++blockedCount;
+                if (outBlockedMask) outBlockedMask[i / 32] |= (1u << (i % 32));
+                if (stopOnFirstHit) {
+                    if (outHitDist) {
+                        for (int j = i + 1; j < count; ++j) outHitDist[j] = -1.0f;
+                    }
+                    break;
+                }
+            }
+        }
+
+        return blockedCount;
+    }
+
+    // Previous fixed-step line check (every FMAP_CELL_SIZE * 0.25), kept as the
+    // reference for benchmarkLines. Returns true if BLOCKED.
+    bool checkLineSampled(int mapId, float x1, float y1, float z1, float x2, float y2, float z2) {
         Vector3 start(x1, y1, z1);
         Vector3 end(x2, y2, z2);
         Vector3 delta = end - start;
         float dist = delta.length();
 
-        std::ofstream logFile;
-        if (debug) {
-            logFile.open("C:\\SMM\\SMM_FMap_Debug.log", std::ios::app);
-        }
-
-        if (dist < 0.001f) {
-            g_Logger.LogCheck(mapId, x1, y1, z1, x2, y2, z2, false);
-            return false; // Zero length = Clear
-        }
+        if (dist < 0.001f) return false; // Zero length = Clear
 
         float stepSize = FMAP_CELL_SIZE * 0.25f;
         int steps = (int)((floor)(dist / stepSize)) + 1;
 
         // Cache the last used tile to minimize lookups
-        FMapTile* cachedTile = nullptr;
+        FMapTilePtr cachedTile;
 
         for (int i = 0; i <= steps; ++i) {
             float t = (i == steps) ? 1.0f : ((float)i * stepSize / dist);
             Vector3 pos = start + (delta * t);
 
-            const VoxelCell* cell = nullptr;
+            VoxelCell cell;
+            bool haveCell = false;
             if (cachedTile) {
-                cell = cachedTile->getCell(pos.x, pos.y);
+                haveCell = cachedTile->getCell(pos.x, pos.y, cell);
             }
 
-            if (!cell) {
+            if (!haveCell) {
                 cachedTile = getTileAt(mapId, pos.x, pos.y);
                 if (cachedTile) {
-                    cell = cachedTile->getCell(pos.x, pos.y);
+                    haveCell = cachedTile->getCell(pos.x, pos.y, cell);
                 }
             }
 
-            if (!cell) { continue; }
+            if (!haveCell) { continue; }
 
-            if (cell->isEmpty()) {
-                g_Logger.LogCheck(mapId, x1, y1, z1, x2, y2, z2, true);
-                if ((logFile.is_open()) && debug) {
-                    logFile << "Line check for: " << x1 << ", " << y1 << ", " << z1 << " to " << x2 << ", " << y2 << ", " << z2 << " cell is empty" << "\n";
-                }
-                return true; // BLOCKED
-            }
+            if (cell.isEmpty()) return true; // BLOCKED
 
-            if (!cell->isVerticalClear(pos.z - 0.5f, pos.z + 0.5f)) {
-                g_Logger.LogCheck(mapId, x1, y1, z1, x2, y2, z2, true);
-                if ((logFile.is_open()) && debug) {
-                    logFile << "Line check for: " << pos.x << ", " << pos.y << ", " << pos.z - 0.5f << " to " << pos.x << ", " << pos.y << ", " << pos.z + 0.5f << " not clear" << "\n";
-                }
+            if (!cell.isVerticalClear(pos.z - 0.5f, pos.z + 0.5f)) {
                 return true; // BLOCKED (Hit Ceiling or Floor)
             }
         }
 
-        g_Logger.LogCheck(mapId, x1, y1, z1, x2, y2, z2, false);
         return false; // CLEAR
     }
 
+    // Times checkLine against the old sampler (checkLineSampled) on the tile under (x, y)
+    // with rayCount random segments (2-100 yd, starting 0.5-30 yd above the top floor)
+    // and checks them against each other. The walk covers every column and Z span the
+    // sampler looks at, so it must never report CLEAR where the sampler reports BLOCKED;
+    // the other way round is a thin ceiling the sampler stepped over. Segments stay inside
+    // the tile, as near a border the sampler can read the previous tile's edge column, and
+    // their end points off cell boundaries, where getCell's rounding can put a point in
+    // the next column. The seed is fixed, so runs repeat.
+    // Logs the result; returns the number of segments the walk missed, -1 if there is no tile.
+    int benchmarkLines(int mapId, float x, float y, int rayCount) {
+        FMapTilePtr tile = getTileAt(mapId, x, y);
+        if (!tile || rayCount <= 0) return -1;
+
+        std::mt19937 rng(12345);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        const float inset = 0.01f;
+        auto clampInTile = [&](float v, float origin) {
+            v = std::min(std::max(v, origin + inset), origin + FMAP_TILE_SIZE - inset);
+            float cell = (v - origin) / FMAP_CELL_SIZE;
+            float offset = (cell - std::round(cell)) * FMAP_CELL_SIZE;
+            if (std::fabs(offset) < inset) v += (offset < 0.0f ? -inset : inset);
+            return v;
+        };
+
+        struct Segment { float x1, y1, z1, x2, y2, z2; };
+        std::vector<Segment> segments(rayCount);
+        for (Segment& seg : segments) {
+            seg.x1 = clampInTile(tile->originX + unit(rng) * FMAP_TILE_SIZE, tile->originX);
+            seg.y1 = clampInTile(tile->originY + unit(rng) * FMAP_TILE_SIZE, tile->originY);
+
+            int gx, gy;
+            tile->worldToGrid(seg.x1, seg.y1, gx, gy);
+            gx = std::min(std::max(gx, 0), FMAP_GRID_WIDTH - 1);
+            gy = std::min(std::max(gy, 0), FMAP_GRID_HEIGHT - 1);
+            const FMapHeightBounds& top = tile->heights.at(0, gx, gy);
+            float floorZ = top.topFloorMax <= top.topCeilingMin ?
+                (float)top.topFloorMax * FMAP_HEIGHT_PRECISION - FMAP_HEIGHT_BASE : 0.0f;
+            seg.z1 = floorZ + 0.5f + unit(rng) * 29.5f;
+
+            float yaw = unit(rng) * 6.2831853f, dist = 2.0f + unit(rng) * 98.0f;
+            seg.x2 = clampInTile(seg.x1 + std::cos(yaw) * dist, tile->originX);
+            seg.y2 = clampInTile(seg.y1 + std::sin(yaw) * dist, tile->originY);
+            seg.z2 = seg.z1 + (unit(rng) - 0.5f) * 0.6f * dist;
+        }
+
+        std::vector<char> walkHits(rayCount), sampledHits(rayCount);
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < rayCount; ++r) {
+            const Segment& seg = segments[r];
+            walkHits[r] = checkLine(mapId, seg.x1, seg.y1, seg.z1, seg.x2, seg.y2, seg.z2);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        for (int r = 0; r < rayCount; ++r) {
+            const Segment& seg = segments[r];
+            sampledHits[r] = checkLineSampled(mapId, seg.x1, seg.y1, seg.z1, seg.x2, seg.y2, seg.z2);
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        int hits = 0, missed = 0, extra = 0;
+        for (int r = 0; r < rayCount; ++r) {
+            hits += walkHits[r];
+            if (sampledHits[r] && !walkHits[r]) missed++;
+            if (walkHits[r] && !sampledHits[r]) extra++;
+        }
+
+        double walkUs = std::chrono::duration<double, std::micro>(t1 - t0).count() / rayCount;
+        double sampledUs = std::chrono::duration<double, std::micro>(t2 - t1).count() / rayCount;
+
+        char msg[384];
+        sprintf(msg, "[BENCH] FMap tile[%d,%d]: %d lines, %d blocked | walk %.3f us/line, sampler %.3f us/line (%.1fx) | %d missed, %d only blocked by the walk",
+            tile->tileX, tile->tileY, rayCount, hits, walkUs, sampledUs,
+            walkUs > 0.0 ? sampledUs / walkUs : 0.0, missed, extra);
+        g_Logger.Log(msg);
+        return missed;
+    }
+
+    // Hammers the tile table from 'threads' reader threads, each running 'iterations'
+    // floor-height and line queries around the tile under (x, y), while another thread
+    // keeps dropping every cached tile (CleanupTiles with no retention), so readers race
+    // loads against evictions. Every answer is compared with one worked out up front on
+    // this thread; the seed is fixed. Meant for testing: the cached tiles are gone
+    // afterwards and reload on demand.
+    // Logs the result; returns the number of mismatched answers, -1 if there is no tile.
+    int stressTileCache(int mapId, float x, float y, int threads, int iterations) {
+        FMapTilePtr tile = getTileAt(mapId, x, y);
+        if (!tile || threads <= 0 || iterations <= 0) return -1;
+
+        std::mt19937 rng(12345);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        // Queries over the tile and its eight neighbours
+        struct Query { float x1, y1, z1, x2, y2, z2; float floorZ; bool blocked; };
+        std::vector<Query> queries(iterations);
+        for (Query& q : queries) {
+            q.x1 = tile->originX + (unit(rng) * 3.0f - 1.0f) * FMAP_TILE_SIZE;
+            q.y1 = tile->originY + (unit(rng) * 3.0f - 1.0f) * FMAP_TILE_SIZE;
+            q.z1 = -50.0f + unit(rng) * 200.0f;
+            q.x2 = q.x1 + (unit(rng) - 0.5f) * 60.0f;
+            q.y2 = q.y1 + (unit(rng) - 0.5f) * 60.0f;
+            q.z2 = q.z1 + (unit(rng) - 0.5f) * 10.0f;
+            q.floorZ = getFloorHeight(mapId, q.x1, q.y1, q.z1, true);
+            q.blocked = checkLine(mapId, q.x1, q.y1, q.z1, q.x2, q.y2, q.z2);
+        }
+
+        std::atomic<int> running{ threads };
+        std::atomic<int> mismatches{ 0 };
+        std::atomic<int> cleanups{ 0 };
+
+        auto t0 = std::chrono::steady_clock::now();
+        std::thread cleaner([&]() {
+            while (running > 0) {
+                CleanupTiles(mapId, x, y, -1.0f);
+                cleanups++;
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        });
+
+        std::vector<std::thread> readers;
+        for (int t = 0; t < threads; ++t) {
+            readers.emplace_back([&, t]() {
+                // Each reader starts at a different query so they don't move in lockstep
+                for (int i = 0; i < iterations; ++i) {
+                    const Query& q = queries[(i + t * iterations / threads) % iterations];
+                    if (getFloorHeight(mapId, q.x1, q.y1, q.z1, true) != q.floorZ) mismatches++;
+                    if (checkLine(mapId, q.x1, q.y1, q.z1, q.x2, q.y2, q.z2) != q.blocked) mismatches++;
+                }
+                running--;
+            });
+        }
+        for (std::thread& reader : readers) reader.join();
+        cleaner.join();
+        auto t1 = std::chrono::steady_clock::now();
+
+        char msg[256];
+        sprintf(msg, "[STRESS] FMap tile[%d,%d]: %d threads x %d queries, %d cleanups in %.0f ms | %d mismatches",
+            tile->tileX, tile->tileY, threads, iterations, cleanups.load(),
+            std::chrono::duration<double, std::milli>(t1 - t0).count(), mismatches.load());
+        g_Logger.Log(msg);
+        return mismatches;
+    }
+
+    // Builds the clearance field of a tile if not done yet. Takes the better part of
+    // 100 ms, so only the prefetch thread calls this, never a query.
+    void buildClearance(const FMapTilePtr& tile) {
+        std::call_once(tile->clearanceOnce, [&]() {
+            tile->clearance = buildClearanceField(*tile);
+            g_TileResidency.AddBytes(tile->residency, tile->clearance->memoryBytes());
+            tile->clearanceReady.store(true, std::memory_order_release);
+        });
+    }
+
+    // Clearance field of a tile, or null while the prefetcher hasn't built it
+    const FMapClearanceField* getClearanceField(const FMapTilePtr& tile) {
+        if (!tile->clearanceReady.load(std::memory_order_acquire)) return nullptr;
+        return tile->clearance.get();
+    }
+
+    // Signed clearance at a point from the field (see FMapClearanceField): a lower bound
+    // on the distance to solid space when positive. FMAP_CLEARANCE_MAX where there is no tile.
+    // Until the tile's field is built, the surrounding columns are probed instead.
+    float getClearance(int mapId, float x, float y, float z) {
+        FMapTilePtr tile = getTileAt(mapId, x, y);
+        if (!tile) {
+            // No data here, but a neighbouring tile's edge may be within reach
+            const float reach = FMAP_CLEARANCE_MAX;
+            if (!getTileAt(mapId, x - reach, y - reach) && !getTileAt(mapId, x - reach, y + reach) &&
+                !getTileAt(mapId, x + reach, y - reach) && !getTileAt(mapId, x + reach, y + reach)) {
+                return FMAP_CLEARANCE_MAX;
+            }
+            return exactClearance(mapId, x, y, z, FMAP_CLEARANCE_MAX);
+        }
+
+        const FMapClearanceField* field = getClearanceField(tile);
+        if (!field) return exactClearance(mapId, x, y, z, FMAP_CLEARANCE_MAX);
+        int gx = std::min(std::max((int)((y - tile->originY) / FMAP_CELL_SIZE), 0), FMAP_GRID_WIDTH - 1);
+        int gy = std::min(std::max((int)((x - tile->originX) / FMAP_CELL_SIZE), 0), FMAP_GRID_HEIGHT - 1);
+        return field->sample(gx, gy, z) * FMAP_CLEARANCE_QUANTUM;
+    }
+
+    // Is the sphere of 'radius' around the point free of solid space? One field lookup
+    // in open air; near geometry the surrounding columns are checked exactly.
+    bool isSphereClear(int mapId, float x, float y, float z, float radius) {
+        float clearance = getClearance(mapId, x, y, z);
+        if (clearance >= radius) return true;
+        if (clearance < 0.0f || radius > FMAP_CLEARANCE_MAX) return false;
+        return exactClearance(mapId, x, y, z, radius) >= radius;
+    }
+
+    // Conservative capsule test: sphere-traces the segment through the field and returns
+    // true only if every point is at least 'radius' from solid space. False means "not
+    // proven clear", not necessarily blocked.
+    bool isCapsuleClear(int mapId, float x1, float y1, float z1, float x2, float y2, float z2, float radius) {
+        const float minStep = 0.25f;
+        float dx = x2 - x1, dy = y2 - y1, dz = z2 - z1;
+        float length = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+        float travelled = 0.0f;
+        while (true) {
+            float t = length > 0.0f ? travelled / length : 0.0f;
+            float clearance = getClearance(mapId, x1 + dx * t, y1 + dy * t, z1 + dz * t);
+
+            // Every point within (clearance - radius) of this one is at least radius clear
+            float step = clearance - radius;
+            if (step < 0.0f) return false;
+            travelled += step;
+            if (travelled >= length) return true;
+            if (step < minStep) return false;
+        }
+    }
+
+    // Height bounds of the pyramid block (2^level columns a side) under (x, y): every
+    // column in it is open from floorMax up to ceilingMin. This is the conservative
+    // occupancy the flight planner routes on before refining at full resolution.
+    // False if there is no tile here.
+    bool getBlockBounds(int mapId, int level, float x, float y, float& floorMax, float& ceilingMin) {
+        if (level < 0 || level >= FMAP_PYRAMID_LEVELS) return false;
+        FMapTilePtr tile = getTileAt(mapId, x, y);
+        if (!tile) return false;
+
+        int gx = std::min(std::max((int)((y - tile->originY) / FMAP_CELL_SIZE), 0), FMAP_GRID_WIDTH - 1);
+        int gy = std::min(std::max((int)((x - tile->originX) / FMAP_CELL_SIZE), 0), FMAP_GRID_HEIGHT - 1);
+        const FMapHeightBounds& b = tile->heights.at(level, gx >> level, gy >> level);
+        floorMax = (float)b.topFloorMax * FMAP_HEIGHT_PRECISION - FMAP_HEIGHT_BASE;
+        ceilingMin = (float)b.topCeilingMin * FMAP_HEIGHT_PRECISION - FMAP_HEIGHT_BASE;
+        return true;
+    }
+
     float getFloorHeight(int mapId, float x, float y, float z, bool nearest = false) {
-        FMapTile* tile = getTileAt(mapId, x, y);
+        FMapTilePtr tile = getTileAt(mapId, x, y);
         if (!tile) {
             if (DEBUG_FMAP) {
                 char msg[128];
@@ -740,7 +1998,7 @@ public:
     }
 
     float getCeilingHeight(int mapId, float x, float y, float z) {
-        FMapTile* tile = getTileAt(mapId, x, y);
+        FMapTilePtr tile = getTileAt(mapId, x, y);
         if (!tile) {
             if (DEBUG_FMAP) {
                 char msg[128];
@@ -763,13 +2021,17 @@ public:
     }
 
     bool canFlyAt(int mapId, float x, float y, float z, bool clearSkyCheck = false) {
-        FMapTile* tile = getTileAt(mapId, x, y);
+        FMapTilePtr tile = getTileAt(mapId, x, y);
 
         // 1. Basic Voxel Check (Is the center point in a flyable layer?)
         if (!tile) return false;
         if (clearSkyCheck && tile->isClearSky(x, y, z)) return true;
         if (!tile->canFlyAt(x, y, z)) return false;
 
+        // Both probes below need [z - 1, z + 3] free in this column (checkLine pads 0.5 yards
+        // each way), which a 2-yard sphere around z + 1 already guarantees
+        if (isSphereClear(mapId, x, y, z + 1.0f, 2.0f)) return true;
+
         // 2. Headroom Check (Center to Head + 2.5y)
         // Mimics A* CheckFlightPoint: Ensures we don't hit the ceiling or a hanging object.
         // We use checkLine to sweep the agent's collision box upwards.
@@ -787,7 +2049,7 @@ public:
     }
 
     bool checkSurroundingTiles(int mapId, float x, float y, float z, int tileGridSize, float heightLimit) {
-        FMapTile* tile = getTileAt(mapId, x, y);
+        FMapTilePtr tile = getTileAt(mapId, x, y);
         bool debug = false;
         if (x == -2344.85f) {
             debug = false;
@@ -800,8 +2062,8 @@ public:
         std::vector<std::vector<float>> cellFloor((tileGridSize * 2) + 1, std::vector<float>((tileGridSize * 2) + 1, 0));
         float diagonalHeightLimit = sqrt(2 * heightLimit * heightLimit);
 
-        const VoxelCell* cell = tile->getCell(x, y);
-        if (!cell) return false;
+        VoxelCell cell;
+        if (!tile->getCell(x, y, cell)) return false;
         float nodeFloor = getFloorHeight(mapId, x, y, z, true);
 
         if (debug) {
@@ -920,71 +2182,98 @@ public:
 
 static FMapSystem g_FMapSys;
 
+// Initialized on first use. Function-local statics are initialized exactly once even
+// when several pathfinding threads make their first call at the same time.
+static FMapSystem& FMapSys() {
+    static bool initialized = (g_FMapSys.init("C:/SMM/data/fmaps/"), true);
+    (void)initialized;
+    return g_FMapSys;
+}
+
 // --- EXPORTED C API ---
 extern "C" {
     __declspec(dllexport) bool CheckFMapLine(int mapId, float x1, float y1, float z1,
         float x2, float y2, float z2, bool debug) {
-        static bool initialized = false;
-        if (!initialized) {
-            g_FMapSys.init("C:/SMM/data/fmaps/");
-            initialized = true;
-        }
-        return g_FMapSys.checkLine(mapId, x1, y1, z1, x2, y2, z2, debug);
+        return FMapSys().checkLine(mapId, x1, y1, z1, x2, y2, z2, debug);
+    }
+
+    // Batched CheckFMapLine over SoA segment arrays; see FMapSystem::checkLines
+    __declspec(dllexport) int CheckFMapLines(int mapId, int count,
+        const float* x1, const float* y1, const float* z1,
+        const float* x2, const float* y2, const float* z2,
+        uint32_t* outBlockedMask, float* outHitDist, bool stopOnFirstHit, bool debug) {
+        return FMapSys().checkLines(mapId, count, x1, y1, z1, x2, y2, z2,
+            outBlockedMask, outHitDist, stopOnFirstHit, debug);
+    }
+
+    // checkLine vs the old fixed-step sampler on the tile under (x, y); see
+    // FMapSystem::benchmarkLines. Returns the segments the walk wrongly found clear (0
+    // expected), or -1 if there is no tile.
+    __declspec(dllexport) int BenchmarkFMapTile(int mapId, float x, float y, int rayCount) {
+        return FMapSys().benchmarkLines(mapId, x, y, rayCount);
     }
 
     __declspec(dllexport) float GetFMapFloorHeight(int mapId, float x, float y, float z, bool nearest = false) {
-        static bool initialized = false;
-        if (!initialized) {
-            g_FMapSys.init("C:/SMM/data/fmaps/");
-            initialized = true;
-        }
-        return g_FMapSys.getFloorHeight(mapId, x, y, z, nearest);
+        return FMapSys().getFloorHeight(mapId, x, y, z, nearest);
     }
 
     __declspec(dllexport) float GetFMapCeilingHeight(int mapId, float x, float y, float z) {
-        static bool initialized = false;
-        if (!initialized) {
-            g_FMapSys.init("C:/SMM/data/fmaps/");
-            initialized = true;
-        }
-        return g_FMapSys.getCeilingHeight(mapId, x, y, z);
+        return FMapSys().getCeilingHeight(mapId, x, y, z);
     }
 
     __declspec(dllexport) bool CanFlyAt(int mapId, float x, float y, float z) {
-        static bool initialized = false;
-        if (!initialized) {
-            g_FMapSys.init("C:/SMM/data/fmaps/");
-            initialized = true;
-        }
-        return g_FMapSys.canFlyAt(mapId, x, y, z);
+        return FMapSys().canFlyAt(mapId, x, y, z);
     }
 
     __declspec(dllexport) bool IsClearSky(int mapId, float x, float y, float z) {
-        static bool initialized = false;
-        if (!initialized) {
-            g_FMapSys.init("C:/SMM/data/fmaps/");
-            initialized = true;
-        }
-        return g_FMapSys.canFlyAt(mapId, x, y, z, true);
+        return FMapSys().canFlyAt(mapId, x, y, z, true);
     }
 
     __declspec(dllexport) bool CheckSurroundingTiles(int mapId, float x, float y, float z, int tileGridSize, float heightLimit) {
-        static bool initialized = false;
-        if (!initialized) {
-            g_FMapSys.init("C:/SMM/data/fmaps/");
-            initialized = true;
-        }
-        return g_FMapSys.checkSurroundingTiles(mapId, x, y, z, tileGridSize, heightLimit);
+        return FMapSys().checkSurroundingTiles(mapId, x, y, z, tileGridSize, heightLimit);
+    }
+
+    // Signed distance (yards) to the nearest solid voxel from the tile's clearance field.
+    // A lower bound when positive; <= 0 touching or inside geometry.
+    __declspec(dllexport) float GetFMapClearance(int mapId, float x, float y, float z) {
+        return FMapSys().getClearance(mapId, x, y, z);
+    }
+
+    __declspec(dllexport) bool IsFMapSphereClear(int mapId, float x, float y, float z, float radius) {
+        return FMapSys().isSphereClear(mapId, x, y, z, radius);
+    }
+
+    // Conservative: true means the capsule is clear, false only that it could not be proven
+    __declspec(dllexport) bool IsFMapCapsuleClear(int mapId, float x1, float y1, float z1,
+        float x2, float y2, float z2, float radius) {
+        return FMapSys().isCapsuleClear(mapId, x1, y1, z1, x2, y2, z2, radius);
+    }
+
+    // Top-layer bounds of the 2^level x 2^level column block under (x, y); level 3 and 5
+    // are the 8x and 32x LODs used for coarse flight planning. False if there is no tile.
+    __declspec(dllexport) bool GetFMapBlockBounds(int mapId, int level, float x, float y,
+        float* floorMax, float* ceilingMin) {
+        return FMapSys().getBlockBounds(mapId, level, x, y, *floorMax, *ceilingMin);
+    }
+
+    // Loads the tile under (x, y) and builds its clearance field if not done yet.
+    // Used by the prefetch thread.
+    __declspec(dllexport) bool PrefetchFMapTile(int mapId, float x, float y) {
+        FMapTilePtr tile = FMapSys().getTileAt(mapId, x, y);
+        if (!tile) return false;
+        FMapSys().buildClearance(tile);
+        return true;
     }
 
     __declspec(dllexport) void CleanupFMapCache(int mapId, float x, float y) {
-        static bool initialized = false;
-        if (!initialized) {
-            // Ensure init is called if not already
-            g_FMapSys.init("C:/SMM/data/fmaps/");
-            initialized = true;
-        }
         // Prune tiles further than 1200 yards away
-        g_FMapSys.CleanupTiles(mapId, x, y, 1200.0f);
+        FMapSys().CleanupTiles(mapId, x, y, 1200.0f);
+    }
+
+    // Concurrent floor/line queries against tile evictions; see FMapSystem::stressTileCache.
+    // Returns the number of answers that differed from the single-threaded ones (0
+    // expected), or -1 if there is no tile.
+    __declspec(dllexport) int StressFMapCache(int mapId, float x, float y, int threads, int iterations) {
+        return FMapSys().stressTileCache(mapId, x, y, threads, iterations);
     }
 }
\ No newline at end of file
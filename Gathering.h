@@ -105,7 +105,11 @@ void UpdateGatherTarget(WorldState& ws) {
                 // --- CLEANER IGNORE WATER LOGIC ---
                 if (g_GameState->globalState.ignoreUnderWater) {
                     // Get the Area ID directly from our new function
-                    unsigned char area = globalNavMesh.GetAreaID(object->position);
+                    unsigned char area;
+                    {
+                        NavMeshReadLock meshLock(g_NavMeshMutex);
+                        area = globalNavMesh.GetAreaID(object->position);
+                    }
 
                     // Check against our flags (Water Surface or Sea Floor)
                     if (area == AREA_UNDERWATER || area == AREA_DEEP_WATER) {
@@ -5,6 +5,7 @@
 #include "Vector.h"
 #include "MovementController.h"
 #include "Pathfinding2.h"
+#include "PathService.h"
 
 #include "SimpleMouseClient.h"
 #include "Camera.h"
@@ -134,6 +135,8 @@ private:
     DWORD pathCalcTimer = 0;
     int pathIndex = 0;
     std::vector<Vector3> currentPath;
+    PathRequestHandle pathRequest;   // Route being planned on the PathService
+    Vector3 pathRequestTarget;       // targetPos it was submitted for
 
     bool groundOverride = false;
     bool randomClick = false;
@@ -165,6 +168,7 @@ public:
         pathIndex = 0;
         groundOverride = false;
         currentPath.clear();
+        pathRequest.Cancel();
         randomClick = false;
         recalculatedPath = false;
         interactAttempt = 0;
@@ -207,21 +211,37 @@ public:
             currentState == STATE_WAIT_HOVER ||
             currentState == STATE_CLICK);
 
+        // A request dropped from a full PathService queue is simply made again
+        if (pathRequest.Status() == PATH_REQUEST_CANCELLED) pathRequest.Cancel();
+
         // Only recalculate path if:
         // 1. We are NOT currently interacting (isInteracting == false)
         // 2. We are in a state that allows movement (not CreatePath)
         // 3. The target is moving (movingTarget == true)
         // 4. Enough time has passed (200ms)
-        if (!isInteracting && (currentState != STATE_CREATE_PATH) && (movingTarget == true) && (updatedPos.Dist3D(targetPos) > interactDist) && (pathCalcTimer != 0) && (GetTickCount() - pathCalcTimer > 200)) {
+        // 5. No recalculation is already being planned
+        // The current path is followed until the new one arrives.
+        if (!isInteracting && (currentState != STATE_CREATE_PATH) && (movingTarget == true) && (updatedPos.Dist3D(targetPos) > interactDist) && (pathCalcTimer != 0) && (GetTickCount() - pathCalcTimer > 200) && !pathRequest.Valid()) {
             // Recalculate
-            currentPath = CalculatePath({ targetPos }, player.position, 0, canFly, mapId, player.isFlying, g_GameState->globalState.ignoreUnderWater, false, 25.0f, true, 5.0f, checkGoal, airTarget);
-            pathIndex = 0;
-            recalculatedPath = true;
+            pathRequest = g_PathService.Submit({ targetPos }, player.position, 0, canFly, mapId, player.isFlying, g_GameState->globalState.ignoreUnderWater, false, 25.0f, true, 5.0f, checkGoal, airTarget);
+            pathRequestTarget = targetPos;
             pathCalcTimer = GetTickCount();
         }
+        if (currentState != STATE_CREATE_PATH) {
+            std::vector<PathNode> replanned;
+            if (pathRequest.Take(replanned)) {
+                if (!replanned.empty()) {
+                    currentPath = replanned;
+                    pathIndex = PathService::ResumeIndex(currentPath, player.position);
+                    recalculatedPath = true;
+                }
+                pathCalcTimer = GetTickCount();
+            }
+        }
 
         if (((GetState() == "STATE_APPROACH") || (GetState() == "STATE_APPROACH_POST_INTERACT")) && (GetTickCount() < pilot.m_MountDisabledUntil) && (groundOverride == false) && (canFly == true)) {
             currentState = STATE_CREATE_PATH;
+            pathRequest.Cancel(); // Planned with canFly; the tunnel needs a ground path
             g_LogFile << "Recalculating ground path for tunnel" << std::endl;
             canFly = false;
             groundOverride = true;
@@ -236,9 +256,17 @@ public:
             return false;
 
         case STATE_CREATE_PATH:
-            // Assuming CalculatePath is available globally or via included header
-            g_LogFile << "Target Pos x: " << targetPos.x << " | Target Pos y: " << targetPos.y << " | Target Pos z: " << targetPos.z << std::endl;
-            currentPath = CalculatePath({ targetPos }, player.position, 0, canFly, mapId, player.isFlying, g_GameState->globalState.ignoreUnderWater, false, 25.0f, true, 5.0f, checkGoal, airTarget);
+        {
+            // A request for a target that has since moved away is no use
+            if (pathRequest.Valid() && pathRequestTarget.Dist3D(targetPos) > 20.0f) pathRequest.Cancel();
+            if (!pathRequest.Valid()) {
+                g_LogFile << "Target Pos x: " << targetPos.x << " | Target Pos y: " << targetPos.y << " | Target Pos z: " << targetPos.z << std::endl;
+                pathRequest = g_PathService.Submit({ targetPos }, player.position, 0, canFly, mapId, player.isFlying, g_GameState->globalState.ignoreUnderWater, false, 25.0f, true, 5.0f, checkGoal, airTarget);
+                pathRequestTarget = targetPos;
+            }
+            std::vector<PathNode> newPath;
+            if (!pathRequest.Take(newPath)) return false; // Still planning
+            currentPath = newPath;
             //if (currentPath.empty()) EndScript(pilot, (canFly && g_GameState->player.areaMountable) ? 2 : 1);
 
             if (currentPath.empty()) {
@@ -254,10 +282,11 @@ public:
             /*for (int i = 0; i < currentPath.size(); i++) {
                 g_LogFile << "Path: " << i << " | X coord: " << currentPath[i].pos.x << " | Y coord: " << currentPath[i].pos.y << " | Z coord: " << currentPath[i].pos.z << std::endl;
             }*/
-            pathIndex = 0;
+            pathIndex = PathService::ResumeIndex(currentPath, player.position);
             pathCalcTimer = GetTickCount();
             currentState = STATE_APPROACH;
             return false;
+        }
 
         case STATE_APPROACH:
             if ((MoveToTargetLogic(targetPos, currentPath, pathIndex, player, stateTimer, approachDist, interactDist, finalDist, fly_entry_state, mountDisable)) && !player.isMounted) {
@@ -1033,8 +1062,8 @@ public:
 
 // --- CONCRETE ACTION: ESCAPE DANGER ---
 // Triggered when a hostile enemy significantly above the player's level is nearby.
-// Finds a safe destination away from all threats, marks navmesh polygons inside every
-// threat's aggro radius with AREA_DANGER, pathfinds around those polys, then restores them.
+// Finds a safe destination away from all threats and pathfinds there, pricing the navmesh
+// polygons inside every threat's aggro radius up so the route goes around them.
 class ActionEscapeDanger : public GoapAction {
 private:
     const int   FLEE_LEVEL_DIFF   = 5;     // Flee if enemy is this many levels above player
@@ -1164,18 +1193,19 @@ public:
             Vector3 dest = FindFleeDestination(ws, threats);
             ws.fleeState.destination = dest;
 
-            // Mark all danger-zone polygons so the pathfinder routes around them
-            std::vector<std::pair<dtPolyRef, unsigned short>> savedFlags;
-            for (const auto& t : threats) {
-                globalNavMesh.MarkPolysInRadius(t.position, t.dangerRadius, AREA_DANGER, savedFlags);
+            // Collect the danger-zone polygons; only this query avoids them, so the
+            // shared mesh is untouched and a read lock is enough
+            std::unordered_set<dtPolyRef> dangerPolys;
+            {
+                NavMeshReadLock meshLock(g_NavMeshMutex);
+                for (const auto& t : threats) {
+                    globalNavMesh.CollectPolysInRadius(t.position, t.dangerRadius, dangerPolys);
+                }
             }
 
-            fleePath = FindPath(ws.player.position, dest, false, true, true, 5.0f, AREA_DANGER);
+            fleePath = FindPath(ws.player.position, dest, false, true, true, 5.0f, &dangerPolys);
             fleeIndex = 0;
 
-            // Restore poly flags immediately — danger marking must not persist
-            globalNavMesh.RestorePolyFlags(savedFlags);
-
             if (fleePath.empty()) {
                 g_LogFile << "[Flee] Navmesh path failed. Steering directly away." << std::endl;
                 pilot.SteerTowards(ws.player.position, ws.player.rotation,
@@ -2413,6 +2443,8 @@ public:
             g_LogFile << "  From: (" << ws.player.position.x << "," << ws.player.position.y << "," << ws.player.position.z << ")" << std::endl;
             g_LogFile << "  To: (" << returnTarget.x << "," << returnTarget.y << "," << returnTarget.z << ")" << std::endl;
 
+            NavMeshReadLock meshLock(g_NavMeshMutex);
+
             // Check if target is at ground level
             float targetGroundZ = globalNavMesh.GetLocalGroundHeight(returnTarget);
             bool targetOnGround = (targetGroundZ > -90000.0f && std::abs(returnTarget.z - targetGroundZ) < GROUND_HEIGHT_THRESHOLD);
@@ -2742,6 +2774,7 @@ private:
     const float GROUND_ACCEPTANCE_RADIUS = 1.0f;
     const int   PATH_CALC_INTERVAL       = 3000; // ms between CalculatePath attempts when path is failing
     DWORD       pathCalcTimer            = 0;
+    PathRequestHandle routeRequest;               // Hotspot route being planned on the PathService
 
     bool IsValidTarget(const EnemyInfo& npc, const WorldState& ws,
                        ULONG_PTR guidLow = 0, ULONG_PTR guidHigh = 0) const {
@@ -2809,7 +2842,7 @@ public:
     int GetPriority() override { return 25; }
     std::string GetName() override { return "Grind"; }
     ActionState* GetState(WorldState& ws) override { return &ws.grindState; }
-    void ResetState() override { }
+    void ResetState() override { routeRequest.Cancel(); }
 
     bool Execute(WorldState& ws, MovementController& pilot) override {
 
@@ -2893,6 +2926,7 @@ public:
             ws.player.position.Dist2D(ws.grindState.path[ws.grindState.index].pos) > 30.0f) {
             ws.grindState.path.clear();
             ws.grindState.index = 0;
+            routeRequest.Cancel();
             if (!ws.grindState.hotspots.empty()) {
                 float bestHsDist = FLT_MAX;
                 for (int i = 0; i < (int)ws.grindState.hotspots.size(); ++i) {
@@ -2903,10 +2937,13 @@ public:
         }
 
         if (ws.grindState.path.empty()) {
+            if (routeRequest.Status() == PATH_REQUEST_CANCELLED) routeRequest.Cancel();
+
             // Rate-limit path calculation to avoid hammering the NavMesh every tick on failure.
-            if (GetTickCount() - pathCalcTimer > (DWORD)PATH_CALC_INTERVAL) {
+            // The route is planned on the PathService; we keep steering meanwhile.
+            if (!routeRequest.Valid() && GetTickCount() - pathCalcTimer > (DWORD)PATH_CALC_INTERVAL) {
                 pathCalcTimer = GetTickCount();
-                ws.grindState.path = CalculatePath(
+                routeRequest = g_PathService.Submit(
                     ws.grindState.hotspots,
                     ws.player.position,
                     ws.grindState.hotspotIndex,
@@ -2921,7 +2958,13 @@ public:
                     false,
                     ws.grindState.canFly
                 );
-                ws.grindState.index = 0;
+            }
+
+            std::vector<PathNode> route;
+            if (routeRequest.Take(route)) {
+                pathCalcTimer = GetTickCount();
+                ws.grindState.path = route;
+                ws.grindState.index = PathService::ResumeIndex(route, ws.player.position);
 
                 if (!ws.grindState.path.empty()) {
                     ws.waypointReturnState.savedPath    = ws.grindState.path;
@@ -3036,6 +3079,7 @@ class ActionFollowPath : public GoapAction {
 private:
     const float ACCEPTANCE_RADIUS = 3.0f;
     const float GROUND_ACCEPTANCE_RADIUS = 1.0f;
+    PathRequestHandle pathRequest;
 
 public:
     bool CanExecute(const WorldState& ws) override {
@@ -3050,12 +3094,13 @@ public:
     }
 
     void ResetState() override {
-
+        pathRequest.Cancel();
     }
 
     bool Execute(WorldState& ws, MovementController& pilot) override {
         if (ws.pathFollowState.path.empty()) {
-            ws.pathFollowState.path = CalculatePath(
+            if (pathRequest.Status() == PATH_REQUEST_CANCELLED) pathRequest.Cancel();
+            if (!pathRequest.Valid()) pathRequest = g_PathService.Submit(
                 g_GameState->pathFollowState.presetPath,
                 g_GameState->player.position,
                 g_GameState->pathFollowState.presetIndex,
@@ -3070,7 +3115,8 @@ public:
                 false,
                 ws.pathFollowState.flyingPath
             );
-            ws.pathFollowState.index = 0;
+            if (!pathRequest.Take(ws.pathFollowState.path)) return false; // Still planning
+            ws.pathFollowState.index = PathService::ResumeIndex(ws.pathFollowState.path, ws.player.position);
 
             if (ws.pathFollowState.path.size() > 0) {
                 ws.waypointReturnState.savedPath = ws.pathFollowState.path;
@@ -0,0 +1,289 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <cfloat>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+
+#include "Vector.h"
+#include "Pathfinding2.h"
+
+// --- PATH SERVICE CONFIGURATION ---
+const int PATH_SERVICE_THREADS = 2;          // Worker threads planning routes
+const size_t PATH_SERVICE_MAX_PENDING = 32;  // Bounded request queue
+const float PATH_SERVICE_RESUME_DISTANCE = 100.0f; // How far into a fresh path ResumeIndex looks
+
+// Arguments of one CalculatePath call
+struct PathRequest {
+    std::vector<Vector3> inputPath;
+    Vector3 startPos;
+    int currentIndex = 0;
+    bool canFly = false;
+    int mapId = 0;
+    bool isFlying = false;
+    bool ignoreWater = false;
+    bool loop = false;
+    float pathThreshold = 25.0f;
+    bool zCheck = true;
+    float groundZExtent = 5.0f;
+    bool checkGoal = true;
+    bool airTarget = false;
+};
+
+enum PathRequestStatus {
+    PATH_REQUEST_NONE = 0,      // Handle holds no request
+    PATH_REQUEST_PENDING = 1,   // Queued or being planned
+    PATH_REQUEST_DONE = 2,      // Result ready (may be an empty path)
+    PATH_REQUEST_CANCELLED = 3
+};
+
+class PathService;
+
+// One route being planned. Shared by every handle that asked for the same route.
+struct PathJob {
+    PathRequest request;
+    std::vector<int> key;
+    std::atomic<int> status{ PATH_REQUEST_PENDING };
+    std::atomic<bool> cancelled{ false };  // Polled by the planner through g_PathCancelToken
+    int waiters = 0;                       // Live handles; guarded by PathService::mutex
+    std::vector<PathNode> result;          // Written once, before status becomes DONE
+};
+
+// What an action keeps while its path is planned. Poll Ready()/Take() each tick and
+// keep following the old path until Take() hands over the new one. Dropping or
+// overwriting the handle cancels the request unless another handle shares it.
+class PathRequestHandle {
+private:
+    friend class PathService;
+    std::shared_ptr<PathJob> job;
+    PathService* service = nullptr;
+
+public:
+    PathRequestHandle() {}
+    PathRequestHandle(const PathRequestHandle&) = delete;
+    PathRequestHandle& operator=(const PathRequestHandle&) = delete;
+    PathRequestHandle(PathRequestHandle&& o) noexcept : job(std::move(o.job)), service(o.service) { o.service = nullptr; }
+    PathRequestHandle& operator=(PathRequestHandle&& o) noexcept {
+        if (this != &o) {
+            Cancel();
+            job = std::move(o.job);
+            service = o.service;
+            o.service = nullptr;
+        }
+        return *this;
+    }
+    ~PathRequestHandle() { Cancel(); }
+
+    bool Valid() const { return job != nullptr; }
+    bool Pending() const { return job && job->status == PATH_REQUEST_PENDING; }
+    bool Ready() const { return job && job->status == PATH_REQUEST_DONE; }
+
+    PathRequestStatus Status() const {
+        return job ? (PathRequestStatus)job->status.load() : PATH_REQUEST_NONE;
+    }
+
+    // Copies the finished path out (other handles may share the job) and releases the
+    // handle. False while still planning.
+    bool Take(std::vector<PathNode>& out) {
+        if (!Ready()) return false;
+        out = job->result;
+        Cancel();
+        return true;
+    }
+
+    inline void Cancel();
+};
+
+// --- PATH SERVICE ---
+// Runs CalculatePath on a small worker pool so a long flight plan no longer stalls
+// GoapAgent::Tick. Requests with identical arguments (positions compared to the yard,
+// like PathCacheKey) share one job. Workers load NavMesh tiles one at a time (exclusive
+// g_NavMeshMutex) and then plan side by side, each on its own pooled dtNavMeshQuery.
+class PathService {
+private:
+    friend class PathRequestHandle;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable queueCv;
+    std::deque<std::shared_ptr<PathJob>> pending;
+    std::map<std::vector<int>, std::shared_ptr<PathJob>> inFlight; // Queued or running, by key
+    std::atomic<bool> running{ false };
+
+    static std::vector<int> MakeKey(const PathRequest& r) {
+        std::vector<int> key = { r.mapId, r.currentIndex,
+            (r.canFly ? 1 : 0) | (r.isFlying ? 2 : 0) | (r.ignoreWater ? 4 : 0) | (r.loop ? 8 : 0) |
+            (r.zCheck ? 16 : 0) | (r.checkGoal ? 32 : 0) | (r.airTarget ? 64 : 0),
+            (int)(r.pathThreshold * 10.0f), (int)(r.groundZExtent * 10.0f),
+            (int)r.startPos.x, (int)r.startPos.y, (int)r.startPos.z };
+        for (const Vector3& p : r.inputPath) {
+            key.push_back((int)p.x);
+            key.push_back((int)p.y);
+            key.push_back((int)p.z);
+        }
+        return key;
+    }
+
+    // Called by the last handle that lets go of a job
+    void Release(const std::shared_ptr<PathJob>& job) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--job->waiters > 0) return;
+        if (job->status == PATH_REQUEST_PENDING) {
+            job->cancelled = true;
+            job->status = PATH_REQUEST_CANCELLED;
+        }
+        auto it = inFlight.find(job->key);
+        if (it != inFlight.end() && it->second == job) inFlight.erase(it);
+    }
+
+    void Finish(const std::shared_ptr<PathJob>& job, std::vector<PathNode>&& path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = inFlight.find(job->key);
+        if (it != inFlight.end() && it->second == job) inFlight.erase(it);
+        if (job->cancelled) return;
+        job->result = std::move(path);
+        job->status = PATH_REQUEST_DONE;
+    }
+
+    void WorkerLoop() {
+        while (running) {
+            std::shared_ptr<PathJob> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                queueCv.wait(lock, [&]() { return !running || !pending.empty(); });
+                if (!running) break;
+                job = pending.front();
+                pending.pop_front();
+            }
+
+            if (job->cancelled) continue; // Nobody is waiting for it any more
+
+            std::vector<PathNode> path;
+            try {
+                const PathRequest& r = job->request;
+                g_PathCancelToken = &job->cancelled;
+                path = CalculatePath(r.inputPath, r.startPos, r.currentIndex, r.canFly, r.mapId, r.isFlying,
+                    r.ignoreWater, r.loop, r.pathThreshold, r.zCheck, r.groundZExtent, r.checkGoal, r.airTarget);
+            }
+            catch (const std::exception& e) {
+                PathLog() << "[PathService] " << e.what() << std::endl;
+                path.clear();
+            }
+            g_PathCancelToken = nullptr;
+
+            Finish(job, std::move(path));
+        }
+    }
+
+public:
+    PathService() {}
+    ~PathService() { Stop(); }
+
+    // Main loop. Joins an identical request already in flight instead of planning twice.
+    PathRequestHandle Submit(const PathRequest& request) {
+        PathRequestHandle handle;
+        std::vector<int> key = MakeKey(request);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!running) {
+                running = true;
+                for (int i = 0; i < PATH_SERVICE_THREADS; ++i) {
+                    workers.emplace_back(&PathService::WorkerLoop, this);
+                }
+            }
+
+            auto it = inFlight.find(key);
+            if (it != inFlight.end() && !it->second->cancelled) {
+                handle.job = it->second;
+            }
+            else {
+                // Oldest queued request goes first when the queue is full; its handles see CANCELLED
+                if (pending.size() >= PATH_SERVICE_MAX_PENDING) {
+                    std::shared_ptr<PathJob> dropped = pending.front();
+                    pending.pop_front();
+                    dropped->cancelled = true;
+                    dropped->status = PATH_REQUEST_CANCELLED;
+                    auto old = inFlight.find(dropped->key);
+                    if (old != inFlight.end() && old->second == dropped) inFlight.erase(old);
+                }
+
+                handle.job = std::make_shared<PathJob>();
+                handle.job->request = request;
+                handle.job->key = key;
+                inFlight[key] = handle.job;
+                pending.push_back(handle.job);
+            }
+            handle.job->waiters++;
+            handle.service = this;
+        }
+        queueCv.notify_one();
+        return handle;
+    }
+
+    // Same arguments as CalculatePath
+    PathRequestHandle Submit(const std::vector<Vector3>& inputPath, const Vector3& startPos,
+        int currentIndex, bool canFly, int mapId, bool isFlying, bool ignoreWater, bool path_loop = false,
+        float pathThreshold = 25.0f, bool zCheck = true, float groundZExtent = 5.0f, bool checkGoal = true, bool airTarget = false) {
+        PathRequest r;
+        r.inputPath = inputPath;
+        r.startPos = startPos;
+        r.currentIndex = currentIndex;
+        r.canFly = canFly;
+        r.mapId = mapId;
+        r.isFlying = isFlying;
+        r.ignoreWater = ignoreWater;
+        r.loop = path_loop;
+        r.pathThreshold = pathThreshold;
+        r.zCheck = zCheck;
+        r.groundZExtent = groundZExtent;
+        r.checkGoal = checkGoal;
+        r.airTarget = airTarget;
+        return Submit(r);
+    }
+
+    // The path was planned from where the player stood at Submit(); start from the
+    // node nearest to where they are now so the bot does not double back. Only the
+    // opening stretch is searched, so a looping route never skips to its far end.
+    static int ResumeIndex(const std::vector<PathNode>& path, const Vector3& playerPos) {
+        int best = 0;
+        float bestDist = FLT_MAX;
+        float travelled = 0.0f;
+        for (int i = 0; i < (int)path.size() && travelled <= PATH_SERVICE_RESUME_DISTANCE; ++i) {
+            if (i > 0) travelled += path[i].pos.Dist3D(path[i - 1].pos);
+            float d = path[i].pos.Dist3D(playerPos);
+            if (d < bestDist) { bestDist = d; best = i; }
+        }
+        return best;
+    }
+
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+            for (auto& job : pending) {
+                job->cancelled = true;
+                job->status = PATH_REQUEST_CANCELLED;
+            }
+            for (auto& entry : inFlight) entry.second->cancelled = true;
+            pending.clear();
+            inFlight.clear();
+        }
+        queueCv.notify_all();
+        for (auto& t : workers) {
+            if (t.joinable()) t.join();
+        }
+        workers.clear();
+    }
+};
+
+inline void PathRequestHandle::Cancel() {
+    if (job && service) service->Release(job);
+    job.reset();
+    service = nullptr;
+}
+
+inline PathService g_PathService;
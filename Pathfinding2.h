@@ -15,6 +15,24 @@
 #include <set>
 #include <utility>
 #include <tuple>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <deque>
+#include <climits>
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 // DETOUR INCLUDES
 #include "DetourNavMesh.h"
@@ -24,13 +42,22 @@
 #include "Vector.h"
 #include "MovementController.h"
 #include "WorldState.h"
+#include "TileResidency.h"
 
 // FMap function declarations (replaces VMap)
 extern "C" bool CheckFMapLine(int mapId, float x1, float y1, float z1, float x2, float y2, float z2, bool debug);
+extern "C" int CheckFMapLines(int mapId, int count,
+    const float* x1, const float* y1, const float* z1,
+    const float* x2, const float* y2, const float* z2,
+    uint32_t* outBlockedMask, float* outHitDist, bool stopOnFirstHit, bool debug);
 extern "C" float GetFMapFloorHeight(int mapId, float x, float y, float z, bool nearest);
 extern "C" bool CanFlyAt(int mapId, float x, float y, float z);
 extern "C" bool IsClearSky(int mapId, float x, float y, float z);
 extern "C" bool CheckSurroundingTiles(int mapId, float x, float y, float z, int tileGridSize, float heightLimit);
+extern "C" float GetFMapClearance(int mapId, float x, float y, float z);
+extern "C" bool IsFMapSphereClear(int mapId, float x, float y, float z, float radius);
+extern "C" bool IsFMapCapsuleClear(int mapId, float x1, float y1, float z1, float x2, float y2, float z2, float radius);
+extern "C" bool GetFMapBlockBounds(int mapId, int level, float x, float y, float* floorMax, float* ceilingMin);
 
 // --- AREA CONSTANTS (Must match Generator/PathCommon.h) ---
 const unsigned short AREA_GROUND = 0x01; // 1 (Ground)
@@ -41,7 +68,8 @@ const unsigned short AREA_UNDERWATER = 0x10; // 16 (Sea Floor)
 const unsigned short AREA_ROAD = 0x20; // 32 (Roads)
 const unsigned short AREA_DEEP_WATER = 0x06; // 6 (Deep Water)
 const unsigned short AREA_INDOOR_UNDERGROUND = 0x0A; // 10
-const unsigned short AREA_DANGER = 0x4000; // Runtime-only: marks polys near dangerous enemies during flee pathfinding
+const float AVOID_POLY_COST = 50.0f; // Cost multiplier on polys a FindPath caller asks to avoid (flee danger zones)
+const int AVOID_SEARCH_MAX_NODES = 8192;
 
 // --- CONFIGURATION ---
 const float COLLISION_STEP_SIZE = 0.5f;    // Was 0.5f - less sampling
@@ -57,13 +85,128 @@ const float APPROACH_DISTANCE = 15.0f;
 const float LANDING_AGENT_RADIUS = 2.0f;
 const float FMAP_VERTICAL_TOLERANCE = 2.0f;  // Tolerance for floor snapping
 
+// COARSE-TO-FINE FLIGHT PLANNING (FMap height pyramid LODs, see PlanFlightCorridor)
+const float FLIGHT_LOD_MIN_DISTANCE = 400.0f;      // Shorter flights go straight to the fine A*
+const float FLIGHT_LOD_CELL_SIZE = 533.33333f / 160.0f; // One FMap column
+const int FLIGHT_LOD_COARSE_LEVEL = 5;             // 32x32 columns (107 yd) per block
+const int FLIGHT_LOD_FINE_LEVEL = 3;               // 8x8 columns (27 yd) per block
+const int FLIGHT_LOD_COARSE_CORRIDOR = 1;          // Corridor half-width around each route, in blocks
+const int FLIGHT_LOD_FINE_CORRIDOR = 2;
+const float FLIGHT_LOD_SLAB_HEIGHT = 25.0f;        // Vertical resolution of the coarse search
+const float FLIGHT_LOD_MARGIN = 3.0f;              // Clearance kept above a block's highest floor
+const float FLIGHT_LOD_MAX_CLIMB = 800.0f;         // Search ceiling above the higher endpoint
+const int FLIGHT_LOD_MAX_NODES = 20000;
+
 // PATH CACHE LIMITS
 const size_t MAX_CACHE_SIZE = 100;
 const size_t CACHE_CLEANUP_THRESHOLD = 120;
+const size_t MAX_STAGED_TILES = 64;        // NavMesh tile files read ahead by the prefetcher
+const int NAVMESH_KEEP_DISTANCE = 4;       // Loaded NavMesh tiles farther than this (in tiles) from the player and route are dropped
+const float FLIGHT_POINT_CACHE_RESOLUTION = 0.25f; // Flight A* grid points are multiples of this, so they key exactly
+const size_t FLIGHT_POINT_CACHE_MAX_PER_TILE = 65536; // A full tile bucket starts over
+const int FLIGHT_POINT_CACHE_SHARDS = 16;
 
 const float GROUND_PATH_THRESHOLD = 4.0f;
 
 const bool DEBUG_PATHFINDING = true;  // Enable for flight debugging
+const size_t PATH_LOG_MAX_QUEUED = 4096;  // Lines held for the tick; the oldest go first when full
+
+// --- PATHFINDING LOG ---
+// Routes are planned on PathService workers and their helpers as well as on the tick,
+// and the tick writes g_LogFile everywhere without a lock. So only the tick thread ever
+// touches the file: a PathLog line built on any other thread is queued whole and
+// FlushPathLog() (called by the tick) writes the queue out. Use it like the stream:
+//   PathLog() << "[Flight] ..." << std::endl;
+inline std::mutex g_PathLogMutex;
+inline std::deque<std::string> g_PathLogQueue;  // Guarded by g_PathLogMutex
+inline size_t g_PathLogDropped = 0;             // Guarded by g_PathLogMutex
+inline std::atomic<std::thread::id> g_PathLogThread{};  // The tick, once it has flushed
+
+// Writes finished log text: straight to g_LogFile on the tick, queued anywhere else
+inline void PathLogWrite(const std::string& text) {
+    if (text.empty()) return;
+    if (std::this_thread::get_id() == g_PathLogThread.load()) {
+        g_LogFile << text;
+        g_LogFile.flush();
+        return;
+    }
+    std::lock_guard<std::mutex> lock(g_PathLogMutex);
+    if (g_PathLogQueue.size() >= PATH_LOG_MAX_QUEUED) {
+        g_PathLogQueue.pop_front();
+        g_PathLogDropped++;
+    }
+    g_PathLogQueue.push_back(text);
+}
+
+// Groups the PathLog lines of one route segment (or A* attempt) planned side by side
+// with others. While a block is open on a thread, PathLog appends to it; closing it
+// hands the text to the enclosing block, or writes it out if it is the outermost.
+// Helpers of a ParallelFor adopt the caller's block, so their blocks nest under it.
+class PathLogBlock;
+inline thread_local PathLogBlock* g_PathLogBlock = nullptr;
+
+class PathLogBlock {
+private:
+    std::mutex mutex;    // Nested blocks may close on helper threads
+    std::string text;
+    PathLogBlock* parent;
+
+public:
+    PathLogBlock() : parent(g_PathLogBlock) { g_PathLogBlock = this; }
+    PathLogBlock(const PathLogBlock&) = delete;
+    PathLogBlock& operator=(const PathLogBlock&) = delete;
+    ~PathLogBlock() { Close(); }
+
+    // Hands the text on and reopens the enclosing block. Closing twice does nothing.
+    void Close() {
+        if (g_PathLogBlock != this) return;
+        g_PathLogBlock = parent;
+        if (parent) parent->Append(text);
+        else PathLogWrite(text);
+    }
+
+    void Append(const std::string& more) {
+        std::lock_guard<std::mutex> lock(mutex);
+        text += more;
+    }
+};
+
+class PathLog {
+private:
+    std::ostringstream line;
+
+public:
+    PathLog() {}
+    PathLog(const PathLog&) = delete;
+    PathLog& operator=(const PathLog&) = delete;
+
+    template<typename T>
+    PathLog& operator<<(const T& value) { line << value; return *this; }
+    PathLog& operator<<(std::ostream& (*manip)(std::ostream&)) { line << manip; return *this; }
+    PathLog& operator<<(std::ios_base& (*manip)(std::ios_base&)) { line << manip; return *this; }
+
+    ~PathLog() {
+        if (g_PathLogBlock) g_PathLogBlock->Append(line.str());
+        else PathLogWrite(line.str());
+    }
+};
+
+// Tick thread only. Writes what planning threads logged since the last call.
+inline void FlushPathLog() {
+    g_PathLogThread = std::this_thread::get_id();
+
+    std::deque<std::string> lines;
+    size_t dropped = 0;
+    {
+        std::lock_guard<std::mutex> lock(g_PathLogMutex);
+        lines.swap(g_PathLogQueue);
+        dropped = g_PathLogDropped;
+        g_PathLogDropped = 0;
+    }
+    if (dropped > 0) g_LogFile << "[PathLog] " << dropped << " lines dropped while the tick was busy" << std::endl;
+    for (const std::string& line : lines) g_LogFile << line;
+    if (!lines.empty()) g_LogFile.flush();
+}
 
 enum FlightSegmentResult {
     SEGMENT_VALID = 0,
@@ -109,23 +252,38 @@ struct FlightNode3D {
     float gScore;
     float hScore;
     int parentIdx;
+    int fromIdx;    // Lazy Theta*: the expanded neighbour that generated it (parent fallback)
+    bool closed;    // Already expanded
 
-    FlightNode3D() : gScore(1e9f), hScore(0.0f), parentIdx(-1) {}
+    // Bidirectional search: the same from the goal's side (h is the distance to the start)
+    float gScoreBack;
+    float hScoreBack;
+    int parentBack;
+    bool closedBack;
+
+    FlightNode3D() : gScore(1e9f), hScore(0.0f), parentIdx(-1), fromIdx(-1), closed(false),
+        gScoreBack(1e9f), hScoreBack(0.0f), parentBack(-1), closedBack(false) {}
 
     float fScore() const { return gScore + hScore; }
+    float fScoreBack() const { return gScoreBack + hScoreBack; }
 };
 
 // Custom priority queue that uses indices
 struct IndexPriorityQueue {
     std::vector<int> heap;
     const std::vector<FlightNode3D>* nodes;
+    bool backward;  // Ordered by fScoreBack (goal-side frontier)
+
+    IndexPriorityQueue(const std::vector<FlightNode3D>* n, bool back = false) : nodes(n), backward(back) {}
 
-    IndexPriorityQueue(const std::vector<FlightNode3D>* n) : nodes(n) {}
+    float key(int idx) const {
+        return backward ? (*nodes)[idx].fScoreBack() : (*nodes)[idx].fScore();
+    }
 
     void push(int idx) {
         heap.push_back(idx);
         std::push_heap(heap.begin(), heap.end(), [this](int a, int b) {
-            return (*nodes)[a].fScore() > (*nodes)[b].fScore();
+            return key(a) > key(b);
             });
     }
 
@@ -133,7 +291,7 @@ struct IndexPriorityQueue {
 
     void pop() {
         std::pop_heap(heap.begin(), heap.end(), [this](int a, int b) {
-            return (*nodes)[a].fScore() > (*nodes)[b].fScore();
+            return key(a) > key(b);
             });
         heap.pop_back();
     }
@@ -142,6 +300,240 @@ struct IndexPriorityQueue {
     size_t size() const { return heap.size(); }
 };
 
+// --- FLIGHT A* NODE ARENA ---
+// Node store for Calculate3DFlightPath, one per thread, reused across calls and attempts.
+// Grid cells map to node indices through a paged sparse grid: 16x16x16-cell pages found
+// through a small open-addressed page table. Table slots carry the generation they were
+// written in, so Reset() is O(1); a page's cells are wiped when it is first touched in
+// the current generation. Neighbour lookups mostly land in the page just used.
+class FlightNodeArena {
+private:
+    static const int PAGE_BITS = 4;
+    static const int PAGE_MASK = (1 << PAGE_BITS) - 1;
+    static const int PAGE_CELLS = 1 << (PAGE_BITS * 3);
+    static const size_t MIN_TABLE_SIZE = 1024;
+
+    struct PageSlot {
+        uint64_t key = 0;
+        uint32_t generation = 0;  // 0 = never used
+        int32_t page = -1;
+    };
+
+    std::vector<PageSlot> table;   // Power of two
+    size_t tableUsed = 0;
+    std::vector<int32_t> cells;    // pagesUsed * PAGE_CELLS node indices, -1 = none
+    int32_t pagesUsed = 0;
+    uint32_t generation = 1;
+    uint64_t lastKey = 0;
+    int32_t lastPage = -1;
+
+    static uint64_t PageKey(int x, int y, int z) {
+        // Arithmetic shift floors negative cells into the right page; 21 bits per axis
+        return ((uint64_t)((x >> PAGE_BITS) & 0x1FFFFF) << 42) |
+            ((uint64_t)((y >> PAGE_BITS) & 0x1FFFFF) << 21) |
+            (uint64_t)((z >> PAGE_BITS) & 0x1FFFFF);
+    }
+
+    static size_t HashKey(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return (size_t)key;
+    }
+
+    void Grow() {
+        std::vector<PageSlot> old;
+        old.swap(table);
+        table.assign((std::max)(old.size() * 2, MIN_TABLE_SIZE), PageSlot());
+        size_t mask = table.size() - 1;
+        for (const PageSlot& slot : old) {
+            if (slot.generation != generation) continue;
+            size_t h = HashKey(slot.key) & mask;
+            while (table[h].generation == generation) h = (h + 1) & mask;
+            table[h] = slot;
+        }
+    }
+
+    int32_t FindPage(uint64_t key, bool create) {
+        if (key == lastKey && lastPage >= 0) return lastPage;
+        if (table.empty()) {
+            if (!create) return -1;
+            Grow();
+        }
+
+        size_t mask = table.size() - 1;
+        size_t h = HashKey(key) & mask;
+        while (table[h].generation == generation) {
+            if (table[h].key == key) {
+                lastKey = key;
+                lastPage = table[h].page;
+                return lastPage;
+            }
+            h = (h + 1) & mask;
+        }
+        if (!create) return -1;
+
+        if ((tableUsed + 1) * 2 > table.size()) {
+            Grow();
+            return FindPage(key, true);
+        }
+
+        int32_t page = pagesUsed++;
+        if (cells.size() < (size_t)pagesUsed * PAGE_CELLS) cells.resize((size_t)pagesUsed * PAGE_CELLS);
+        std::fill(cells.begin() + (size_t)page * PAGE_CELLS, cells.begin() + (size_t)pagesUsed * PAGE_CELLS, -1);
+
+        table[h].key = key;
+        table[h].generation = generation;
+        table[h].page = page;
+        tableUsed++;
+        lastKey = key;
+        lastPage = page;
+        return page;
+    }
+
+    static size_t CellOffset(int x, int y, int z) {
+        return (size_t)(x & PAGE_MASK) | ((size_t)(y & PAGE_MASK) << PAGE_BITS) | ((size_t)(z & PAGE_MASK) << (PAGE_BITS * 2));
+    }
+
+public:
+    std::vector<FlightNode3D> nodes;
+
+    // Forgets every node and cell; keeps the memory
+    void Reset() {
+        nodes.clear();
+        pagesUsed = 0;
+        tableUsed = 0;
+        lastPage = -1;
+        if (++generation == 0) {
+            // Wrapped: stale slots could look current again
+            table.assign(table.size(), PageSlot());
+            generation = 1;
+        }
+    }
+
+    // Node index stored for a grid cell, -1 if none
+    int Find(int x, int y, int z) {
+        int32_t page = FindPage(PageKey(x, y, z), false);
+        return page < 0 ? -1 : cells[(size_t)page * PAGE_CELLS + CellOffset(x, y, z)];
+    }
+
+    // The cell's slot, creating its page. Valid until the next Cell() call.
+    int32_t& Cell(int x, int y, int z) {
+        int32_t page = FindPage(PageKey(x, y, z), true);
+        return cells[(size_t)page * PAGE_CELLS + CellOffset(x, y, z)];
+    }
+};
+
+inline thread_local FlightNodeArena g_FlightNodeArena;
+
+// --- FLIGHT POINT CACHE ---
+enum FlightPointState {
+    FLIGHT_POINT_UNKNOWN = 0,
+    FLIGHT_POINT_VALID = 1,
+    FLIGHT_POINT_BLOCKED = 2
+};
+
+struct FlightPointCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    float HitRate() const { return (hits + misses) ? (float)hits / (float)(hits + misses) : 0.0f; }
+};
+
+// Remembers NavMesh::CheckFlightPoint results for the flight A*. Every attempt of a
+// Calculate3DFlightPath call, and every call on a loop route, asks about the same grid
+// points again. Results are bucketed by ADT tile (the residency manager's grid) and a
+// bucket is dropped as soon as the FMap or NavMesh tile under it stops being resident,
+// so nothing outlives the data it was computed from. Put() is skipped if any tile went
+// away after the caller took its Epoch(), since the result may come from the old tile.
+class FlightPointCache {
+private:
+    struct Shard {
+        std::shared_mutex mutex;
+        std::unordered_map<uint64_t, std::unordered_map<uint64_t, uint8_t>> tiles;
+    };
+
+    Shard shards[FLIGHT_POINT_CACHE_SHARDS];
+    std::atomic<uint64_t> epoch{ 0 };
+
+    static uint64_t TileKey(int mapId, int gridX, int gridY) {
+        return ((uint64_t)(uint32_t)mapId << 32) | ((uint64_t)(uint16_t)gridX << 16) | (uint64_t)(uint16_t)gridY;
+    }
+
+    static uint64_t TileKeyAt(int mapId, const Vector3& pos) {
+        return TileKey(mapId, (int)std::floor(pos.x / TILE_CACHE_GRID_SIZE), (int)std::floor(pos.y / TILE_CACHE_GRID_SIZE));
+    }
+
+    static uint64_t PointKey(const Vector3& pos, bool allowGroundProximity) {
+        auto q = [](float v) { return (uint64_t)((int64_t)std::lround(v / FLIGHT_POINT_CACHE_RESOLUTION) & 0x1FFFFF); };
+        return (q(pos.x) << 43) | (q(pos.y) << 22) | (q(pos.z) << 1) | (allowGroundProximity ? 1 : 0);
+    }
+
+    Shard& ShardFor(uint64_t tileKey) {
+        return shards[(tileKey ^ (tileKey >> 29)) % FLIGHT_POINT_CACHE_SHARDS];
+    }
+
+    void DropTile(uint64_t tileKey) {
+        Shard& shard = ShardFor(tileKey);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        epoch++;
+        shard.tiles.erase(tileKey);
+    }
+
+public:
+    FlightPointCache() {
+        g_TileResidency.AddRemovalListener([this](const TileResidency& entry) {
+            if (entry.kind == TILE_CACHE_FMAP || entry.kind == TILE_CACHE_NAVMESH) {
+                DropTile(TileKey(entry.mapId, entry.gridX, entry.gridY));
+            }
+        });
+    }
+
+    uint64_t Epoch() const { return epoch; }
+
+    FlightPointState Get(int mapId, const Vector3& pos, bool allowGroundProximity) {
+        uint64_t tileKey = TileKeyAt(mapId, pos);
+        Shard& shard = ShardFor(tileKey);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+        auto tile = shard.tiles.find(tileKey);
+        if (tile != shard.tiles.end()) {
+            auto it = tile->second.find(PointKey(pos, allowGroundProximity));
+            if (it != tile->second.end()) return (FlightPointState)it->second;
+        }
+        return FLIGHT_POINT_UNKNOWN;
+    }
+
+    void Put(int mapId, const Vector3& pos, bool allowGroundProximity, bool valid, uint64_t epochBefore) {
+        uint64_t tileKey = TileKeyAt(mapId, pos);
+        Shard& shard = ShardFor(tileKey);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        if (epoch != epochBefore) return;
+
+        auto& points = shard.tiles[tileKey];
+        if (points.size() >= FLIGHT_POINT_CACHE_MAX_PER_TILE) points.clear();
+        points[PointKey(pos, allowGroundProximity)] = (uint8_t)(valid ? FLIGHT_POINT_VALID : FLIGHT_POINT_BLOCKED);
+    }
+
+    // Runs check() (the real CheckFlightPoint) only on a miss. Counts into the caller's stats.
+    template <typename Fn>
+    bool Check(int mapId, const Vector3& pos, bool allowGroundProximity, FlightPointCacheStats& stats, Fn&& check) {
+        FlightPointState state = Get(mapId, pos, allowGroundProximity);
+        if (state != FLIGHT_POINT_UNKNOWN) {
+            stats.hits++;
+            return state == FLIGHT_POINT_VALID;
+        }
+
+        stats.misses++;
+        uint64_t epochBefore = epoch;
+        bool valid = check();
+        Put(mapId, pos, allowGroundProximity, valid, epochBefore);
+        return valid;
+    }
+};
+
+inline FlightPointCache g_FlightPointCache;
+
 // --- LRU CACHE FOR PATHS ---
 struct PathCacheKey {
     int sx, sy, sz, ex, ey, ez;
@@ -166,25 +558,31 @@ struct PathCacheKey {
     }
 };
 
+// Segments are planned on several threads at once, so every access takes the lock and
+// Get() hands out a copy rather than a pointer into the map.
 class PathCache {
 private:
     std::map<PathCacheKey, std::vector<PathNode>> cache;
     std::list<PathCacheKey> lruList;
     std::map<PathCacheKey, std::list<PathCacheKey>::iterator> lruMap;
+    mutable std::mutex mutex;
 
 public:
-    std::vector<PathNode>* Get(const PathCacheKey& key) {
+    bool Get(const PathCacheKey& key, std::vector<PathNode>& out) {
+        std::lock_guard<std::mutex> lock(mutex);
         auto it = cache.find(key);
-        if (it == cache.end()) return nullptr;
+        if (it == cache.end()) return false;
 
         lruList.erase(lruMap[key]);
         lruList.push_front(key);
         lruMap[key] = lruList.begin();
 
-        return &it->second;
+        out = it->second;
+        return true;
     }
 
     void Put(const PathCacheKey& key, const std::vector<PathNode>& path) {
+        std::lock_guard<std::mutex> lock(mutex);
         if (lruMap.find(key) != lruMap.end()) {
             lruList.erase(lruMap[key]);
             lruMap.erase(key);
@@ -204,12 +602,16 @@ public:
     }
 
     void Clear() {
+        std::lock_guard<std::mutex> lock(mutex);
         cache.clear();
         lruList.clear();
         lruMap.clear();
     }
 
-    size_t Size() const { return cache.size(); }
+    size_t Size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return cache.size();
+    }
 };
 
 static PathCache globalPathCache;
@@ -243,25 +645,505 @@ inline void CleanGroundPath(std::vector<PathNode>& path, int mapId) {
     }
 }
 
-std::vector<PathNode> FindPath(const Vector3& start, const Vector3& end, bool ignoreWater, bool pointAdjust = true, bool zCheck = true, float zExtent = 5.0f, unsigned short extraExcludeFlags = 0);
+std::vector<PathNode> FindPath(const Vector3& start, const Vector3& end, bool ignoreWater, bool pointAdjust = true, bool zCheck = true, float zExtent = 5.0f, const std::unordered_set<dtPolyRef>* avoidPolys = nullptr);
+
+// --- MMAP TILE PACK ---
+// <mapId>.mmpack, written by mmaps_generator (--mmpack true): every tile of a map in
+// one file, so the runtime can map it once and hand Detour pointers straight into it.
+//   header:    "MPAK", uint32 version, uint32 tile count, uint32 directory offset
+//   directory: per tile int32 x, y, layer (Detour tile coords), uint32 offset of its
+//              MmapTileHeader; sorted by (x, y, layer)
+//   blobs:     MmapTileHeader then the Detour tile data, placed so the data starts on a
+//              MMPACK_ALIGNMENT boundary
+const uint32_t MMPACK_VERSION = 1;
+const uint32_t MMPACK_ALIGNMENT = 16;
+
+// Maps a whole .mmpack copy-on-write for as long as the NavMesh uses its tiles. Detour
+// writes a tile's links and polygon link heads into the tile data when it is added, so
+// those pages become private copies; vertices, detail meshes and BV trees stay shared
+// with the file cache and are only paged in when a query touches them.
+class MmapPackFile {
+public:
+    unsigned char* data = nullptr;
+    size_t size = 0;
+    std::string path;
+
+    MmapPackFile() = default;
+    MmapPackFile(const MmapPackFile&) = delete;
+    MmapPackFile& operator=(const MmapPackFile&) = delete;
+    ~MmapPackFile() { Close(); }
+
+    bool Open(const std::string& filepath) {
+        Close();
+#ifdef _WIN32
+        fileHandle = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (fileHandle == INVALID_HANDLE_VALUE) return false;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+            Close();
+            return false;
+        }
+
+        mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+        if (!mappingHandle) {
+            Close();
+            return false;
+        }
+
+        data = (unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_COPY, 0, 0, 0);
+        if (!data) {
+            Close();
+            return false;
+        }
+        size = (size_t)fileSize.QuadPart;
+#else
+        int fd = ::open(filepath.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+
+        void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED) return false;
+
+        data = (unsigned char*)view;
+        size = (size_t)st.st_size;
+#endif
+        path = filepath;
+        return true;
+    }
+
+    void Close() {
+#ifdef _WIN32
+        if (data) UnmapViewOfFile(data);
+        if (mappingHandle) CloseHandle(mappingHandle);
+        if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+        mappingHandle = NULL;
+        fileHandle = INVALID_HANDLE_VALUE;
+#else
+        if (data) munmap(data, size);
+#endif
+        data = nullptr;
+        size = 0;
+        path.clear();
+    }
+
+    bool IsOpen() const { return data != nullptr; }
+
+    static bool IsPack(const std::string& filepath) {
+        return filepath.size() > 7 && filepath.compare(filepath.size() - 7, 7, ".mmpack") == 0;
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mappingHandle = NULL;
+#endif
+};
+
+// --- NAVMESH TILE INDEX ---
+// Where each Detour tile (x, y, layer) of a map lives: file and byte offset of its
+// MmapTileHeader. Built once per map by peeking every .mmtile with the map's prefix,
+// then cached on disk as <directory>/index/<mapId>.mmidx, so LoadMap only opens the
+// files of the tiles it needs. A map with a <mapId>.mmpack is indexed from the pack's
+// own directory instead, and its loose .mmtile files are ignored. The cache is stamped with the directory's write time and
+// rebuilt when tiles are added, removed or renamed. It lives in a subdirectory so that
+// writing one map's index does not touch that stamp for the others.
+// Shared by LoadMap and the TilePrefetcher I/O thread; entries are immutable once built.
+struct MmapTileLocation {
+    std::string file;
+    uint32_t offset;
+};
+
+class MmapTileIndex {
+public:
+    typedef std::map<std::tuple<int, int, int>, MmapTileLocation> Entries; // (x, y, layer)
+
+private:
+    static const uint32_t INDEX_VERSION = 1;
+
+    std::mutex mutex;
+    std::map<std::pair<std::string, int>, std::shared_ptr<const Entries>> maps;
+
+    static std::string MapPrefix(int mapId) {
+        std::stringstream ss;
+        ss << std::setw(4) << std::setfill('0') << mapId;
+        return ss.str();
+    }
+
+    static int64_t DirectoryStamp(const std::string& directory) {
+        std::error_code ec;
+        auto time = std::filesystem::last_write_time(directory, ec);
+        return ec ? 0 : (int64_t)time.time_since_epoch().count();
+    }
+
+    static std::string IndexPath(const std::string& directory, int mapId) {
+        return (std::filesystem::path(directory) / "index" / (MapPrefix(mapId) + ".mmidx")).string();
+    }
+
+    static bool ReadIndex(const std::string& directory, int mapId, int64_t stamp, Entries& entries) {
+        std::ifstream file(IndexPath(directory, mapId), std::ios::binary);
+        if (!file.is_open()) return false;
+
+        char magic[4];
+        uint32_t version = 0, count = 0;
+        int64_t fileStamp = 0;
+        file.read(magic, 4);
+        file.read((char*)&version, sizeof(version));
+        file.read((char*)&fileStamp, sizeof(fileStamp));
+        file.read((char*)&count, sizeof(count));
+        if (!file || memcmp(magic, "MIDX", 4) != 0 || version != INDEX_VERSION || fileStamp != stamp) return false;
+
+        for (uint32_t i = 0; i < count; ++i) {
+            int32_t x, y, layer;
+            uint32_t offset;
+            uint16_t nameLength;
+            file.read((char*)&x, sizeof(x));
+            file.read((char*)&y, sizeof(y));
+            file.read((char*)&layer, sizeof(layer));
+            file.read((char*)&offset, sizeof(offset));
+            file.read((char*)&nameLength, sizeof(nameLength));
+            std::string name(nameLength, '\0');
+            if (nameLength) file.read(&name[0], nameLength);
+            if (!file) return false;
+
+            entries[{ x, y, layer }] = MmapTileLocation{ (std::filesystem::path(directory) / name).string(), offset };
+        }
+        return true;
+    }
+
+    static void WriteIndex(const std::string& directory, int mapId, int64_t stamp, const Entries& entries) {
+        // Written under a temporary name and renamed into place, so a reader never sees half of it
+        std::string path = IndexPath(directory, mapId);
+        std::string temp = path + ".tmp";
+        {
+            std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) return;
+
+            uint32_t version = INDEX_VERSION, count = (uint32_t)entries.size();
+            file.write("MIDX", 4);
+            file.write((const char*)&version, sizeof(version));
+            file.write((const char*)&stamp, sizeof(stamp));
+            file.write((const char*)&count, sizeof(count));
+            for (const auto& pair : entries) {
+                int32_t x = std::get<0>(pair.first), y = std::get<1>(pair.first), layer = std::get<2>(pair.first);
+                std::string name = std::filesystem::path(pair.second.file).filename().string();
+                uint16_t nameLength = (uint16_t)name.size();
+                file.write((const char*)&x, sizeof(x));
+                file.write((const char*)&y, sizeof(y));
+                file.write((const char*)&layer, sizeof(layer));
+                file.write((const char*)&pair.second.offset, sizeof(pair.second.offset));
+                file.write((const char*)&nameLength, sizeof(nameLength));
+                file.write(name.data(), nameLength);
+            }
+            if (!file) return;
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(temp, path, ec);
+        if (ec) std::filesystem::remove(temp, ec);
+    }
+
+    static bool ReadPackDirectory(const std::string& directory, int mapId, Entries& entries) {
+        std::string packPath = (std::filesystem::path(directory) / (MapPrefix(mapId) + ".mmpack")).string();
+        std::ifstream file(packPath, std::ios::binary);
+        if (!file.is_open()) return false;
+
+        char magic[4];
+        uint32_t version = 0, count = 0, directoryOffset = 0;
+        file.read(magic, 4);
+        file.read((char*)&version, sizeof(version));
+        file.read((char*)&count, sizeof(count));
+        file.read((char*)&directoryOffset, sizeof(directoryOffset));
+        if (!file || memcmp(magic, "MPAK", 4) != 0 || version != MMPACK_VERSION) return false;
+
+        std::vector<int32_t> records((size_t)count * 4);
+        file.seekg(directoryOffset);
+        if (count && !file.read((char*)&records[0], records.size() * sizeof(int32_t))) return false;
+
+        for (uint32_t i = 0; i < count; ++i) {
+            const int32_t* record = &records[(size_t)i * 4];
+            entries[{ record[0], record[1], record[2] }] = MmapTileLocation{ packPath, (uint32_t)record[3] };
+        }
+        return true;
+    }
+
+    static void ScanDirectory(const std::string& directory, int mapId, Entries& entries) {
+        std::string prefix = MapPrefix(mapId);
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+            if (entry.path().filename().string().find(prefix) != 0 || entry.path().extension() != ".mmtile") continue;
+
+            std::ifstream file(entry.path(), std::ios::binary);
+            MmapTileHeader mmapHeader;
+            dtMeshHeader dtHeader;
+            if (!file.read((char*)&mmapHeader, sizeof(MmapTileHeader)) || !file.read((char*)&dtHeader, sizeof(dtMeshHeader))) continue;
+
+            entries[{ dtHeader.x, dtHeader.y, dtHeader.layer }] = MmapTileLocation{ entry.path().string(), 0 };
+        }
+    }
+
+public:
+    // The index of mapId in directory, building (and caching on disk) it the first time.
+    // Null if the directory does not exist.
+    std::shared_ptr<const Entries> Get(const std::string& directory, int mapId) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = maps.find({ directory, mapId });
+        if (found != maps.end()) return found->second;
+
+        std::error_code ec;
+        if (!std::filesystem::exists(directory, ec)) return nullptr;
+
+        // Creating the index directory changes the stamp, so it has to come first
+        std::filesystem::create_directories(std::filesystem::path(IndexPath(directory, mapId)).parent_path(), ec);
+
+        std::shared_ptr<Entries> entries = std::make_shared<Entries>();
+        int64_t stamp = DirectoryStamp(directory);
+        if (ReadPackDirectory(directory, mapId, *entries)) {
+            if (DEBUG_PATHFINDING) {
+                PathLog() << "[NavMesh] Map " << mapId << ": " << entries->size() << " tiles in " << MapPrefix(mapId) << ".mmpack" << std::endl;
+            }
+        }
+        else if (!ReadIndex(directory, mapId, stamp, *entries)) {
+            entries->clear();
+            ScanDirectory(directory, mapId, *entries);
+            WriteIndex(directory, mapId, stamp, *entries);
+            if (DEBUG_PATHFINDING) {
+                PathLog() << "[NavMesh] Indexed " << entries->size() << " tiles of map " << mapId << " in " << directory << std::endl;
+            }
+        }
+
+        maps[{ directory, mapId }] = entries;
+        return entries;
+    }
+
+    // Calls fn(key, location) for every layer of tile (x, y)
+    template <typename Fn>
+    static void ForEachLayer(const Entries& entries, int x, int y, Fn fn) {
+        for (auto it = entries.lower_bound({ x, y, INT_MIN }); it != entries.end() && std::get<0>(it->first) == x && std::get<1>(it->first) == y; ++it) {
+            fn(it->first, it->second);
+        }
+    }
+
+    // Forgets the in-memory copies, e.g. after the mmaps were regenerated
+    void Reset() {
+        std::lock_guard<std::mutex> lock(mutex);
+        maps.clear();
+    }
+};
+
+// --- NAVMESH LOCK ---
+// Reader/writer lock around globalNavMesh. Searches hold it shared, so ground paths,
+// reachability checks and flight planning can run on several threads at once; adding,
+// removing or re-flagging tiles holds it exclusive. Re-entrant on one thread: a shared
+// request inside an exclusive hold is a no-op. An exclusive hold taken at the top level
+// can be downgraded to shared without another writer getting in between, which is how
+// CalculatePath keeps the tiles it just loaded while it plans on them.
+// Shared requests queue behind waiting writers, except on the main loop (MarkTickThread):
+// its reads are short, and a worker waiting to load tiles while another one is in the
+// middle of a long search must not stall the tick until both are done.
+// Asking for exclusive while only holding shared deadlocks; nothing does that.
+class NavMeshRWLock {
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    int readers = 0;
+    int writersWaiting = 0;
+    bool writer = false;
+
+    // Per thread; there is only the one lock
+    static inline thread_local int writeDepth = 0;
+    static inline thread_local int readDepth = 0;
+    static inline thread_local bool ownsShared = false;
+    static inline thread_local bool tickThread = false;
+
+public:
+    void MarkTickThread() { tickThread = true; }
+
+    void lock() {
+        if (writeDepth > 0) { ++writeDepth; return; }
+        std::unique_lock<std::mutex> lk(mutex);
+        ++writersWaiting;
+        cv.wait(lk, [&]() { return !writer && readers == 0; });
+        --writersWaiting;
+        writer = true;
+        writeDepth = 1;
+    }
+
+    bool try_lock() {
+        if (writeDepth > 0) { ++writeDepth; return true; }
+        if (readDepth > 0) return false;
+        std::lock_guard<std::mutex> lk(mutex);
+        if (writer || readers > 0) return false;
+        writer = true;
+        writeDepth = 1;
+        return true;
+    }
+
+    void unlock() {
+        if (--writeDepth > 0) return;
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            writer = false;
+        }
+        cv.notify_all();
+    }
+
+    void lock_shared() {
+        if (readDepth++ > 0 || writeDepth > 0) return;
+        std::unique_lock<std::mutex> lk(mutex);
+        // Writers first, or a steady stream of searches would starve LoadMap. The tick's
+        // brief reads don't keep a writer out for long, so they don't queue.
+        cv.wait(lk, [&]() { return !writer && (writersWaiting == 0 || tickThread); });
+        ++readers;
+        ownsShared = true;
+    }
+
+    void unlock_shared() {
+        if (--readDepth > 0 || !ownsShared) return;
+        ownsShared = false;
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            --readers;
+        }
+        cv.notify_all();
+    }
+
+    // For a thread working on behalf of one that holds the lock and waits for it: its
+    // own shared requests become no-ops instead of queueing behind a waiting writer.
+    void BorrowShared() { ++readDepth; }
+    void ReturnShared() { --readDepth; }
+
+    // Trades a top-level exclusive hold for a shared one; nested holds stay exclusive
+    std::shared_lock<NavMeshRWLock> Downgrade(std::unique_lock<NavMeshRWLock>& held) {
+        if (writeDepth != 1 || readDepth != 0) return std::shared_lock<NavMeshRWLock>(*this);
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            writer = false;
+            ++readers;
+        }
+        writeDepth = 0;
+        readDepth = 1;
+        ownsShared = true;
+        held.release();
+        cv.notify_all();
+        return std::shared_lock<NavMeshRWLock>(*this, std::adopt_lock);
+    }
+};
+
+typedef std::shared_lock<NavMeshRWLock> NavMeshReadLock;
+typedef std::unique_lock<NavMeshRWLock> NavMeshWriteLock;
+
+// --- NAVMESH QUERY POOL ---
+// One dtNavMeshQuery per thread, bound to the shared dtNavMesh. A query keeps only the
+// mesh pointer and its own node pool, so tiles coming and going need no re-init (their
+// refs carry salts, and the pool is reset per search); only a new dtNavMesh does. Each
+// slot remembers the mesh generation it was bound to and re-inits on first use after
+// Rebind(). Slots are kept until the pool goes away, one per thread that ever searched.
+class NavMeshQueryPool {
+private:
+    struct Slot {
+        dtNavMeshQuery* query = nullptr;
+        const dtNavMesh* mesh = nullptr;
+        uint64_t generation = 0;
+    };
+
+    std::mutex mutex;
+    std::map<std::thread::id, std::unique_ptr<Slot>> slots;
+    std::atomic<uint64_t> generation{ 1 };
+    int maxNodes;
+
+    Slot* ThreadSlot() {
+        static thread_local NavMeshQueryPool* cachedPool = nullptr;
+        static thread_local Slot* cachedSlot = nullptr;
+        if (cachedPool == this) return cachedSlot;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        std::unique_ptr<Slot>& slot = slots[std::this_thread::get_id()];
+        if (!slot) slot.reset(new Slot());
+        cachedPool = this;
+        cachedSlot = slot.get();
+        return cachedSlot;
+    }
+
+public:
+    explicit NavMeshQueryPool(int maxNodes_) : maxNodes(maxNodes_) {}
+    ~NavMeshQueryPool() {
+        for (auto& entry : slots) dtFreeNavMeshQuery(entry.second->query);
+    }
+
+    // The calling thread's query, bound to mesh; nullptr without a mesh or on failure
+    dtNavMeshQuery* Get(const dtNavMesh* mesh) {
+        if (!mesh) return nullptr;
+        Slot* slot = ThreadSlot();
+        uint64_t current = generation;
+        if (slot->query && slot->mesh == mesh && slot->generation == current) return slot->query;
+
+        if (!slot->query) slot->query = dtAllocNavMeshQuery();
+        if (!slot->query || dtStatusFailed(slot->query->init(mesh, maxNodes))) {
+            slot->mesh = nullptr;
+            return nullptr;
+        }
+        slot->mesh = mesh;
+        slot->generation = current;
+        return slot->query;
+    }
+
+    // The mesh was rebuilt or freed; every thread re-inits its query on next use
+    void Rebind() { generation++; }
+};
 
 class NavMesh {
 public:
     dtNavMesh* mesh = nullptr;
-    dtNavMeshQuery* query = nullptr;
+    NavMeshQueryPool queries{ 65535 };
     int currentMapId = -1;
     std::set<std::tuple<int, int, int>> loadedTiles; // Tracks loaded tile coordinates (x, y, layer)
+    std::map<std::tuple<int, int, int>, TileResidencyPtr> tileResidency;
+    MmapTileIndex tileIndex;
+    MmapPackFile pack;  // The current map's .mmpack, if it has one; its tiles point into it
+
+    NavMesh() {}
+    ~NavMesh() { dtFreeNavMesh(mesh); DropStagedTiles(); }
 
-    NavMesh() { query = dtAllocNavMeshQuery(); }
-    ~NavMesh() { dtFreeNavMesh(mesh); dtFreeNavMeshQuery(query); }
+    // This thread's query on the current mesh. Callers hold g_NavMeshMutex (shared is enough).
+    dtNavMeshQuery* Query() { return queries.Get(mesh); }
 
     void Clear() {
         dtFreeNavMesh(mesh); mesh = nullptr;
-        dtFreeNavMeshQuery(query); query = nullptr;
+        queries.Rebind();
+        pack.Close(); // Only once no tile points into it
         currentMapId = -1;
         globalPathCache.Clear();
 
         loadedTiles.clear();
+        tileResidency.clear();
+        g_TileResidency.RemoveAll(TILE_CACHE_NAVMESH);
+    }
+
+    static uint64_t PackTileKey(int x, int y, int layer) {
+        return ((uint64_t)(uint32_t)x << 32) | ((uint64_t)(uint16_t)y << 16) | (uint64_t)(uint16_t)layer;
+    }
+
+    // Residency manager evictor. Only ever run from Trim() with g_NavMeshMutex held.
+    bool EvictTile(uint64_t key) {
+        int x = (int)(uint32_t)(key >> 32);
+        int y = (int)(uint16_t)(key >> 16);
+        int layer = (int)(uint16_t)key;
+
+        if (mesh) {
+            dtTileRef ref = mesh->getTileRefAt(x, y, layer);
+            if (ref) mesh->removeTile(ref, nullptr, nullptr); // DT_TILE_FREE_DATA: Detour frees the data
+        }
+        loadedTiles.erase({ x, y, layer });
+        tileResidency.erase({ x, y, layer });
+        return true;
     }
 
     // Use FMap for precise floor height
@@ -278,11 +1160,12 @@ public:
             return fmapHeight;
         }
         /*if (fabs(fmapHeight - pos.z) > clearance) {
-            g_LogFile << fabs(fmapHeight - pos.z) << std::endl;
+            PathLog() << fabs(fmapHeight - pos.z) << std::endl;
             return -99999.0f;
         }*/
 
         // Fallback to NavMesh if FMap unavailable
+        dtNavMeshQuery* query = Query();
         if (!query || !mesh) return -99999.0f;
         float center[3] = { pos.y, pos.z, pos.x };
         float extent[3] = { 10.0f, 20.0f, 10.0f };
@@ -298,6 +1181,7 @@ public:
 
     // BFS Search to find the nearest OUTDOOR polygon
     Vector3 FindFlyableExit(const Vector3& startPos, int mapId, float maxRadius = 200.0f) {
+        dtNavMeshQuery* query = Query();
         if (!mesh || !query) return Vector3(0, 0, 0);
 
         // Recast uses (Y, Z, X) coordinates usually, but let's stick to your Vector3 usage
@@ -391,10 +1275,11 @@ public:
     // pushes waypoints away from walls if they are too close.
     // bufferDist: Desired clearance in yards (e.g., 0.8f for humanoids)
     void RefinePathClearance(std::vector<PathNode>& path, float bufferDist, int mapId) {
+        dtNavMeshQuery* query = Query();
         if (!query || !mesh || path.size() < 3) return;
 
         if (DEBUG_PATHFINDING) {
-            g_LogFile << "[RefinePath] Checking wall clearance..." << std::endl;
+            PathLog() << "[RefinePath] Checking wall clearance..." << std::endl;
         }
 
         dtQueryFilter filter;
@@ -478,7 +1363,7 @@ public:
         }
 
         if (DEBUG_PATHFINDING && nanCount > 0) {
-            g_LogFile << "[RefinePath] " << nanCount << "/" << (path.size() - 2)
+            PathLog() << "[RefinePath] " << nanCount << "/" << (path.size() - 2)
                       << " waypoints skipped wall-nudge (open terrain / tile boundary)." << std::endl;
         }
     }
@@ -498,13 +1383,16 @@ public:
             return false;
         }
 
-        // 1. Check Core (Center to Head)
-        if (CheckFMapLine(mapId, pos.x, pos.y, pos.z, pos.x, pos.y, pos.z + 2.5f, false)) {
-            return false;
-        }
-        // 2. Check Feet (Center to Feet)
-        if (CheckFMapLine(mapId, pos.x, pos.y, pos.z, pos.x, pos.y, pos.z - 0.5f, false)) {
-            return false;
+        // A clear sphere around the body covers both probes below
+        if (!IsFMapSphereClear(mapId, pos.x, pos.y, pos.z + 1.0f, 2.0f)) {
+            // 1. Check Core (Center to Head)
+            if (CheckFMapLine(mapId, pos.x, pos.y, pos.z, pos.x, pos.y, pos.z + 2.5f, false)) {
+                return false;
+            }
+            // 2. Check Feet (Center to Feet)
+            if (CheckFMapLine(mapId, pos.x, pos.y, pos.z, pos.x, pos.y, pos.z - 0.5f, false)) {
+                return false;
+            }
         }
 
         // Check for collision in a small sphere around the point
@@ -575,6 +1463,7 @@ public:
     // Finds the nearest connected polygon center that has clear sky above it.
     // Replaces geometric spiral searches for launch/landing spots.
     Vector3 FindNearestClearSkyPoint(const Vector3& startPos, int mapId, float maxRadius = 150.0f) {
+        dtNavMeshQuery* query = Query();
         if (!mesh || !query) return Vector3(0, 0, 0);
 
         float center[3] = { startPos.y, startPos.z, startPos.x }; // WoW -> Recast
@@ -724,10 +1613,11 @@ public:
         // tileGridSize=2 means checking a small area around. heightLimit=2.5f means drops > 2.5y are "cliffs".
         // We check slightly above the node (z+0.5) to ensure we are querying above the floor.
         if (CheckSurroundingTiles(mapId, nodePos.x, nodePos.y, nodePos.z, 2, 4.0f)) {
-            g_LogFile << nodePos.x << " " << nodePos.y << " " << nodePos.z << std::endl;
+            PathLog() << nodePos.x << " " << nodePos.y << " " << nodePos.z << std::endl;
             return nodePos;
         }
 
+        dtNavMeshQuery* query = Query();
         if (!mesh || !query) return nodePos;
 
         // Recast uses (Y, Z, X) coordinates usually.
@@ -786,7 +1676,7 @@ public:
             // 2. Safety Check on this Polygon
             // We check the center of the polygon.
             if (CheckSurroundingTiles(mapId, polyCenter.x, polyCenter.y, polyCenter.z, 2, 4.0f)) {
-                g_LogFile << polyCenter.x << " " << polyCenter.y << " " << polyCenter.z << std::endl;
+                PathLog() << polyCenter.x << " " << polyCenter.y << " " << polyCenter.z << std::endl;
                 return polyCenter; // Found a safe spot!
             }
 
@@ -882,52 +1772,65 @@ public:
         }
         Vector3 actualEnd = Vector3{ -36.8802f, 5284.5f, 24.4288f };
         if (actualEnd.Dist3D(end) < 10.0f) {
-            g_LogFile << "Start: " << start.x << " " << start.y << " " << start.z << " | End: " << end.x << " " << end.y << " " << end.z << " " << std::endl;
+            PathLog() << "Start: " << start.x << " " << start.y << " " << start.z << " | End: " << end.x << " " << end.y << " " << end.z << " " << std::endl;
             verbose = 1;
         }
 
+        // Build the whole ray bundle and check it in one batch. Segments are queued in the
+        // order they used to be checked one by one, so the first blocked entry is the ray
+        // that would have failed first.
+        const int maxSegments = 18; // 9 rays x (CENTER + HEAD-TOP)
+        float segX1[maxSegments], segY1[maxSegments], segZ1[maxSegments];
+        float segX2[maxSegments], segY2[maxSegments], segZ2[maxSegments];
+        int segRay[maxSegments];
+        const char* segName[maxSegments];
+        int numSegments = 0;
+
+        auto addSegment = [&](const Vector3& a, const Vector3& b, int ray, const char* name) {
+            segX1[numSegments] = a.x; segY1[numSegments] = a.y; segZ1[numSegments] = a.z;
+            segX2[numSegments] = b.x; segY2[numSegments] = b.y; segZ2[numSegments] = b.z;
+            segRay[numSegments] = ray;
+            segName[numSegments] = name;
+            numSegments++;
+        };
+
+        bool skipGroundProximity = skipCollisionDist > 0.0f && totalDist > skipCollisionDist;
+
         for (int i = 0; i < numRays; ++i) {
             //Vector3 s = start + offsets[i];
             Vector3 s = start;
             Vector3 e = end + offsets[i];
-            if (debug) g_LogFile << "Start: " << s.x << " " << s.y << " " << s.z << " | " << "End: " << e.x << " " << e.y << " " << e.z << " | " << "Offsets: " << offsets[i].x << " " << offsets[i].y << " " << offsets[i].z << std::endl;
+            if (debug) PathLog() << "Start: " << s.x << " " << s.y << " " << s.z << " | " << "End: " << e.x << " " << e.y << " " << e.z << " | " << "Offsets: " << offsets[i].x << " " << offsets[i].y << " " << offsets[i].z << std::endl;
 
             // 1. GROUND PROXIMITY CHECK (Existing logic)
-            if (skipCollisionDist > 0.0f && totalDist > skipCollisionDist) {
+            if (skipGroundProximity) {
                 Vector3 clearancePoint = start + (forward * skipCollisionDist);
-                if (CheckFMapLine(mapId, clearancePoint.x + offsets[i].x,
-                    clearancePoint.y + offsets[i].y,
-                    clearancePoint.z + offsets[i].z,
-                    e.x, e.y, e.z, debug)) return SEGMENT_COLLISION;
+                addSegment(clearancePoint + offsets[i], e, i, "GROUND-SKIP");
             }
             // 2. OBSTACLE CHECK
-            else if (skipCollisionDist == 0.0f || totalDist <= skipCollisionDist) {
-                // 1. CENTER
-                if (CheckFMapLine(mapId, s.x, s.y, s.z, e.x, e.y, e.z, debug)) {
-                    if (verbose && DEBUG_PATHFINDING) g_LogFile << "      FAIL: Ray " << i << " CENTER hit obstacle." << std::endl;
-                    return SEGMENT_COLLISION;
-                }
-                //// 2. FEET (Bottom) - Critical for ground clipping
-                //if (CheckFMapLine(mapId, s.x, s.y, s.z + feetBot, e.x, e.y, e.z + feetBot)) {
-                //    if (verbose && DEBUG_PATHFINDING) g_LogFile << "      FAIL: Ray " << i << " FEET hit obstacle." << std::endl;
-                //    return SEGMENT_COLLISION;
-                //}
-                //// 3. KNEES (Gap Filler)
-                //if (CheckFMapLine(mapId, s.x, s.y, s.z + knees, e.x, e.y, e.z + knees)) {
-                //    if (verbose && DEBUG_PATHFINDING) g_LogFile << "      FAIL: Ray " << i << " KNEES hit obstacle." << std::endl;
-                //    return SEGMENT_COLLISION;
-                //}
-                //// 4. HEAD MID
-                //if (CheckFMapLine(mapId, s.x, s.y, s.z + headMid, e.x, e.y, e.z + headMid)) {
-                //    if (verbose && DEBUG_PATHFINDING) g_LogFile << "      FAIL: Ray " << i << " HEAD-MID hit obstacle." << std::endl;
-                //    return SEGMENT_COLLISION;
-                //}
-                // 5. HEAD TOP
-                if (CheckFMapLine(mapId, s.x, s.y, s.z + headTop, e.x, e.y, e.z + headTop, debug)) {
-                    if (verbose && DEBUG_PATHFINDING) g_LogFile << "      FAIL: Ray " << i << " HEAD-TOP hit obstacle." << std::endl;
-                    return SEGMENT_COLLISION;
-                }
+            else {
+                // CENTER, then HEAD TOP
+                addSegment(s, e, i, "CENTER");
+                addSegment(Vector3(s.x, s.y, s.z + headTop), Vector3(e.x, e.y, e.z + headTop), i, "HEAD-TOP");
+            }
+        }
+
+        // Every ray above stays within 1.21r of the start->end axis and 1 yard of its
+        // mid-height (plus the half-yard column margin the line walk adds), so a clear
+        // capsule around that axis means none of them can hit.
+        float bundleRadius = checkRadius * 1.21f + 1.5f;
+        bool bundleClear = IsFMapCapsuleClear(mapId, start.x, start.y, start.z + 1.0f,
+            end.x, end.y, end.z + 1.0f, bundleRadius);
+
+        uint32_t blockedMask = 0;
+        if (!bundleClear && CheckFMapLines(mapId, numSegments, segX1, segY1, segZ1, segX2, segY2, segZ2,
+            &blockedMask, nullptr, true, debug) > 0) {
+            if (verbose && DEBUG_PATHFINDING) {
+                int hit = 0;
+                while (hit < numSegments && !(blockedMask & (1u << hit))) ++hit;
+                PathLog() << "      FAIL: Ray " << segRay[hit] << " " << segName[hit] << " hit obstacle." << std::endl;
             }
+            return SEGMENT_COLLISION;
         }
 
         // --- STEPPED CHECKS (Ground Clearance / No Fly Zone) ---
@@ -974,7 +1877,7 @@ public:
                 if (pt.z < limit) {
                     outFailPos = pt;
                     if (verbose) {
-                        g_LogFile << "      FAIL: Too close to ground (Z=" << pt.z << " < Limit=" << limit
+                        PathLog() << "      FAIL: Too close to ground (Z=" << pt.z << " < Limit=" << limit
                             << ") at dist " << distFromStart << " | " << pt.x << " " << pt.y << " " << pt.z << std::endl;
                     }
                     return SEGMENT_COLLISION;
@@ -1001,16 +1904,53 @@ public:
         ty = (int)std::floor((pos.x - originZ) / tileWidth);
     }
 
-    bool LoadMap(const std::string& directory, int mapId, const std::vector<Vector3>* path = nullptr, bool sparseLoad = true) {
-        if (loadedTiles.size() > 50) {
-            if (DEBUG_PATHFINDING) {
-                g_LogFile << "[Memory] Pruning NavMesh tiles (Limit reached)" << std::endl;
+    // Drops every loaded tile more than NAVMESH_KEEP_DISTANCE tiles (Chebyshev) from all of
+    // the given points (the player and active route), one removeTile each; the rest of the
+    // mesh stays linked. Tiles pinned in g_TileResidency, e.g. for the last path request,
+    // are kept too. Needs the NavMesh write lock.
+    void EvictFarTiles(int mapId, const std::vector<Vector3>& points) {
+        if (!mesh || mapId != currentMapId) return;
+
+        std::vector<std::pair<int, int>> cells;
+        for (const auto& pt : points) {
+            int tx, ty;
+            GetTileCoords(pt, tx, ty);
+            cells.push_back({ tx, ty });
+        }
+        std::sort(cells.begin(), cells.end());
+        cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+        std::vector<std::tuple<int, int, int>> far;
+        for (const auto& tile : loadedTiles) {
+            bool near = false;
+            for (const auto& cell : cells) {
+                if (std::abs(std::get<0>(tile) - cell.first) <= NAVMESH_KEEP_DISTANCE &&
+                    std::abs(std::get<1>(tile) - cell.second) <= NAVMESH_KEEP_DISTANCE) {
+                    near = true;
+                    break;
+                }
             }
-            Clear();
-            // Force re-initialization logic below to run
-            currentMapId = -1;
+            if (near) continue;
+            auto res = tileResidency.find(tile);
+            if (res != tileResidency.end() && g_TileResidency.IsPinned(res->second)) continue;
+            far.push_back(tile);
+        }
+
+        for (const auto& tile : far) {
+            uint64_t key = PackTileKey(std::get<0>(tile), std::get<1>(tile), std::get<2>(tile));
+            g_TileResidency.Remove(TILE_CACHE_NAVMESH, key);
+            EvictTile(key);
+        }
+        if (DEBUG_PATHFINDING && !far.empty()) {
+            PathLog() << "[NavMesh] Dropped " << far.size() << " far tiles, " << loadedTiles.size() << " still loaded" << std::endl;
         }
+    }
 
+    // The mesh and query live for as long as we stay on one map: tiles are linked in with
+    // addTile as routes need them and unlinked one at a time with removeTile, either far
+    // from the player and route (EvictFarTiles, from the main loop) or least recently
+    // used under the tile budget (TileResidencyManager). Only a map change rebuilds the mesh.
+    bool LoadMap(const std::string& directory, int mapId, const std::vector<Vector3>* path = nullptr, bool sparseLoad = true) {
         bool isNewMap = (currentMapId != mapId);
 
         // If map ID changed, we must clear everything
@@ -1018,7 +1958,7 @@ public:
             Clear();
         }
         // If map ID is the same, but we don't have a mesh, also clear/reinit
-        else if (!mesh || !query) {
+        else if (!mesh) {
             Clear();
             isNewMap = true;
         }
@@ -1042,14 +1982,12 @@ public:
                 return false;
             }
 
-            query = dtAllocNavMeshQuery();
-            if (!query) {
-                dtFreeNavMesh(mesh);
-                mesh = nullptr;
-                return false;
-            }
+            // Each thread's query binds to the new mesh on its next search; tiles added
+            // or removed later need no re-init
+            queries.Rebind();
 
             currentMapId = mapId;
+            g_TileResidency.SetEvictor(TILE_CACHE_NAVMESH, [this](uint64_t key) { return EvictTile(key); });
         }
 
         // Determine which tiles we need
@@ -1070,117 +2008,184 @@ public:
             }
         }
 
-        std::stringstream ss;
-        ss << std::setw(4) << std::setfill('0') << mapId;
-        std::string prefix = ss.str();
-
-        int tilesLoadedCount = 0;
-
-        // SAFETY CHECK: Ensure directory exists before iterating
-        if (!std::filesystem::exists(directory)) return false;
-
-        for (const auto& entry : std::filesystem::directory_iterator(directory)) {
-            if (entry.path().filename().string().find(prefix) == 0 &&
-                entry.path().extension() == ".mmtile") {
-
-                // If we are loading all, just add it if not loaded (though 'loadAll' usually implies fresh start,
-                // we check loadedTiles to support incremental full load if ever needed)
-                // However, optimization: if loading ALL and isNewMap, we skip the peek check for speed? 
-                // No, sticking to robust check.
-
-                // If sparse loading, we must check if this file matches our needed coordinates.
-                // We peek the header to get coordinates without loading the whole file.
-                if (!loadAll) {
-                    std::ifstream file(entry.path().string(), std::ios::binary);
-                    if (file.is_open()) {
-                        MmapTileHeader mmapHeader;
-                        file.read((char*)&mmapHeader, sizeof(MmapTileHeader));
-                        dtMeshHeader dtHeader;
-                        file.read((char*)&dtHeader, sizeof(dtMeshHeader));
-                        file.close();
-
-                        // Check if this tile is needed
-                        if (neededTiles.count({ dtHeader.x, dtHeader.y })) {
-                            // Only load if not already loaded (keyed by x,y,layer to support multi-layer tiles)
-                            if (loadedTiles.find({ dtHeader.x, dtHeader.y, dtHeader.layer }) == loadedTiles.end()) {
-                                if (AddTile(entry.path().string())) {
-                                    loadedTiles.insert({ dtHeader.x, dtHeader.y, dtHeader.layer });
-                                    tilesLoadedCount++;
-                                }
-                            }
-                        }
-                    }
-                }
-                else {
-                    // Load ALL mode: We still check loadedTiles to avoid duplicates if called incrementally
-                    // (But usually LoadAll is done on fresh map).
-                    // We can't easily know coords without peeking, so we just try AddTile.
-                    // Actually, AddTile duplicates might be rejected by Detour, but let's be safe.
-                    // To be strictly correct with 'loadedTiles' set maintenance, we should peek.
-                    // But for 'LoadAll' performance, we might skip peeking if we know it's a fresh map.
-
-                    if (isNewMap) {
-                        std::ifstream file(entry.path().string(), std::ios::binary);
-                        if (file.is_open()) {
-                            MmapTileHeader mmapHeader;
-                            file.read((char*)&mmapHeader, sizeof(MmapTileHeader));
-                            dtMeshHeader dtHeader;
-                            file.read((char*)&dtHeader, sizeof(dtMeshHeader));
-                            file.close();
-
-                            if (AddTile(entry.path().string())) {
-                                loadedTiles.insert({ dtHeader.x, dtHeader.y, dtHeader.layer });
-                            }
-                        }
-                    }
-                    else {
-                        // Incremental Load All? Unusual case. Just assume checking.
-                        // Implementation for simplicity: Just peek and load if missing.
-                        std::ifstream file(entry.path().string(), std::ios::binary);
-                        if (file.is_open()) {
-                            MmapTileHeader mmapHeader;
-                            file.read((char*)&mmapHeader, sizeof(MmapTileHeader));
-                            dtMeshHeader dtHeader;
-                            file.read((char*)&dtHeader, sizeof(dtMeshHeader));
-                            file.close();
-
-                            if (loadedTiles.find({ dtHeader.x, dtHeader.y, dtHeader.layer }) == loadedTiles.end()) {
-                                if (AddTile(entry.path().string())) {
-                                    loadedTiles.insert({ dtHeader.x, dtHeader.y, dtHeader.layer });
-                                }
-                            }
-                        }
-                    }
-                }
+        // SAFETY CHECK: Ensure directory exists (and its tile index is built)
+        std::shared_ptr<const MmapTileIndex::Entries> index = tileIndex.Get(directory, mapId);
+        if (!index) return false;
+
+        auto loadTile = [&](const std::tuple<int, int, int>& key, const MmapTileLocation& location) {
+            if (loadedTiles.find(key) == loadedTiles.end()) {
+                if (AddTile(location.file, location.offset)) loadedTiles.insert(key);
+            }
+            else {
+                auto res = tileResidency.find(key);
+                if (res != tileResidency.end()) g_TileResidency.Touch(res->second);
+            }
+        };
+
+        if (!loadAll) {
+            // Only the files of the tiles we need (every layer of each)
+            for (const auto& tile : neededTiles) {
+                MmapTileIndex::ForEachLayer(*index, tile.first, tile.second, loadTile);
             }
         }
+        else {
+            for (const auto& pair : *index) loadTile(pair.first, pair.second);
+        }
 
-        // If we loaded new tiles or reset the map, we need to init the query
-        // dtNavMeshQuery::init can be called safely to reset/update
-        if (dtStatusFailed(query->init(mesh, 65535))) return false;
-        currentMapId = mapId;
+        // Stay under the tile memory budget. Tiles around the requested path are pinned
+        // first so the ones we just asked for are never the ones evicted; this replaces
+        // only the previous request's pins, never the route's. Dropping tiles the route
+        // has left behind is up to the main loop (EvictFarTiles), which knows where the
+        // player and the active route are.
+        if (!loadAll) {
+            g_TileResidency.PinRoute(TILE_PIN_REQUEST, mapId, *path);
+        }
+        g_TileResidency.Trim(TILE_CACHE_MASK_ALL);
         return true;
     }
 
-    bool AddTile(const std::string& filepath) {
+    // --- STAGED TILES ---
+    // Whole .mmtile files read ahead of time by the TilePrefetcher I/O thread, keyed by
+    // path. AddTile uses these instead of going to disk.
+    // Only the staging table is shared with that thread; the mesh itself is guarded by g_NavMeshMutex.
+    struct StagedTile {
+        MmapTileHeader header;
+        unsigned char* data;   // dtAlloc'd; ownership passes to the mesh in AddTile
+    };
+    std::mutex stagedMutex;
+    std::map<std::string, StagedTile> stagedTiles;
+    std::deque<std::string> stagedOrder; // Oldest first
+
+    // Called from the prefetch thread
+    bool StageTileFile(const std::string& filepath) {
+        {
+            std::lock_guard<std::mutex> lock(stagedMutex);
+            if (stagedTiles.count(filepath)) return true;
+        }
+
         std::ifstream file(filepath, std::ios::binary);
         if (!file.is_open()) return false;
 
         MmapTileHeader header;
-        file.read((char*)&header, sizeof(MmapTileHeader));
+        if (!file.read((char*)&header, sizeof(MmapTileHeader)) || header.size < sizeof(dtMeshHeader)) return false;
+
         unsigned char* data = (unsigned char*)dtAlloc(header.size, DT_ALLOC_PERM);
-        file.read((char*)data, header.size);
+        if (!data) return false;
+        if (!file.read((char*)data, header.size)) {
+            dtFree(data);
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(stagedMutex);
+        if (stagedTiles.count(filepath)) {
+            dtFree(data); // Staged by someone else meanwhile
+            return true;
+        }
+        stagedTiles[filepath] = StagedTile{ header, data };
+        stagedOrder.push_back(filepath);
+
+        // Cap memory held by tiles nobody has asked for yet
+        while (stagedOrder.size() > MAX_STAGED_TILES) {
+            auto it = stagedTiles.find(stagedOrder.front());
+            if (it != stagedTiles.end()) {
+                dtFree(it->second.data);
+                stagedTiles.erase(it);
+            }
+            stagedOrder.pop_front();
+        }
+        return true;
+    }
+
+    // Hands a staged tile over to the caller (who then owns data)
+    bool TakeStagedTile(const std::string& filepath, MmapTileHeader& header, unsigned char*& data) {
+        std::lock_guard<std::mutex> lock(stagedMutex);
+        auto it = stagedTiles.find(filepath);
+        if (it == stagedTiles.end()) return false;
+
+        header = it->second.header;
+        data = it->second.data;
+        stagedTiles.erase(it);
+        stagedOrder.erase(std::remove(stagedOrder.begin(), stagedOrder.end(), filepath), stagedOrder.end());
+        return true;
+    }
+
+    void DropStagedTiles() {
+        std::lock_guard<std::mutex> lock(stagedMutex);
+        for (auto& pair : stagedTiles) dtFree(pair.second.data);
+        stagedTiles.clear();
+        stagedOrder.clear();
+    }
+
+    // Links a tile of the current map's .mmpack straight from the mapping; Detour doesn't
+    // own the data, so removeTile leaves it and Clear() unmaps it with the mesh
+    bool AddPackedTile(const std::string& filepath, uint32_t offset) {
+        if (pack.path != filepath) {
+            if (pack.IsOpen() || !pack.Open(filepath)) return false; // One pack per map
+        }
+        if ((uint64_t)offset + sizeof(MmapTileHeader) > pack.size) return false;
+
+        MmapTileHeader header;
+        memcpy(&header, pack.data + offset, sizeof(MmapTileHeader));
+        unsigned char* data = pack.data + offset + sizeof(MmapTileHeader);
+        if (header.size < sizeof(dtMeshHeader) || (uint64_t)offset + sizeof(MmapTileHeader) + header.size > pack.size) return false;
+
+        g_TileResidency.RecordMiss(TILE_CACHE_NAVMESH);
 
         dtMeshHeader* meshHeader = (dtMeshHeader*)data;
-        int tileIndex = meshHeader->x + meshHeader->y * 64;
-        dtTileRef tileRefHint = ((dtTileRef)tileIndex) << 20;
         dtTileRef tileRef = 0;
-        mesh->addTile(data, header.size, DT_TILE_FREE_DATA, tileRefHint, &tileRef);
+        if (dtStatusFailed(mesh->addTile(data, header.size, 0, 0, &tileRef))) return false;
+
+        float worldX = -17600.0f + (meshHeader->y + 0.5f) * 533.33333f;
+        float worldY = -17600.0f + (meshHeader->x + 0.5f) * 533.33333f;
+        tileResidency[{ meshHeader->x, meshHeader->y, meshHeader->layer }] = g_TileResidency.Add(TILE_CACHE_NAVMESH,
+            PackTileKey(meshHeader->x, meshHeader->y, meshHeader->layer), currentMapId, worldX, worldY, header.size);
         return true;
     }
 
+    // offset: where the tile's MmapTileHeader starts in the file (see MmapTileIndex)
+    bool AddTile(const std::string& filepath, uint32_t offset = 0) {
+        if (MmapPackFile::IsPack(filepath)) return AddPackedTile(filepath, offset);
+
+        MmapTileHeader header;
+        unsigned char* data = nullptr;
+
+        if (!TakeStagedTile(filepath, header, data)) {
+            std::ifstream file(filepath, std::ios::binary);
+            if (!file.is_open()) return false;
+
+            file.seekg(offset);
+            if (!file.read((char*)&header, sizeof(MmapTileHeader)) || header.size < sizeof(dtMeshHeader)) return false;
+            data = (unsigned char*)dtAlloc(header.size, DT_ALLOC_PERM);
+            if (!data) return false;
+            if (!file.read((char*)data, header.size)) {
+                dtFree(data);
+                return false;
+            }
+        }
+
+        g_TileResidency.RecordMiss(TILE_CACHE_NAVMESH);
+
+        // No tile ref hint: a reused slot then gets a fresh salt, so polygon refs into a
+        // tile that was removed fail isValidPolyRef instead of pointing into its replacement
+        dtMeshHeader* meshHeader = (dtMeshHeader*)data;
+        dtTileRef tileRef = 0;
+        if (dtStatusSucceed(mesh->addTile(data, header.size, DT_TILE_FREE_DATA, 0, &tileRef))) {
+            // Recast X = WoW Y, Recast Z = WoW X; tile (x, y) spans from the -17600 origin
+            float worldX = -17600.0f + (meshHeader->y + 0.5f) * 533.33333f;
+            float worldY = -17600.0f + (meshHeader->x + 0.5f) * 533.33333f;
+            tileResidency[{ meshHeader->x, meshHeader->y, meshHeader->layer }] = g_TileResidency.Add(TILE_CACHE_NAVMESH,
+                PackTileKey(meshHeader->x, meshHeader->y, meshHeader->layer), currentMapId, worldX, worldY, header.size);
+            return true;
+        }
+
+        // Not linked, so the mesh did not take the data
+        dtFree(data);
+        return false;
+    }
+
     std::vector<PathNode> SubdivideOnMesh(const std::vector<PathNode>& input) {
         if (input.empty()) return {};
+        dtNavMeshQuery* query = Query();
         if (!query || !mesh) return input;
 
         std::vector<PathNode> output;
@@ -1249,6 +2254,7 @@ public:
     // Returns the Area ID (Ground=1, Water=8, Underwater=16, etc.) at the given position.
     // Returns 0 if no navmesh is found there.
     unsigned char GetAreaID(const Vector3& pos, float searchRadius = 2.0f, float heightRange = 10.0f) {
+        dtNavMeshQuery* query = Query();
         if (!query || !mesh) return 0;
 
         float center[3] = { pos.y, pos.z, pos.x }; // WoW -> Recast coords
@@ -1279,6 +2285,7 @@ public:
     // Returns the Z height of the NavMesh at the given coordinates.
     // Returns -99999.0f if no walkable mesh is found within the search radius.
     float GetMMapFloorHeight(const Vector3& pos, float searchRadius = 1.0f, float verticalRange = 4.0f) {
+        dtNavMeshQuery* query = Query();
         if (!query || !mesh) return -99999.0f;
 
         // Convert WoW coordinates to Detour coordinates (Y, Z, X)
@@ -1303,11 +2310,12 @@ public:
         return -99999.0f;
     }
 
-    // Marks all navmesh polygons whose 2D centre falls within `radius` yards of `center`
-    // with `flagToAdd`, saving the original flags so they can be restored after pathfinding.
+    // Collects all navmesh polygons whose 2D centre falls within `radius` yards of `center`,
+    // for FindPath to route around. Read-only: the shared poly flags are never touched,
+    // so PathService workers can keep searching the mesh meanwhile.
     // Detour coordinate convention: (detour.x, detour.y, detour.z) == (wow.y, wow.z, wow.x)
-    void MarkPolysInRadius(const Vector3& center, float radius, unsigned short flagToAdd,
-                           std::vector<std::pair<dtPolyRef, unsigned short>>& savedFlags) {
+    void CollectPolysInRadius(const Vector3& center, float radius, std::unordered_set<dtPolyRef>& out) {
+        dtNavMeshQuery* query = Query();
         if (!mesh || !query) return;
 
         float centerDt[3] = { center.y, center.z, center.x };
@@ -1342,16 +2350,115 @@ public:
             float dy = polyCentreY - center.y;
             if (sqrtf(dx * dx + dy * dy) > radius) continue;
 
-            savedFlags.push_back({ polys[i], poly->flags });
-            mesh->setPolyFlags(polys[i], poly->flags | flagToAdd);
+            out.insert(polys[i]);
         }
     }
 
-    // Restores polygon flags saved by MarkPolysInRadius.
-    void RestorePolyFlags(const std::vector<std::pair<dtPolyRef, unsigned short>>& savedFlags) {
-        for (const auto& entry : savedFlags) {
-            mesh->setPolyFlags(entry.first, entry.second);
+    // Poly corridor from startRef to endRef like dtNavMeshQuery::findPath, but polys in
+    // `avoid` cost AVOID_POLY_COST times more. Our Detour build has no virtual
+    // dtQueryFilter, so a per-query poly set can't go through the filter; this walks the
+    // same links read-only instead. Nodes sit at poly centres (Detour uses edge midpoints);
+    // findStraightPath straightens the corridor afterwards either way.
+    // Returns the poly count; like findPath, a partial corridor toward the goal if it's cut off.
+    int FindPolyCorridor(dtPolyRef startRef, dtPolyRef endRef, const float* startPt, const float* endPt,
+        const dtQueryFilter& filter, const std::unordered_set<dtPolyRef>& avoid, dtPolyRef* outPolys, int maxPolys) {
+        struct CorridorNode {
+            dtPolyRef ref;
+            float pos[3];
+            float gScore;
+            int parentIdx;
+            bool closed;
+        };
+        if (!mesh || startRef == 0 || endRef == 0 || maxPolys <= 0) return 0;
+
+        auto distTo = [](const float* a, const float* b) {
+            float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+            return sqrtf(dx * dx + dy * dy + dz * dz);
+        };
+
+        std::vector<CorridorNode> nodes;
+        std::unordered_map<dtPolyRef, int> nodeIndex;
+        typedef std::pair<float, int> OpenEntry;
+        std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>> openSet;
+
+        nodes.push_back(CorridorNode{ startRef, { startPt[0], startPt[1], startPt[2] }, 0.0f, -1, false });
+        nodeIndex[startRef] = 0;
+        openSet.push({ distTo(startPt, endPt), 0 });
+
+        int goalIdx = -1;
+        int bestIdx = 0;
+        float bestH = distTo(startPt, endPt);
+        while (!openSet.empty()) {
+            int currentIdx = openSet.top().second;
+            openSet.pop();
+            if (nodes[currentIdx].closed) continue;
+            nodes[currentIdx].closed = true;
+
+            if (nodes[currentIdx].ref == endRef) {
+                goalIdx = currentIdx;
+                break;
+            }
+
+            const dtMeshTile* tile = nullptr;
+            const dtPoly* poly = nullptr;
+            if (dtStatusFailed(mesh->getTileAndPolyByRef(nodes[currentIdx].ref, &tile, &poly))) continue;
+
+            for (unsigned int l = poly->firstLink; l != DT_NULL_LINK; l = tile->links[l].next) {
+                dtPolyRef neighborRef = tile->links[l].ref;
+                if (neighborRef == 0) continue;
+
+                const dtMeshTile* neighborTile = nullptr;
+                const dtPoly* neighborPoly = nullptr;
+                if (dtStatusFailed(mesh->getTileAndPolyByRef(neighborRef, &neighborTile, &neighborPoly))) continue;
+                if (!filter.passFilter(neighborRef, neighborTile, neighborPoly)) continue;
+
+                auto it = nodeIndex.find(neighborRef);
+                int neighborIdx;
+                if (it == nodeIndex.end()) {
+                    if ((int)nodes.size() >= AVOID_SEARCH_MAX_NODES) continue;
+                    CorridorNode node{ neighborRef, { 0.0f, 0.0f, 0.0f }, 1e9f, -1, false };
+                    if (neighborRef == endRef) {
+                        for (int a = 0; a < 3; ++a) node.pos[a] = endPt[a];
+                    }
+                    else {
+                        for (int v = 0; v < neighborPoly->vertCount; ++v) {
+                            const float* vert = &neighborTile->verts[neighborPoly->verts[v] * 3];
+                            for (int a = 0; a < 3; ++a) node.pos[a] += vert[a] / neighborPoly->vertCount;
+                        }
+                    }
+                    neighborIdx = (int)nodes.size();
+                    nodes.push_back(node);
+                    nodeIndex[neighborRef] = neighborIdx;
+                }
+                else {
+                    neighborIdx = it->second;
+                }
+                if (nodes[neighborIdx].closed) continue;
+
+                float cost = distTo(nodes[currentIdx].pos, nodes[neighborIdx].pos) * filter.getAreaCost(neighborPoly->getArea());
+                if (avoid.count(neighborRef)) cost *= AVOID_POLY_COST;
+                float tentativeG = nodes[currentIdx].gScore + cost;
+                if (tentativeG < nodes[neighborIdx].gScore) {
+                    float h = distTo(nodes[neighborIdx].pos, endPt);
+                    nodes[neighborIdx].gScore = tentativeG;
+                    nodes[neighborIdx].parentIdx = currentIdx;
+                    openSet.push({ tentativeG + h, neighborIdx });
+                    if (h < bestH) {
+                        bestH = h;
+                        bestIdx = neighborIdx;
+                    }
+                }
+            }
+        }
+
+        std::vector<dtPolyRef> corridor;
+        for (int n = goalIdx >= 0 ? goalIdx : bestIdx; n >= 0; n = nodes[n].parentIdx) {
+            corridor.push_back(nodes[n].ref);
         }
+        std::reverse(corridor.begin(), corridor.end());
+        int count = (std::min)((int)corridor.size(), maxPolys);
+        std::copy(corridor.begin(), corridor.begin() + count, outPolys);
+        return count;
     }
 
     Vector3 GetPolyNormal(dtPolyRef polyRef) {
@@ -1396,8 +2503,10 @@ public:
     //
     // This collapses long straight runs over open terrain into two waypoints
     // and keeps only the true turning points near obstacles.
+    // A shortcut through any of `avoidPolys` counts as blocked.
     // -----------------------------------------------------------------------
-    std::vector<PathNode> SimplifyGroundPath(const std::vector<PathNode>& input) {
+    std::vector<PathNode> SimplifyGroundPath(const std::vector<PathNode>& input, const std::unordered_set<dtPolyRef>* avoidPolys = nullptr) {
+        dtNavMeshQuery* query = Query();
         if (input.size() <= 2 || !query || !mesh) return input;
 
         dtQueryFilter filter;
@@ -1442,7 +2551,12 @@ public:
                                              &filter, &t, hitNormal,
                                              polys, &polyCount, 64);
 
-                if (dtStatusSucceed(st) && t >= 1.0f) {
+                bool avoided = false;
+                for (int k = 0; avoidPolys && k < polyCount && !avoided; k++) {
+                    avoided = avoidPolys->count(polys[k]) > 0;
+                }
+
+                if (dtStatusSucceed(st) && t >= 1.0f && !avoided) {
                     // Navmesh LoS is clear, but also verify the physical straight line
                     // doesn't cross a cave wall/ceiling. The bot walks in straight lines
                     // between waypoints, so navmesh topology alone is not sufficient.
@@ -1468,6 +2582,22 @@ public:
 
 inline NavMesh globalNavMesh;
 
+// Guards globalNavMesh for the PathService workers, the web server and the main loop's
+// direct NavMesh queries. See NavMeshRWLock.
+inline NavMeshRWLock g_NavMeshMutex;
+
+// Cancel flag of the PathService job planned on this thread; long searches poll it.
+inline thread_local const std::atomic<bool>* g_PathCancelToken = nullptr;
+
+// Set while this thread plans one segment of a CalculatePath: raised when a sibling
+// flight segment fails, since the whole route is then thrown away.
+inline thread_local const std::atomic<bool>* g_PathSegmentAbort = nullptr;
+
+inline bool PathRequestCancelled() {
+    return (g_PathCancelToken && g_PathCancelToken->load()) ||
+        (g_PathSegmentAbort && g_PathSegmentAbort->load());
+}
+
 // -------------------------------------------------------------------------
 // GROUND PATH SUBDIVISION
 //
@@ -1520,7 +2650,9 @@ inline std::vector<PathNode> SubdivideGroundPath(const std::vector<PathNode>& in
 }
 
 inline bool IsPointIndoors(const Vector3& pos, int mapId) {
-    if (!globalNavMesh.mesh || !globalNavMesh.query) return false;
+    NavMeshReadLock meshLock(g_NavMeshMutex);
+    dtNavMeshQuery* query = globalNavMesh.Query();
+    if (!query) return false;
 
     float center[3] = { pos.y, pos.z, pos.x }; // Recast Coords (Y, Z, X)
     float extents[3] = { 2.0f, 5.0f, 2.0f };   // Search small radius
@@ -1532,7 +2664,7 @@ inline bool IsPointIndoors(const Vector3& pos, int mapId) {
     filter.setExcludeFlags(0);
 
     // 1. Find the polygon at the goal
-    dtStatus status = globalNavMesh.query->findNearestPoly(center, extents, &filter, &polyRef, nearestPt);
+    dtStatus status = query->findNearestPoly(center, extents, &filter, &polyRef, nearestPt);
 
     if (dtStatusSucceed(status) && polyRef != 0) {
         // 2. Get the poly data to read flags
@@ -1550,14 +2682,16 @@ inline bool IsPointIndoors(const Vector3& pos, int mapId) {
     return false;
 }
 
-inline std::vector<PathNode> FindPath(const Vector3& start, const Vector3& end, bool ignoreWater, bool pointAdjust, bool zCheck, float zExtent, unsigned short extraExcludeFlags) {
-    if (!globalNavMesh.query || !globalNavMesh.mesh) {
-        g_LogFile << "[FindPath] FAIL: No NavMesh query/mesh loaded (mapId=" << globalNavMesh.currentMapId << ")" << std::endl;
+inline std::vector<PathNode> FindPath(const Vector3& start, const Vector3& end, bool ignoreWater, bool pointAdjust, bool zCheck, float zExtent, const std::unordered_set<dtPolyRef>* avoidPolys) {
+    NavMeshReadLock meshLock(g_NavMeshMutex);
+    dtNavMeshQuery* query = globalNavMesh.Query();
+    if (!query) {
+        PathLog() << "[FindPath] FAIL: No NavMesh query/mesh loaded (mapId=" << globalNavMesh.currentMapId << ")" << std::endl;
         return {};
     }
 
     if (DEBUG_PATHFINDING) {
-        g_LogFile << "[FindPath] start=(" << start.x << "," << start.y << "," << start.z
+        PathLog() << "[FindPath] start=(" << start.x << "," << start.y << "," << start.z
                   << ") end=(" << end.x << "," << end.y << "," << end.z
                   << ") mapId=" << globalNavMesh.currentMapId
                   << " zExtent=" << zExtent << std::endl;
@@ -1578,17 +2712,17 @@ inline std::vector<PathNode> FindPath(const Vector3& start, const Vector3& end,
     // cave walls and incorrectly relocates the start outside the cave.
     bool startOnNavMesh = false;
     float preNearPt[3] = { 0, 0, 0 };
-    if (globalNavMesh.query) {
+    if (query) {
         dtQueryFilter preFilter;
         preFilter.setIncludeFlags(0xffff); // Accept any polygon — just checking if we're on the mesh
         preFilter.setExcludeFlags(0);
         float preExt[3] = { 5.0f, zExtent, 5.0f };
         float prePt[3] = { actualStart.y, actualStart.z, actualStart.x };
         dtPolyRef preRef = 0;
-        globalNavMesh.query->findNearestPoly(prePt, preExt, &preFilter, &preRef, preNearPt);
+        query->findNearestPoly(prePt, preExt, &preFilter, &preRef, preNearPt);
         startOnNavMesh = (preRef != 0);
         if (DEBUG_PATHFINDING) {
-            g_LogFile << "[Escape] startOnNavMesh=" << startOnNavMesh
+            PathLog() << "[Escape] startOnNavMesh=" << startOnNavMesh
                       << " preRef=" << preRef
                       << " playerZ=" << actualStart.z
                       << " nearMeshZ=" << preNearPt[1] // Detour Y = WoW Z
@@ -1597,7 +2731,7 @@ inline std::vector<PathNode> FindPath(const Vector3& start, const Vector3& end,
     }
     if ((!globalNavMesh.IsClearSafePoint(actualStart, mapId)) && pointAdjust && !startOnNavMesh) {
         if (DEBUG_PATHFINDING) {
-            g_LogFile << "[Ground] Start point unsafe/blocked. Seeking escape..." << std::endl;
+            PathLog() << "[Ground] Start point unsafe/blocked. Seeking escape..." << std::endl;
         }
         Vector3 safeStart = globalNavMesh.FindNearestSafePoint(actualStart, mapId, true);
 
@@ -1606,12 +2740,12 @@ inline std::vector<PathNode> FindPath(const Vector3& start, const Vector3& end,
             float escapeDist = actualStart.Dist3D(safeStart);
             actualStart = safeStart;
             if (DEBUG_PATHFINDING) {
-                g_LogFile << "[Ground] Escaped to: " << actualStart.x << ", " << actualStart.y << ", " << actualStart.z
+                PathLog() << "[Ground] Escaped to: " << actualStart.x << ", " << actualStart.y << ", " << actualStart.z
                           << " (moved " << escapeDist << " yards)" << std::endl;
             }
         }
     } else if (DEBUG_PATHFINDING && !globalNavMesh.IsClearSafePoint(actualStart, mapId)) {
-        g_LogFile << "[Escape] Skipped escape — startOnNavMesh=true, playerZ=" << actualStart.z
+        PathLog() << "[Escape] Skipped escape — startOnNavMesh=true, playerZ=" << actualStart.z
                   << " nearMeshZ=" << preNearPt[1] << std::endl;
     }
 
@@ -1619,15 +2753,15 @@ inline std::vector<PathNode> FindPath(const Vector3& start, const Vector3& end,
     if (endGround > -90000.0f && fabs(endGround - actualEnd.z) < GROUND_HEIGHT_THRESHOLD) {
         actualEnd.z = endGround + 1.0f;
         if (DEBUG_PATHFINDING) {
-            g_LogFile << "[FindPath] Goal adjusted: end.z=" << actualEnd.z << " (FMap ground=" << endGround << ")" << std::endl;
+            PathLog() << "[FindPath] Goal adjusted: end.z=" << actualEnd.z << " (FMap ground=" << endGround << ")" << std::endl;
         }
     }
     else if (DEBUG_PATHFINDING) {
-        g_LogFile << "[FindPath] No end Z adjust: FMap ground=" << endGround << " end.z=" << actualEnd.z << std::endl;
+        PathLog() << "[FindPath] No end Z adjust: FMap ground=" << endGround << " end.z=" << actualEnd.z << std::endl;
     }
 
     if (DEBUG_PATHFINDING) {
-        g_LogFile << "[FindPath] actualStart=(" << actualStart.x << "," << actualStart.y << "," << actualStart.z
+        PathLog() << "[FindPath] actualStart=(" << actualStart.x << "," << actualStart.y << "," << actualStart.z
                   << ") actualEnd=(" << actualEnd.x << "," << actualEnd.y << "," << actualEnd.z << ")" << std::endl;
     }
 
@@ -1660,7 +2794,7 @@ inline std::vector<PathNode> FindPath(const Vector3& start, const Vector3& end,
     }
 
     filter.setIncludeFlags(includeFlags);
-    filter.setExcludeFlags(extraExcludeFlags);
+    filter.setExcludeFlags(0);
 
     dtPolyRef startRef = 0, endRef = 0;
     float startPt[3], endPt[3];
@@ -1670,13 +2804,13 @@ inline std::vector<PathNode> FindPath(const Vector3& start, const Vector3& end,
     float extent[3] = { 5.0f, zExtent, 5.0f };
 
     if (DEBUG_PATHFINDING) {
-        g_LogFile << "[FindPath] Querying polys: detourStart=(" << detourStart[0] << "," << detourStart[1] << "," << detourStart[2]
+        PathLog() << "[FindPath] Querying polys: detourStart=(" << detourStart[0] << "," << detourStart[1] << "," << detourStart[2]
                   << ") detourEnd=(" << detourEnd[0] << "," << detourEnd[1] << "," << detourEnd[2]
                   << ") extent=(" << extent[0] << "," << extent[1] << "," << extent[2] << ")" << std::endl;
     }
 
-    globalNavMesh.query->findNearestPoly(detourStart, extent, &filter, &startRef, startPt);
-    globalNavMesh.query->findNearestPoly(detourEnd,   extent, &filter, &endRef,   endPt);
+    query->findNearestPoly(detourStart, extent, &filter, &startRef, startPt);
+    query->findNearestPoly(detourEnd,   extent, &filter, &endRef,   endPt);
 
     // If end poly not found, retry with progressively wider XZ extents.
     // Only accept if the snapped point is within 10 yards of the intended target —
@@ -1687,13 +2821,13 @@ inline std::vector<PathNode> FindPath(const Vector3& start, const Vector3& end,
         const float MAX_SNAP_DIST = 10.0f;
         for (float fe : FALLBACK_EXTENTS) {
             float wideExtent[3] = { fe, zExtent, fe };
-            globalNavMesh.query->findNearestPoly(detourEnd, wideExtent, &filter, &endRef, endPt);
+            query->findNearestPoly(detourEnd, wideExtent, &filter, &endRef, endPt);
             if (endRef) {
                 float dx = endPt[0] - detourEnd[0];
                 float dz = endPt[2] - detourEnd[2];
                 float snapDist = std::sqrt(dx * dx + dz * dz);
                 if (snapDist <= MAX_SNAP_DIST) {
-                    if (DEBUG_PATHFINDING) g_LogFile << "[FindPath] End poly found with wider extent=" << fe << " snapDist=" << snapDist << std::endl;
+                    if (DEBUG_PATHFINDING) PathLog() << "[FindPath] End poly found with wider extent=" << fe << " snapDist=" << snapDist << std::endl;
                     break;
                 }
                 // Snapped too far — reject and keep searching
@@ -1703,7 +2837,7 @@ inline std::vector<PathNode> FindPath(const Vector3& start, const Vector3& end,
     }
 
     if (DEBUG_PATHFINDING) {
-        g_LogFile << "[FindPath] startRef=" << startRef << " snappedStart=(" << startPt[0] << "," << startPt[1] << "," << startPt[2] << ")"
+        PathLog() << "[FindPath] startRef=" << startRef << " snappedStart=(" << startPt[0] << "," << startPt[1] << "," << startPt[2] << ")"
                   << " endRef=" << endRef   << " snappedEnd=("   << endPt[0]   << "," << endPt[1]   << "," << endPt[2]   << ")" << std::endl;
     }
 
@@ -1715,7 +2849,7 @@ inline std::vector<PathNode> FindPath(const Vector3& start, const Vector3& end,
         for (int dx = -1; dx <= 1; ++dx)
             for (int dy = -1; dy <= 1; ++dy)
                 if (globalNavMesh.mesh->getTileAt(ttx + dx, tty + dy, 0)) ++loadedCount;
-        g_LogFile << "[FindPath] " << label << " pos=(" << pos.x << "," << pos.y << "," << pos.z
+        PathLog() << "[FindPath] " << label << " pos=(" << pos.x << "," << pos.y << "," << pos.z
                   << ") GetTileCoords=(" << ttx << "," << tty << ")"
                   << " tiles loaded in 3x3=" << loadedCount << "/9" << std::endl;
     };
@@ -1733,7 +2867,7 @@ inline std::vector<PathNode> FindPath(const Vector3& start, const Vector3& end,
     // Even if we found a poly, check if it's way above or below the target.
     // detourEnd[1] is Z. endPt[1] is snapped Z.
     if (zCheck && (std::abs(endPt[1] - detourEnd[1]) > 5.0f)) {
-        if (DEBUG_PATHFINDING) g_LogFile << "[FindPath] FAIL: End Poly is " << endPt[1] - detourEnd[1] << " above target. Continuing anyway." << std::endl;
+        if (DEBUG_PATHFINDING) PathLog() << "[FindPath] FAIL: End Poly is " << endPt[1] - detourEnd[1] << " above target. Continuing anyway." << std::endl;
         // The snapped point is more than 5 yards vertically from the request.
         // We likely snapped to a bridge/floor above. Treat as unreachable.
         //return {};
@@ -1741,17 +2875,22 @@ inline std::vector<PathNode> FindPath(const Vector3& start, const Vector3& end,
 
     dtPolyRef pathPolys[MAX_POLYS];
     int pathCount = 0;
-    globalNavMesh.query->findPath(startRef, endRef, startPt, endPt, &filter,
-        pathPolys, &pathCount, MAX_POLYS);
+    if (avoidPolys && !avoidPolys->empty()) {
+        pathCount = globalNavMesh.FindPolyCorridor(startRef, endRef, startPt, endPt, filter, *avoidPolys, pathPolys, MAX_POLYS);
+    }
+    else {
+        query->findPath(startRef, endRef, startPt, endPt, &filter,
+            pathPolys, &pathCount, MAX_POLYS);
+    }
 
     if (pathCount <= 0) {
-        if (DEBUG_PATHFINDING) g_LogFile << "[FindPath] FAIL: No path exists between Start and End (Islands)." << std::endl;
+        if (DEBUG_PATHFINDING) PathLog() << "[FindPath] FAIL: No path exists between Start and End (Islands)." << std::endl;
         return {};
     }
 
     float straightPath[MAX_POLYS * 3];
     int straightPathCount = 0;
-    globalNavMesh.query->findStraightPath(startPt, endPt, pathPolys, pathCount,
+    query->findStraightPath(startPt, endPt, pathPolys, pathCount,
         straightPath, 0, 0, &straightPathCount, MAX_POLYS);
 
     std::vector<PathNode> result;
@@ -1770,11 +2909,272 @@ inline std::vector<PathNode> FindPath(const Vector3& start, const Vector3& end,
     // clear navmesh line-of-sight from their predecessor.  This is the standard
     // Detour post-process step and is what eliminates unnecessary zigzag that
     // comes from polygon-edge turn points in the corridor.
-    result = globalNavMesh.SimplifyGroundPath(result);
+    result = globalNavMesh.SimplifyGroundPath(result, avoidPolys);
+
+    return result;
+}
+
+// -----------------------------------------------------------------------------------------
+// COARSE-TO-FINE FLIGHT CORRIDOR
+// -----------------------------------------------------------------------------------------
+// Columns of FMap pyramid blocks (at one level) the fine flight A* may expand into.
+// An empty corridor restricts nothing.
+struct FlightCorridor {
+    int level = -1;
+    float blockSize = 0.0f;
+    std::unordered_set<int64_t> blocks;
+    std::vector<Vector3> route; // Block centres of the coarse route, start to goal
+
+    static int64_t Key(int bx, int by) { return ((int64_t)bx << 32) | (uint32_t)by; }
+
+    bool empty() const { return blocks.empty(); }
+
+    bool Contains(const Vector3& pos) const {
+        if (blocks.empty()) return true;
+        return blocks.count(Key((int)std::floor(pos.x / blockSize), (int)std::floor(pos.y / blockSize))) != 0;
+    }
+};
+
+// A* over the conservative occupancy of one FMap pyramid level. Nodes are blocks of
+// 2^level columns a side and FLIGHT_LOD_SLAB_HEIGHT tall; a node is free when its centre
+// lies in the top layer of every column of the block (GetFMapBlockBounds), with
+// FLIGHT_LOD_MARGIN to spare. Missing tiles count as free, as in the line checks.
+// The start and goal block columns are always free so the route can climb out of and
+// descend into them; the fine search does the actual launch and landing.
+// With 'within', only blocks inside that corridor are searched.
+// Returns the route dilated by 'halfWidth' blocks, or an empty corridor if there is none.
+inline FlightCorridor PlanFlightCorridor(const Vector3& start, const Vector3& goal, int mapId,
+    int level, int halfWidth, float searchRadius, const FlightCorridor* within = nullptr) {
+    struct CoarseNode {
+        int bx, by, k;
+        float gScore, fScore;
+        int parentIdx;
+        bool closed;
+    };
+
+    const float blockSize = FLIGHT_LOD_CELL_SIZE * (float)(1 << level);
+    const float slab = FLIGHT_LOD_SLAB_HEIGHT;
+    const float HEURISTIC_WEIGHT = 1.5f;
+
+    auto centre = [&](int bx, int by, int k) {
+        return Vector3((bx + 0.5f) * blockSize, (by + 0.5f) * blockSize, (k + 0.5f) * slab);
+    };
+    auto nodeKey = [](int bx, int by, int k) {
+        return ((int64_t)(bx & 0xFFFFF) << 40) | ((int64_t)(by & 0xFFFFF) << 20) | (int64_t)(k & 0xFFFFF);
+    };
+
+    int sbx = (int)std::floor(start.x / blockSize), sby = (int)std::floor(start.y / blockSize);
+    int gbx = (int)std::floor(goal.x / blockSize), gby = (int)std::floor(goal.y / blockSize);
+    int sk = (int)std::floor(start.z / slab), gk = (int)std::floor(goal.z / slab);
+    int kMin = (std::min)(sk, gk) - 2;
+    int kMax = (int)std::floor(((std::max)(start.z, goal.z) + FLIGHT_LOD_MAX_CLIMB) / slab);
+    Vector3 goalCentre = centre(gbx, gby, gk);
+    Vector3 midpoint = (start + goal) * 0.5f;
+
+    // Top-layer bounds per block column, fetched once
+    std::unordered_map<int64_t, std::pair<float, float>> columnBounds;
+    auto isFree = [&](int bx, int by, int k) {
+        if ((bx == sbx && by == sby) || (bx == gbx && by == gby)) return true;
+
+        int64_t column = FlightCorridor::Key(bx, by);
+        auto it = columnBounds.find(column);
+        if (it == columnBounds.end()) {
+            float floorMax = -1e9f, ceilingMin = 1e9f;
+            Vector3 c = centre(bx, by, 0);
+            GetFMapBlockBounds(mapId, level, c.x, c.y, &floorMax, &ceilingMin);
+            it = columnBounds.emplace(column, std::make_pair(floorMax, ceilingMin)).first;
+        }
+        float z = (k + 0.5f) * slab;
+        return z >= it->second.first + FLIGHT_LOD_MARGIN && z <= it->second.second - FLIGHT_LOD_MARGIN;
+    };
+
+    std::vector<CoarseNode> nodes;
+    std::unordered_map<int64_t, int> nodeIndex;
+    auto getOrCreateNode = [&](int bx, int by, int k) -> int {
+        if (k < kMin || k > kMax) return -1;
+        int64_t key = nodeKey(bx, by, k);
+        auto it = nodeIndex.find(key);
+        if (it != nodeIndex.end()) return it->second;
+
+        Vector3 c = centre(bx, by, k);
+        if (c.Dist2D(midpoint) > searchRadius + blockSize) return -1;
+        if (within && !within->Contains(c)) return -1;
+        if (!isFree(bx, by, k)) return -1;
+
+        int idx = (int)nodes.size();
+        nodes.push_back(CoarseNode{ bx, by, k, 1e9f, 0.0f, -1, false });
+        nodeIndex[key] = idx;
+        return idx;
+    };
+
+    typedef std::pair<float, int> OpenEntry;
+    std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>> openSet;
+
+    FlightCorridor result;
+    int startIdx = getOrCreateNode(sbx, sby, sk);
+    if (startIdx < 0) return result;
+    nodes[startIdx].gScore = 0.0f;
+    openSet.push({ 0.0f, startIdx });
+
+    int goalIdx = -1;
+    int expanded = 0;
+    while (!openSet.empty() && expanded < FLIGHT_LOD_MAX_NODES) {
+        int currentIdx = openSet.top().second;
+        openSet.pop();
+        if (nodes[currentIdx].closed) continue;
+        nodes[currentIdx].closed = true;
+        expanded++;
+
+        CoarseNode current = nodes[currentIdx];
+        if (current.bx == gbx && current.by == gby) {
+            goalIdx = currentIdx;
+            break;
+        }
+
+        Vector3 currentPos = centre(current.bx, current.by, current.k);
+        for (int dx = -1; dx <= 1; ++dx) {
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dk = -1; dk <= 1; ++dk) {
+                    if (dx == 0 && dy == 0 && dk == 0) continue;
+
+                    int neighborIdx = getOrCreateNode(current.bx + dx, current.by + dy, current.k + dk);
+                    if (neighborIdx < 0 || nodes[neighborIdx].closed) continue;
+
+                    Vector3 neighborPos = centre(current.bx + dx, current.by + dy, current.k + dk);
+                    float tentativeG = current.gScore + currentPos.Dist3D(neighborPos);
+                    if (tentativeG < nodes[neighborIdx].gScore) {
+                        nodes[neighborIdx].gScore = tentativeG;
+                        nodes[neighborIdx].fScore = tentativeG + neighborPos.Dist3D(goalCentre) * HEURISTIC_WEIGHT;
+                        nodes[neighborIdx].parentIdx = currentIdx;
+                        openSet.push({ nodes[neighborIdx].fScore, neighborIdx });
+                    }
+                }
+            }
+        }
+    }
+
+    if (goalIdx < 0) {
+        if (DEBUG_PATHFINDING) {
+            PathLog() << "[FlightLOD] Level " << level << ": no route (" << expanded << " blocks expanded)" << std::endl;
+        }
+        return result;
+    }
 
+    result.level = level;
+    result.blockSize = blockSize;
+    for (int n = goalIdx; n >= 0; n = nodes[n].parentIdx) {
+        const CoarseNode& node = nodes[n];
+        result.route.push_back(centre(node.bx, node.by, node.k));
+        for (int dx = -halfWidth; dx <= halfWidth; ++dx) {
+            for (int dy = -halfWidth; dy <= halfWidth; ++dy) {
+                result.blocks.insert(FlightCorridor::Key(node.bx + dx, node.by + dy));
+            }
+        }
+    }
+    std::reverse(result.route.begin(), result.route.end());
+
+    if (DEBUG_PATHFINDING) {
+        PathLog() << "[FlightLOD] Level " << level << ": route of " << result.route.size() << " blocks, corridor "
+            << result.blocks.size() << " (" << expanded << " expanded)" << std::endl;
+    }
     return result;
 }
 
+// --- SEGMENT PLANNER POOL ---
+// Helper threads for CalculatePath's independent hotspot-to-hotspot segments, and for
+// the A* attempts inside each flight segment. The calling thread always works through
+// the items itself as well, so a busy pool (or a nested ParallelFor on a helper) only
+// costs parallelism, never progress. Helper tasks that have not started by the time
+// the caller runs out of items are dropped rather than waited for.
+const int PLAN_SEGMENT_THREADS = 3;
+
+class SegmentPlannerPool {
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable queueCv;
+    std::deque<std::function<void()>> tasks;
+    bool running = false;
+
+    void WorkerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                queueCv.wait(lock, [&]() { return !running || !tasks.empty(); });
+                if (!running) break;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    ~SegmentPlannerPool() { Stop(); }
+
+    // Calls fn(i) for every i in [0, count), on this thread and up to
+    // PLAN_SEGMENT_THREADS helpers. Returns once every call has finished.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& fn) {
+        struct Shared {
+            std::atomic<size_t> next{ 0 };
+            std::mutex mutex;
+            std::condition_variable cv;
+            int active = 0;        // Helpers inside fn loop
+            bool closed = false;   // Caller is done; helpers not yet started must not begin
+        };
+        auto shared = std::make_shared<Shared>();
+
+        size_t helpers = (std::min)((size_t)PLAN_SEGMENT_THREADS, count > 0 ? count - 1 : 0);
+        if (helpers > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!running) {
+                running = true;
+                for (int i = 0; i < PLAN_SEGMENT_THREADS; ++i) {
+                    workers.emplace_back(&SegmentPlannerPool::WorkerLoop, this);
+                }
+            }
+            for (size_t h = 0; h < helpers; ++h) {
+                tasks.push_back([shared, &fn, count]() {
+                    {
+                        std::lock_guard<std::mutex> lock(shared->mutex);
+                        if (shared->closed) return;
+                        shared->active++;
+                    }
+                    for (size_t i; (i = shared->next++) < count;) fn(i);
+                    {
+                        std::lock_guard<std::mutex> lock(shared->mutex);
+                        shared->active--;
+                    }
+                    shared->cv.notify_all();
+                });
+            }
+        }
+        if (helpers > 0) queueCv.notify_all();
+
+        for (size_t i; (i = shared->next++) < count;) fn(i);
+
+        std::unique_lock<std::mutex> lock(shared->mutex);
+        shared->closed = true;
+        shared->cv.wait(lock, [&]() { return shared->active == 0; });
+    }
+
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+            tasks.clear();
+        }
+        queueCv.notify_all();
+        for (auto& t : workers) {
+            if (t.joinable()) t.join();
+        }
+        workers.clear();
+    }
+};
+
+inline SegmentPlannerPool g_SegmentPlanner;
+
 // -----------------------------------------------------------------------------------------
 // REWRITTEN A* FLIGHT LOGIC WITH DYNAMIC GRID SIZING
 // -----------------------------------------------------------------------------------------
@@ -1784,6 +3184,8 @@ struct AStarAttempt {
     int maxNodes;
     const char* name;
     bool dynamic;       // NEW: Enable variable step size
+    bool lazyTheta;     // Any-angle: parents may be any earlier node, line of sight checked on expansion
+    bool bidirectional; // Also search back from the goal and stop where the two meet (lattice only)
 };
 
 // ANGLED FLIGHT PATHFINDING - Natural diagonal ascent/descent
@@ -1791,12 +3193,14 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
     Vector3 rawStartPos = start;
     // 1.5 to 2.0 is a good range. Higher = Faster but less optimal path.
     const float HEURISTIC_WEIGHT = 2.0f;
+    const float CLIMB_BONUS = 0.95f; // Upward steps cost this much per yard, so the A* prefers to gain height
+    const float BIDIR_SUBOPTIMALITY = 1.1f; // Bidirectional paths cost at most this times the best the lattice allows
 
     // Always open log for this specific debug request, or keep using DEBUG_PATHFINDING flag
     if (DEBUG_PATHFINDING) {
-        g_LogFile << "\n=== CALCULATE 3D FLIGHT PATH ===" << std::endl;
-        g_LogFile << "Start: (" << start.x << ", " << start.y << ", " << start.z << ")" << std::endl;
-        g_LogFile << "End:   (" << end.x << ", " << end.y << ", " << end.z << ")" << std::endl;
+        PathLog() << "\n=== CALCULATE 3D FLIGHT PATH ===" << std::endl;
+        PathLog() << "Start: (" << start.x << ", " << start.y << ", " << start.z << ")" << std::endl;
+        PathLog() << "End:   (" << end.x << ", " << end.y << ", " << end.z << ")" << std::endl;
     }
 
     // 3. ATTEMPT CONFIGURATIONS
@@ -1804,16 +3208,21 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
     AStarAttempt attempts[] = {
         // Base=4.0f means near the target we move in 4yd steps (Very precise).
         // Fixed coarse grid
-        { 4.0f,  false,  1000, "Coarse Fixed",     true },
+        { 4.0f,  false,  1000, "Coarse Fixed",     true,  true,  false },
 
-        { 2.0f,  false,  4000, "Standard Dynamic", true },
+        // Runs next to the first one: a goal in a cave or under a canopy bounds this
+        // search from its own side instead of flooding the forward frontier
+        { 2.0f,  false,  4000, "Standard Dynamic", true,  false, true },
 
         // Fallback: Relaxed collision for tight spots
-        { 4.0f,  false, 10000, "Relaxed Precision", true },
+        { 4.0f,  false, 10000, "Relaxed Precision", true,  false, false },
 
         // Last Resort: Ultra strict/fine for impossible spots
-        { 3.0f,  false, 20000, "Ultra-Precision",   false }
+        { 3.0f,  false, 20000, "Ultra-Precision",   false, false, false }
     };
+    // Only the first two are tried: the failure fallback after the second gives up
+    // (its hybrid recovery is disabled). Raise this to let the rest run as well.
+    const int FLIGHT_ATTEMPTS_TRIED = 2;
 
     float GROUND_HEIGHT_THRESHOLD = 5.0f;
 
@@ -1827,19 +3236,19 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
 
     // --- ESCAPE LOGIC: USE UNIVERSAL SPIRAL ---
     if (!globalNavMesh.IsClearSafePoint(actualStart, mapId) && g_GameState->player.isFlying) {
-        if (DEBUG_PATHFINDING) g_LogFile << "[Flight] Start point is inside obstacle safety margin (" << AGENT_RADIUS << "yd). Seeking escape..." << std::endl;
+        if (DEBUG_PATHFINDING) PathLog() << "[Flight] Start point is inside obstacle safety margin (" << AGENT_RADIUS << "yd). Seeking escape..." << std::endl;
 
         Vector3 safeStart = globalNavMesh.FindNearestSafePoint(actualStart, mapId, false);
 
         if (safeStart.x != 0.0f || safeStart.y != 0.0f || safeStart.z != 0.0f) {
             if (DEBUG_PATHFINDING) {
-                g_LogFile << "[Flight] Found escape point at (" << safeStart.x << ", " << safeStart.y << ", " << safeStart.z
+                PathLog() << "[Flight] Found escape point at (" << safeStart.x << ", " << safeStart.y << ", " << safeStart.z
                     << ") - Dist: " << actualStart.Dist3D(safeStart) << std::endl;
             }
             actualStart = safeStart;
         }
         else {
-            if (DEBUG_PATHFINDING) g_LogFile << "[Flight] ! Could not find a safe escape point nearby." << std::endl;
+            if (DEBUG_PATHFINDING) PathLog() << "[Flight] ! Could not find a safe escape point nearby." << std::endl;
         }
     }
 
@@ -1848,7 +3257,7 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
         actualStart.z = startGround + 1.0f;
         //start.z = actualStart.z;
         if (DEBUG_PATHFINDING) {
-            g_LogFile << "Adjusted start height to: " << actualStart.z << " (ground: " << startGround << ")" << std::endl;
+            PathLog() << "Adjusted start height to: " << actualStart.z << " (ground: " << startGround << ")" << std::endl;
         }
     }
 
@@ -1858,7 +3267,7 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
         //end.z = actualEnd.z;
         endingGround = true;
         if (DEBUG_PATHFINDING) {
-            g_LogFile << "Goal is on ground, adjusted end height to: " << actualEnd.z
+            PathLog() << "Goal is on ground, adjusted end height to: " << actualEnd.z
                 << " (ground: " << endGround << ")" << std::endl;
         }
     }
@@ -1878,7 +3287,7 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
 
     if (isIndoorFlagged || !isGoalFlyable) {
         bool foundLanding = false;
-        if (DEBUG_PATHFINDING) g_LogFile << "[Path] Start is Indoors. Searching for exit..." << std::endl;
+        if (DEBUG_PATHFINDING) PathLog() << "[Path] Start is Indoors. Searching for exit..." << std::endl;
 
         // Use BFS to find the nearest outdoor spot
         // (Ensure FindFlyableExit checks: !(flags & NAV_INDOOR))
@@ -1902,8 +3311,8 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
                 foundLanding = true;
 
                 if (DEBUG_PATHFINDING) {
-                    g_LogFile << "[Flight] ✓ Found Launch Spot at (" << startPoint.x << ", " << startPoint.y << ", " << startPoint.z << ")!" << std::endl;
-                    g_LogFile << "         Ground path length: " << approach.size() << " nodes." << std::endl;
+                    PathLog() << "[Flight] ✓ Found Launch Spot at (" << startPoint.x << ", " << startPoint.y << ", " << startPoint.z << ")!" << std::endl;
+                    PathLog() << "         Ground path length: " << approach.size() << " nodes." << std::endl;
                 }
             }
         }
@@ -1919,7 +3328,7 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
 
     if (isIndoorFlagged || !isGoalFlyable) {
         bool foundLanding = false;
-        if (DEBUG_PATHFINDING) g_LogFile << "[Path] Destination is Indoors. Searching for exit..." << std::endl;
+        if (DEBUG_PATHFINDING) PathLog() << "[Path] Destination is Indoors. Searching for exit..." << std::endl;
 
         // Use BFS to find the nearest outdoor spot
         // (Ensure FindFlyableExit checks: !(flags & NAV_INDOOR))
@@ -1943,8 +3352,8 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
                 foundLanding = true;
 
                 if (DEBUG_PATHFINDING) {
-                    g_LogFile << "[Flight] ✓ Found Landing Spot at (" << exitPoint.x << ", " << exitPoint.y << ", " << exitPoint.z << ")!" << std::endl;
-                    g_LogFile << "         Ground path length: " << approach.size() << " nodes." << std::endl;
+                    PathLog() << "[Flight] ✓ Found Landing Spot at (" << exitPoint.x << ", " << exitPoint.y << ", " << exitPoint.z << ")!" << std::endl;
+                    PathLog() << "         Ground path length: " << approach.size() << " nodes." << std::endl;
                 }
             }
         }
@@ -1963,7 +3372,7 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
             if (flightGround > -90000.0f && fabs(flightGround - flightGoal.z) < GROUND_HEIGHT_THRESHOLD) {
                 flightGoal.z = flightGround + 1.0f;
             }
-            g_LogFile << "Safe Landing Spot found at: (" << flightGoal.x << ", " << flightGoal.y << ", " << flightGoal.z << ")" << std::endl;
+            PathLog() << "Safe Landing Spot found at: (" << flightGoal.x << ", " << flightGoal.y << ", " << flightGoal.z << ")" << std::endl;
         }
     }
 
@@ -1988,12 +3397,12 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
                 flightGoal.z = flightGround + 1.0f;
             }
             safeLandingFound = true;
-            g_LogFile << "Safe Landing Spot found at: (" << flightGoal.x << ", " << flightGoal.y << ", " << flightGoal.z << ")" << std::endl;
+            PathLog() << "Safe Landing Spot found at: (" << flightGoal.x << ", " << flightGoal.y << ", " << flightGoal.z << ")" << std::endl;
         }
     }*/
 
     // 2. TRY DIRECT PATH FIRST (Optimization)
-    if (DEBUG_PATHFINDING) g_LogFile << "Checking direct path..." << std::endl;
+    if (DEBUG_PATHFINDING) PathLog() << "Checking direct path..." << std::endl;
 
     // REPLACED: Use Detailed check to handle No-Fly Zones gracefully
     // Pass isFlying flag to collision check
@@ -2002,14 +3411,14 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
         groundStart, flightGoal, mapId, failPos, isFlying, true, true);
 
     if (directCheck == SEGMENT_VALID) {
-        if (DEBUG_PATHFINDING) g_LogFile << "✓ Direct path clear!" << std::endl;
+        if (DEBUG_PATHFINDING) PathLog() << "✓ Direct path clear!" << std::endl;
 
         std::vector<PathNode> path;
         /*for (int i = 0; i < launchApproach.size(); i++) {
-            g_LogFile << launchApproach[i].pos.x << " " << launchApproach[i].pos.y << " " << launchApproach[i].pos.z << " " << std::endl;
+            PathLog() << launchApproach[i].pos.x << " " << launchApproach[i].pos.y << " " << launchApproach[i].pos.z << " " << std::endl;
         }
         for (int i = 0; i < groundApproach.size(); i++) {
-            g_LogFile << groundApproach[i].pos.x << " " << groundApproach[i].pos.y << " " << groundApproach[i].pos.z << " " << std::endl;
+            PathLog() << groundApproach[i].pos.x << " " << groundApproach[i].pos.y << " " << groundApproach[i].pos.z << " " << std::endl;
         }*/
 
         // APPEND LAUNCH APPROACH
@@ -2034,27 +3443,58 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
         return path;
     }
 
-    // Pre-allocate containers
-    std::vector<FlightNode3D> nodes;
-    nodes.reserve(500000);
-    std::unordered_map<GridKey, int, GridKeyHash> gridToIndex;
-    gridToIndex.reserve(500000);
-    std::unordered_set<int> closedSet;
-    closedSet.reserve(150000);
-    // -----------------------------------------------------------
-
-    for (int i = 0; i < 4; ++i) {
-        AStarAttempt& att = attempts[i];
+    // 3. COARSE-TO-FINE: route long flights over the 32x and then the 8x FMap LOD, and
+    // only let the fine A* expand inside the corridor around that route
+    FlightCorridor corridor;
+    if (groundStart.Dist2D(flightGoal) > FLIGHT_LOD_MIN_DISTANCE) {
+        float lodSearchRadius = (groundStart.Dist3D(flightGoal) * 0.8f) + 200.0f;
+        FlightCorridor coarse = PlanFlightCorridor(groundStart, flightGoal, mapId,
+            FLIGHT_LOD_COARSE_LEVEL, FLIGHT_LOD_COARSE_CORRIDOR, lodSearchRadius);
+        if (!coarse.empty()) {
+            corridor = PlanFlightCorridor(groundStart, flightGoal, mapId,
+                FLIGHT_LOD_FINE_LEVEL, FLIGHT_LOD_FINE_CORRIDOR, lodSearchRadius, &coarse);
+            if (corridor.empty()) corridor = std::move(coarse);
+        }
+    }
+
+    // 4. A* ATTEMPTS
+    // The attempts run side by side on g_SegmentPlanner and are accepted in priority
+    // order: attempt k wins once every attempt before it has failed. An attempt that
+    // finds a path outranks everything after it, and those give up at once (bestFound).
+    // Under a roof (cave, canopy) the forward frontier floods before it finds the way
+    // out, so there the bidirectional attempts go first.
+    enum AttemptStatus { ATTEMPT_FOUND, ATTEMPT_FAILED, ATTEMPT_ABORTED, ATTEMPT_NOT_IN_CORRIDOR };
+    std::atomic<int> bestFound{ FLIGHT_ATTEMPTS_TRIED };
+
+    std::vector<int> attemptOrder(FLIGHT_ATTEMPTS_TRIED);
+    for (int i = 0; i < FLIGHT_ATTEMPTS_TRIED; ++i) attemptOrder[i] = i;
+    if (!IsClearSky(mapId, flightGoal.x, flightGoal.y, flightGoal.z)) {
+        std::stable_partition(attemptOrder.begin(), attemptOrder.end(), [&](int i) { return attempts[i].bidirectional; });
+    }
+
+    auto RunAttempt = [&](int rank, bool useCorridor, std::vector<PathNode>& out) -> int {
+        int i = attemptOrder[rank];
+        AStarAttempt att = attempts[i]; // Own copy: the node budget grows during the search
+        // This thread's node store; it keeps its memory from earlier searches
+        FlightNodeArena& arena = g_FlightNodeArena;
+        std::vector<FlightNode3D>& nodes = arena.nodes;
         // RESET
-        nodes.clear();
-        gridToIndex.clear();
-        closedSet.clear();
+        arena.Reset();
 
         IndexPriorityQueue openSet(&nodes);
+        FlightPointCacheStats pointStats;
+        auto attemptStart = std::chrono::steady_clock::now();
+        int losChecks = 0;
+        // The bidirectional stop test needs f to be a true lower bound. No step costs less
+        // than CLIMB_BONUS per yard, so distance * CLIMB_BONUS never overestimates (and is
+        // consistent); the one-sided searches keep the faster weighted heuristic.
+        const float hWeight = att.bidirectional ? CLIMB_BONUS : HEURISTIC_WEIGHT;
 
         if (DEBUG_PATHFINDING) {
-            g_LogFile << ">>> A* Attempt " << (i + 1) << " (" << att.name << ") <<<" << std::endl;
-            g_LogFile << "   BaseGrid: " << att.baseGridSize << " | Dynamic: " << att.dynamic << std::endl;
+            PathLog() << ">>> A* Attempt " << (i + 1) << " (" << att.name << ") <<<" << std::endl;
+            PathLog() << "   BaseGrid: " << att.baseGridSize << " | Dynamic: " << att.dynamic << " | Lazy Theta*: " << att.lazyTheta
+                << " | Bidirectional: " << att.bidirectional << std::endl;
+            if (useCorridor) PathLog() << "   Corridor: " << corridor.blocks.size() << " blocks (level " << corridor.level << ")" << std::endl;
         }
 
         float currentSearchRadius = (groundStart.Dist3D(flightGoal) * 0.8f) + 200.0f; // Increased search radius slightly
@@ -2065,8 +3505,8 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
 
         auto GetOrCreateNode = [&](const Vector3& pos) -> int {
             GridKey key(pos, att.baseGridSize);
-            auto it = gridToIndex.find(key);
-            if (it != gridToIndex.end()) return it->second;
+            int existing = arena.Find(key.x, key.y, key.z);
+            if (existing >= 0) return existing;
 
             // Snap position to base grid to prevent floating point drift
             // This ensures a "Large Step" lands exactly on a "Small Step" node.
@@ -2077,38 +3517,65 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
             );
 
             if (snappedPos.Dist3D(midpoint) > currentSearchRadius + 50.0f) return -1;
-            if (!globalNavMesh.CheckFlightPoint(snappedPos, mapId, !att.strict)) return -1;
+            if (useCorridor && !corridor.Contains(snappedPos)) return -1;
+            bool flyable = g_FlightPointCache.Check(mapId, snappedPos, !att.strict, pointStats, [&]() {
+                return globalNavMesh.CheckFlightPoint(snappedPos, mapId, !att.strict);
+            });
+            if (!flyable) return -1;
 
             size_t idx = nodes.size();
             nodes.emplace_back();
             nodes[idx].pos = snappedPos;
-            nodes[idx].hScore = snappedPos.Dist3D(flightGoal) * HEURISTIC_WEIGHT;
-            gridToIndex[key] = idx;
+            nodes[idx].hScore = snappedPos.Dist3D(flightGoal) * hWeight;
+            nodes[idx].hScoreBack = snappedPos.Dist3D(groundStart) * hWeight;
+            arena.Cell(key.x, key.y, key.z) = (int32_t)idx;
             return idx;
             };
 
+        auto LineOfSight = [&](const Vector3& from, const Vector3& to, bool strict) {
+            losChecks++;
+            return globalNavMesh.CheckFlightSegment(from, to, mapId, isFlying, strict, false);
+        };
+
         // Initialize Start/End (Keep existing logic)
         size_t startIdx = nodes.size();
         nodes.emplace_back();
         nodes[startIdx].pos = groundStart;
         nodes[startIdx].gScore = 0.0f;
-        nodes[startIdx].hScore = groundStart.Dist3D(flightGoal) * HEURISTIC_WEIGHT;
-        gridToIndex[GridKey(groundStart, att.baseGridSize)] = startIdx; // Hash with Base Grid
+        nodes[startIdx].hScore = groundStart.Dist3D(flightGoal) * hWeight;
+        GridKey startKey(groundStart, att.baseGridSize); // Indexed on the base grid
+        arena.Cell(startKey.x, startKey.y, startKey.z) = (int32_t)startIdx;
 
         size_t endIdx = nodes.size();
         nodes.emplace_back();
         nodes[endIdx].pos = flightGoal;
         nodes[endIdx].hScore = 0.0f;
+        nodes[endIdx].hScoreBack = flightGoal.Dist3D(groundStart) * hWeight;
 
         bool endIsValid = globalNavMesh.CheckFlightPoint(flightGoal, mapId, true);
         if (endIsValid) {
-            gridToIndex[GridKey(flightGoal, att.baseGridSize)] = endIdx;
+            GridKey endKey(flightGoal, att.baseGridSize);
+            arena.Cell(endKey.x, endKey.y, endKey.z) = (int32_t)endIdx;
         }
 
         openSet.push(startIdx);
         int goalIdx = -1;
         int iterations = 0;
 
+        // --- DYNAMIC STEP SIZING ---
+        // If far away, use larger steps to cover ground quickly. Multipliers must be
+        // integers so nodes align with the base grid.
+        auto StepFor = [&](float distToTarget) {
+            float step = att.baseGridSize;
+            if (att.dynamic) {
+                if (distToTarget > 1000.0f) { step *= 8.0f; } // e.g. 8.0 * 2 = 32 yard steps
+                else if (distToTarget > 200.0f) { step *= 4.0f; } // e.g. 4.0 * 4 = 16 yard steps
+                else if (distToTarget > 50.0f) { step *= 2.0f; } // e.g. 4.0 * 2 = 8 yard steps
+                // else: < 50 yards, use baseGridSize (4 yards) for precision
+            }
+            return step;
+        };
+
         // Neighbor Directions (Keep existing array)
         const int neighborDirs[][3] = {
             {1,0,1}, {-1,0,1}, {0,1,1}, {0,-1,1},
@@ -2119,6 +3586,31 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
             {1,0,-1}, {-1,0,-1}, {0,1,-1}, {0,-1,-1}
         };
 
+        // LAZY THETA*: a generated node takes its generator's parent without any check.
+        // When it comes off the open set that edge is checked once (strict, like the
+        // smoothing pass it replaces). If it is blocked the node falls back to the lattice
+        // edge from its generator; if that is blocked too it is put back unreached, and
+        // any later expansion that can see it may generate it again.
+        auto LazyThetaSetParent = [&](int idx) -> bool {
+            FlightNode3D& node = nodes[idx];
+            if (idx == (int)startIdx) return true;
+            if (node.parentIdx < 0) return false; // Stale heap entry of a node that was put back
+            if (LineOfSight(nodes[node.parentIdx].pos, node.pos, idx != (int)endIdx)) return true;
+
+            int from = node.fromIdx;
+            if (from >= 0 && from != node.parentIdx &&
+                LineOfSight(nodes[from].pos, node.pos, att.strict && idx != (int)endIdx)) {
+                node.parentIdx = from;
+                node.gScore = nodes[from].gScore + nodes[from].pos.Dist3D(node.pos);
+                return true;
+            }
+
+            node.parentIdx = -1;
+            node.fromIdx = -1;
+            node.gScore = 1e9f;
+            return false;
+        };
+
         float totalDistToGoal = groundStart.Dist3D(flightGoal);
         /*if (totalDistToGoal > 100.0f) att.maxNodes *= ceil(totalDistToGoal / att.baseGridSize);
         if (totalDistToGoal > 2000.0f) att.maxNodes *= 16;
@@ -2126,15 +3618,133 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
         else if (totalDistToGoal > 200.0f) att.maxNodes *= 4;
         else if (totalDistToGoal > 50.0f) att.maxNodes *= 2;*/
 
+        // --- BIDIRECTIONAL SEARCH ---
+        // A second frontier grows from the goal over the same snapped lattice, taking the
+        // forward edges in reverse (negated directions, same step schedule measured to the
+        // start). The smaller frontier expands next. mu is the cheapest start-to-goal cost
+        // through any node both sides have reached. Both frontiers are ordered by an
+        // admissible f (hWeight), so the best f of each side is a lower bound on any path
+        // still to be found through it. The search stops once mu is within
+        // BIDIR_SUBOPTIMALITY of that bound; an exact stop (factor 1) roughly doubled the
+        // expansions in testing for the same path. The bound holds over the nodes the two
+        // sides searched (with dynamic steps their lattices differ slightly), and not when
+        // the node budget runs out first, where the best meeting so far is taken.
+        if (att.bidirectional) {
+            IndexPriorityQueue backSet(&nodes, true);
+            nodes[endIdx].gScoreBack = 0.0f;
+            backSet.push(endIdx);
+
+            float mu = 1e9f;
+            int meetIdx = -1;
+            auto Meet = [&](int idx) {
+                float total = nodes[idx].gScore + nodes[idx].gScoreBack;
+                if (nodes[idx].gScore < 1e9f && nodes[idx].gScoreBack < 1e9f && total < mu) {
+                    mu = total;
+                    meetIdx = idx;
+                }
+            };
+
+            while (true) {
+                if (PathRequestCancelled() || bestFound < rank) return ATTEMPT_ABORTED;
+
+                while (!openSet.empty() && nodes[openSet.top()].closed) openSet.pop();
+                while (!backSet.empty() && nodes[backSet.top()].closedBack) backSet.pop();
+                if (openSet.empty() || backSet.empty()) break;
+
+                if (meetIdx >= 0 && (std::max)(nodes[openSet.top()].fScore(), nodes[backSet.top()].fScoreBack()) * BIDIR_SUBOPTIMALITY >= mu) break;
+
+                if (iterations >= att.maxNodes) {
+                    if (meetIdx >= 0) break; // Take the best meeting so far
+                    att.maxNodes += 1000;
+                    // Hard limit to prevent memory exhaustion/infinite hangs
+                    if (att.maxNodes >= 200000) {
+                        PathLog() << "A* Hard Limit Reached (200k)" << std::endl;
+                        break;
+                    }
+                }
+
+                bool forward = openSet.size() <= backSet.size();
+                IndexPriorityQueue& frontier = forward ? openSet : backSet;
+                int currentIdx = frontier.top();
+                frontier.pop();
+                if (forward) nodes[currentIdx].closed = true;
+                else nodes[currentIdx].closedBack = true;
+                iterations++;
+
+                Vector3 currentPos = nodes[currentIdx].pos;
+                float currentG = forward ? nodes[currentIdx].gScore : nodes[currentIdx].gScoreBack;
+                float currentStep = StepFor(currentPos.Dist3D(forward ? flightGoal : groundStart));
+                float sign = forward ? 1.0f : -1.0f;
+
+                for (int j = 0; j < 22; ++j) {
+                    Vector3 neighborPos = currentPos + Vector3(
+                        neighborDirs[j][0] * currentStep * sign,
+                        neighborDirs[j][1] * currentStep * sign,
+                        neighborDirs[j][2] * currentStep * sign);
+                    if (neighborPos.Dist3D(midpoint) > currentSearchRadius) continue;
+
+                    int neighborIdx = GetOrCreateNode(neighborPos);
+                    if (neighborIdx < 0 || neighborIdx == currentIdx) continue;
+                    if (forward ? nodes[neighborIdx].closed : nodes[neighborIdx].closedBack) continue;
+
+                    // Same rules as the forward search: the goal's edges and short hops are relaxed
+                    const Vector3& from = forward ? currentPos : nodes[neighborIdx].pos;
+                    const Vector3& to = forward ? nodes[neighborIdx].pos : currentPos;
+                    bool strictCheck = att.strict && neighborIdx != (int)endIdx && currentIdx != (int)endIdx;
+                    if (from.Dist3D(to) < currentStep) strictCheck = false;
+                    if (!LineOfSight(from, to, strictCheck)) continue;
+
+                    float dist = from.Dist3D(to);
+                    float bonus = (neighborDirs[j][2] > 0) ? CLIMB_BONUS : 1.0f;
+                    float tentativeG = currentG + (dist * bonus);
+
+                    if (forward && tentativeG < nodes[neighborIdx].gScore) {
+                        nodes[neighborIdx].parentIdx = currentIdx;
+                        nodes[neighborIdx].gScore = tentativeG;
+                        openSet.push(neighborIdx);
+                        Meet(neighborIdx);
+                    }
+                    else if (!forward && tentativeG < nodes[neighborIdx].gScoreBack) {
+                        nodes[neighborIdx].parentBack = currentIdx;
+                        nodes[neighborIdx].gScoreBack = tentativeG;
+                        backSet.push(neighborIdx);
+                        Meet(neighborIdx);
+                    }
+                }
+            }
+
+            if (meetIdx >= 0) {
+                // Hang the goal-side half off the meeting node so the trace below runs goal to start
+                int curr = meetIdx;
+                int next = nodes[curr].parentBack;
+                int safety = 0;
+                while (next >= 0 && safety++ < 5000) {
+                    int after = nodes[next].parentBack;
+                    nodes[next].parentIdx = curr;
+                    curr = next;
+                    next = after;
+                }
+                goalIdx = endIdx;
+
+                if (DEBUG_PATHFINDING) {
+                    PathLog() << "   Bidirectional: frontiers met at (" << nodes[meetIdx].pos.x << ", " << nodes[meetIdx].pos.y << ", "
+                        << nodes[meetIdx].pos.z << "), cost " << mu << std::endl;
+                }
+            }
+        }
+
         int bestIdxCheck = -1;
         float closest = 1e9f;
 
-        while (!openSet.empty() && iterations < att.maxNodes) {
+        while (!att.bidirectional && !openSet.empty() && iterations < att.maxNodes) {
+            if (PathRequestCancelled() || bestFound < rank) return ATTEMPT_ABORTED;
+
             int currentIdx = openSet.top();
             openSet.pop();
 
-            if (closedSet.count(currentIdx)) continue;
-            closedSet.insert(currentIdx);
+            if (nodes[currentIdx].closed) continue;
+            if (att.lazyTheta && !LazyThetaSetParent(currentIdx)) continue;
+            nodes[currentIdx].closed = true;
             iterations++;
 
             Vector3 currentPos = nodes[currentIdx].pos;
@@ -2160,11 +3770,11 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
 
                         // Hard limit to prevent memory exhaustion/infinite hangs
                         if (att.maxNodes >= 200000) {
-                            g_LogFile << "A* Hard Limit Reached (200k)" << std::endl;
+                            PathLog() << "A* Hard Limit Reached (200k)" << std::endl;
                             break;
                         }
 
-                        g_LogFile << "A* Max Nodes Reached. Extending to: " << att.maxNodes << " | Nearest: " << closest << " | " << flightGoal.x << " " << flightGoal.y << " " << flightGoal.z << std::endl;
+                        PathLog() << "A* Max Nodes Reached. Extending to: " << att.maxNodes << " | Nearest: " << closest << " | " << flightGoal.x << " " << flightGoal.y << " " << flightGoal.z << std::endl;
                     }
                 }
             }
@@ -2173,6 +3783,7 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
             // Every 100 iterations, check if we have a direct line to the goal.
             if (iterations % 100 == 0) {
                 Vector3 failPos;
+                losChecks++;
                 // Check direct path from current node to FlightGoal
                 // Use 'false' for strict to allow a slightly looser check for this "Hail Mary" pass
                 if (globalNavMesh.CheckFlightSegmentDetailed(currentPos, flightGoal, mapId, failPos, isFlying, false) == SEGMENT_VALID) {
@@ -2183,38 +3794,19 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
                     goalIdx = endIdx;
 
                     if (DEBUG_PATHFINDING) {
-                        g_LogFile << "? A* Shortcut found at iteration " << iterations << std::endl;
+                        PathLog() << "? A* Shortcut found at iteration " << iterations << std::endl;
                     }
                     break; // Exit loop, path found!
                 }
             }
 
             // --- DYNAMIC STEP SIZING LOGIC ---
-            float currentStep = att.baseGridSize;
-
-            if (att.dynamic) {
-                // If far away, use larger steps to cover ground quickly.
-                // Multipliers must be integers so nodes align with the base grid.
-                bool nearStart = currentPos.Dist3D(groundStart) < 20.0f;
-                bool nearEnd = currentPos.Dist3D(flightGoal) < 8.0f;
-                //if (nearEnd) {
-                //    currentStep /= 8.0f;  // Causes issues for some reason
-                //}
-                //bool nearStart = current.gScore < 20.0f;
-                //bool nearEnd = distToGoal < 20.0f;
-
-                //if (!nearEnd) {
-                if (distToGoal > 1000.0f) { currentStep *= 8.0f; } // e.g. 8.0 * 2 = 32 yard steps
-                else if (distToGoal > 200.0f) { currentStep *= 4.0f; } // e.g. 4.0 * 4 = 16 yard steps
-                else if (distToGoal > 50.0f) { currentStep *= 2.0f; } // e.g. 4.0 * 2 = 8 yard steps
-                //}
-
-                // else: < 50 yards, use baseGridSize (4 yards) for precision
-            }
+            float currentStep = StepFor(distToGoal);
 
             // Check connection to goal (Keep existing logic)
             if (currentIdx == endIdx || distToGoal < (currentStep * 1.5f)) { // Adjusted threshold based on step
                 Vector3 failPos;
+                losChecks++;
                 if (globalNavMesh.CheckFlightSegmentDetailed(currentPos, flightGoal, mapId, failPos, isFlying, false) == SEGMENT_VALID) {
                     if (currentIdx != endIdx) {
                         nodes[endIdx].parentIdx = currentIdx;
@@ -2223,7 +3815,7 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
                     goalIdx = endIdx;
                     break;
                 }
-                g_LogFile << currentPos.x << " " << currentPos.y << " " << currentPos.z << std::endl;
+                PathLog() << currentPos.x << " " << currentPos.y << " " << currentPos.z << std::endl;
             }
 
             // Expand Neighbors
@@ -2240,7 +3832,20 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
                 if (neighborPos.Dist3D(midpoint) > currentSearchRadius) continue;
 
                 int neighborIdx = GetOrCreateNode(neighborPos);
-                if (neighborIdx < 0 || closedSet.count(neighborIdx)) continue;
+                if (neighborIdx < 0 || nodes[neighborIdx].closed) continue;
+
+                if (att.lazyTheta) {
+                    // Path 2 of Theta*: assume the grandparent sees the neighbour
+                    int parent = nodes[currentIdx].parentIdx >= 0 ? nodes[currentIdx].parentIdx : currentIdx;
+                    float tentativeG = nodes[parent].gScore + nodes[parent].pos.Dist3D(nodes[neighborIdx].pos);
+                    if (tentativeG < nodes[neighborIdx].gScore) {
+                        nodes[neighborIdx].parentIdx = parent;
+                        nodes[neighborIdx].fromIdx = currentIdx;
+                        nodes[neighborIdx].gScore = tentativeG;
+                        openSet.push(neighborIdx);
+                    }
+                    continue;
+                }
 
                 bool isGoalNeighbor = (neighborIdx == endIdx);
                 bool strictCheck = att.strict && !isGoalNeighbor;
@@ -2250,13 +3855,12 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
                 }
 
                 // Collision check must cover the full dynamic step distance
-                if (!globalNavMesh.CheckFlightSegment(currentPos, nodes[neighborIdx].pos, mapId,
-                    isFlying, strictCheck, false)) {
+                if (!LineOfSight(currentPos, nodes[neighborIdx].pos, strictCheck)) {
                     continue;
                 }
 
                 float dist = currentPos.Dist3D(nodes[neighborIdx].pos);
-                float bonus = (neighborDirs[j][2] > 0) ? 0.95f : 1.0f;
+                float bonus = (neighborDirs[j][2] > 0) ? CLIMB_BONUS : 1.0f;
 
                 float tentativeG = currentG + (dist * bonus);
                 if (tentativeG < nodes[neighborIdx].gScore) {
@@ -2267,11 +3871,19 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
             }
         }
 
+        if (DEBUG_PATHFINDING) {
+            PathLog() << "   Point cache: " << pointStats.hits << " hits, " << pointStats.misses << " misses ("
+                << (int)(pointStats.HitRate() * 100.0f) << "% hit)" << std::endl;
+            PathLog() << "   Search: " << iterations << " nodes expanded, " << losChecks << " LOS checks, "
+                << std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - attemptStart).count() << " ms" << std::endl;
+        }
+
         // 1. FIND BEST PARTIAL NODE (If goal not reached)
         int bestPartialIdx = -1;
-        if (goalIdx < 0 && !closedSet.empty()) {
+        if (goalIdx < 0 && iterations > 0) {
             float closestDist = 1e9f;
-            for (int idx : closedSet) {
+            for (int idx = 0; idx < (int)nodes.size(); ++idx) {
+                if (!nodes[idx].closed) continue;
                 float d = nodes[idx].pos.Dist3D(flightGoal);
                 if (d < closestDist) {
                     closestDist = d;
@@ -2282,24 +3894,25 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
 
         //DIAGNOSTICS
         if (goalIdx < 0 && DEBUG_PATHFINDING) {
-            g_LogFile << "\n   [DIAGNOSTIC] Why did A* fail?" << std::endl;
+            PathLog() << "\n   [DIAGNOSTIC] Why did A* fail?" << std::endl;
 
             // Check if end node exists
             if (endIdx < nodes.size()) {
-                g_LogFile << "   - End node exists at index " << endIdx << "" << std::endl;
-                g_LogFile << "   - End node position: (" << nodes[endIdx].pos.x << ","
+                PathLog() << "   - End node exists at index " << endIdx << "" << std::endl;
+                PathLog() << "   - End node position: (" << nodes[endIdx].pos.x << ","
                     << nodes[endIdx].pos.y << "," << nodes[endIdx].pos.z << ")" << std::endl;
-                g_LogFile << "   - End node gScore: " << nodes[endIdx].gScore << "" << std::endl;
-                g_LogFile << "   - End node parent: " << nodes[endIdx].parentIdx << "" << std::endl;
+                PathLog() << "   - End node gScore: " << nodes[endIdx].gScore << "" << std::endl;
+                PathLog() << "   - End node parent: " << nodes[endIdx].parentIdx << "" << std::endl;
 
                 // Check if it was ever added to open set
-                bool inClosed = closedSet.count(endIdx);
-                g_LogFile << "   - End node in closed set: " << inClosed << "" << std::endl;
+                bool inClosed = nodes[endIdx].closed;
+                PathLog() << "   - End node in closed set: " << inClosed << "" << std::endl;
 
                 // Find closest node that WAS explored
                 float closestDist = 1e9f;
                 int closestIdx = -1;
-                for (int idx : closedSet) {
+                for (int idx = 0; idx < (int)nodes.size(); ++idx) {
+                    if (!nodes[idx].closed) continue;
                     float d = nodes[idx].pos.Dist3D(flightGoal);
                     if (d < closestDist) {
                         closestDist = d;
@@ -2308,25 +3921,25 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
                 }
 
                 if (closestIdx >= 0) {
-                    g_LogFile << "   - Closest explored node: (" << nodes[closestIdx].pos.x << ","
+                    PathLog() << "   - Closest explored node: (" << nodes[closestIdx].pos.x << ","
                         << nodes[closestIdx].pos.y << "," << nodes[closestIdx].pos.z << ")" << std::endl;
-                    g_LogFile << "   - Distance from closest to goal: " << closestDist << "" << std::endl;
+                    PathLog() << "   - Distance from closest to goal: " << closestDist << "" << std::endl;
 
-                    g_LogFile << nodes[closestIdx].pos.x << " " << nodes[closestIdx].pos.y << " " << nodes[closestIdx].pos.z << " | " << flightGoal.x << " " << flightGoal.y << " " << flightGoal.z << " " << std::endl;
+                    PathLog() << nodes[closestIdx].pos.x << " " << nodes[closestIdx].pos.y << " " << nodes[closestIdx].pos.z << " | " << flightGoal.x << " " << flightGoal.y << " " << flightGoal.z << " " << std::endl;
 
                     // Try to connect them
                     Vector3 failPos;
                     FlightSegmentResult testResult = globalNavMesh.CheckFlightSegmentDetailed(
                         nodes[closestIdx].pos, flightGoal, mapId, failPos, isFlying, false, true, false);
 
-                    g_LogFile << "   - Can connect closest to goal: "
+                    PathLog() << "   - Can connect closest to goal: "
                         << (testResult == SEGMENT_VALID ? "YES" : "NO") << "" << std::endl;
                     if (testResult != SEGMENT_VALID) {
-                        g_LogFile << "   - Blockage at: (" << failPos.x << "," << failPos.y << "," << failPos.z << ")" << std::endl;
+                        PathLog() << "   - Blockage at: (" << failPos.x << "," << failPos.y << "," << failPos.z << ")" << std::endl;
                     }
                 }
             }
-            g_LogFile << "" << std::endl;
+            PathLog() << "" << std::endl;
         }
 
         // --- RESULT CHECK & RECONSTRUCTION ---
@@ -2341,14 +3954,14 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
             // Check if partial path is worth it (must be closer than start)
             float startDist = groundStart.Dist3D(flightGoal);
             float currentDist = nodes[bestPartialIdx].pos.Dist3D(flightGoal);
-            g_LogFile << currentDist << " " << startDist << std::endl;
+            PathLog() << currentDist << " " << startDist << std::endl;
 
             // Allow partial if we made progress (e.g. moved at least 25 yards closer)
             if (currentDist < partialPathThreshold) {
                 traceStartIdx = bestPartialIdx;
                 isPartial = true;
                 if (DEBUG_PATHFINDING) {
-                    g_LogFile << "A* Partial Success: Returning path to closest point (Dist: " << currentDist << ")" << std::endl;
+                    PathLog() << "A* Partial Success: Returning path to closest point (Dist: " << currentDist << ")" << std::endl;
                 }
             }
             // If we got close to the goal land and follow a ground path
@@ -2383,7 +3996,7 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
             // --- STRICT SUCCESS CHECK (Skipped if we explicitly allowed partial) ---
             if (!isPartial && path.back().pos.Dist3D(flightGoal) > partialPathThreshold) {
                 if (DEBUG_PATHFINDING) {
-                    g_LogFile << "✗ Attempt " << (i + 1) << " found path but it stops short ("
+                    PathLog() << "✗ Attempt " << (i + 1) << " found path but it stops short ("
                         << path.back().pos.Dist3D(flightGoal) << " yds). Retrying..." << std::endl;
                 }
                 // If you want to force retries for better paths, uncomment continue. 
@@ -2391,8 +4004,8 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
                 // continue; 
             }
 
-            // Path Smoothing
-            if (path.size() > 2) {
+            // Path Smoothing (Lazy Theta* paths are any-angle and every edge is already checked)
+            if (path.size() > 2 && !att.lazyTheta) {
                 std::vector<PathNode> smoothed;
                 smoothed.push_back(path[0]);
                 size_t c = 0;
@@ -2402,7 +4015,7 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
                         // Change 'strictCollision' to 'true'
                         // This forces the optimized path to ALWAYS respect the full safety radius,
                         // even if the original search had to relax constraints to find a route.
-                        if (globalNavMesh.CheckFlightSegment(path[c].pos, path[n].pos, mapId, isFlying, true)) {
+                        if (LineOfSight(path[c].pos, path[n].pos, true)) {
                             f = n;
                             break;
                         }
@@ -2429,20 +4042,32 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
                 path.push_back(PathNode(actualEnd, PATH_AIR));
             }
 
-            if (DEBUG_PATHFINDING) g_LogFile << "✓ A* SUCCESS on Attempt " << (i + 1) << std::endl;
-            return path;
+            if (DEBUG_PATHFINDING) {
+                PathLog() << "✓ A* SUCCESS on Attempt " << (i + 1) << " (" << path.size() << " nodes, " << losChecks << " LOS checks incl. smoothing, "
+                    << std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - attemptStart).count() << " ms)" << std::endl;
+            }
+            out = std::move(path);
+            return ATTEMPT_FOUND;
+        }
+
+        // The corridor comes from conservative bounds (top layers only), so a route under
+        // an overhang or through a cave isn't in it: the caller runs this attempt again unrestricted
+        if (useCorridor) {
+            if (DEBUG_PATHFINDING) PathLog() << "   [FlightLOD] No path inside the corridor. Retrying without it..." << std::endl;
+            return ATTEMPT_NOT_IN_CORRIDOR;
         }
 
         // --- FAILURE FALLBACK (On Final Attempt) ---
-        if (i == 1) {
-            return {};
-            if (DEBUG_PATHFINDING) g_LogFile << "   [FALLBACK] Attempting Hybrid Air-to-Ground Recovery..." << std::endl;
+        if (rank == FLIGHT_ATTEMPTS_TRIED - 1) {
+            return ATTEMPT_FAILED;
+            if (DEBUG_PATHFINDING) PathLog() << "   [FALLBACK] Attempting Hybrid Air-to-Ground Recovery..." << std::endl;
 
             // 1. Find the node closest to the destination
             int bestIdx = -1;
             float closestDist = 1e9f;
 
-            for (int idx : closedSet) {
+            for (int idx = 0; idx < (int)nodes.size(); ++idx) {
+                if (!nodes[idx].closed) continue;
                 float d = nodes[idx].pos.Dist3D(flightGoal);
                 if (d < closestDist) {
                     closestDist = d;
@@ -2476,26 +4101,74 @@ inline std::vector<PathNode> Calculate3DFlightPath(Vector3& start, Vector3& end,
                 }
 
                 if (DEBUG_PATHFINDING) {
-                    g_LogFile << "   [FALLBACK] Landing at: " << landPos.x << "," << landPos.y << "," << landPos.z << std::endl;
+                    PathLog() << "   [FALLBACK] Landing at: " << landPos.x << "," << landPos.y << "," << landPos.z << std::endl;
                 }
 
                 // 4. Calculate Ground Path to actual target
                 std::vector<PathNode> groundPath = FindPath(landPos, flightGoal, ignoreWater);
 
                 if (!groundPath.empty() && groundPath.back().pos.Dist3D(end) < 3.0f) {
-                    if (DEBUG_PATHFINDING) g_LogFile << "   [FALLBACK] ✓ Found Ground Path (" << groundPath.size() << " wps). Stitching..." << std::endl;
+                    if (DEBUG_PATHFINDING) PathLog() << "   [FALLBACK] ✓ Found Ground Path (" << groundPath.size() << " wps). Stitching..." << std::endl;
 
                     // 5. Stitch: Flight -> Landing Spot -> Ground Path
                     recoveryPath.push_back(PathNode(landPos, PATH_GROUND));
                     recoveryPath.insert(recoveryPath.end(), groundPath.begin(), groundPath.end());
 
-                    return recoveryPath; // Return the hybrid path
+                    out = std::move(recoveryPath); // Return the hybrid path
+                    return ATTEMPT_FOUND;
                 }
             }
         }
+        return ATTEMPT_FAILED;
+    };
+
+    std::vector<std::vector<PathNode>> attemptPaths(FLIGHT_ATTEMPTS_TRIED);
+    std::vector<int> attemptStatus(FLIGHT_ATTEMPTS_TRIED, ATTEMPT_ABORTED);
+    const std::atomic<bool>* jobToken = g_PathCancelToken;
+    const std::atomic<bool>* segmentToken = g_PathSegmentAbort;
+    PathLogBlock* segmentLog = g_PathLogBlock;
+    std::thread::id caller = std::this_thread::get_id();
+
+    g_SegmentPlanner.ParallelFor(FLIGHT_ATTEMPTS_TRIED, [&](size_t n) {
+        int rank = (int)n;
+        bool helper = std::this_thread::get_id() != caller;
+
+        // Helpers search under the caller's hold on the mesh, its cancel tokens and its log
+        const std::atomic<bool>* savedToken = g_PathCancelToken;
+        const std::atomic<bool>* savedAbort = g_PathSegmentAbort;
+        PathLogBlock* savedLog = g_PathLogBlock;
+        if (helper) g_NavMeshMutex.BorrowShared();
+        g_PathCancelToken = jobToken;
+        g_PathSegmentAbort = segmentToken;
+        g_PathLogBlock = segmentLog;
+
+        // Both attempts log heavily; keep each one's lines together
+        PathLogBlock attemptLog;
+        int status = ATTEMPT_ABORTED;
+        if (!PathRequestCancelled() && bestFound >= rank) {
+            status = RunAttempt(rank, !corridor.empty(), attemptPaths[rank]);
+            if (status == ATTEMPT_NOT_IN_CORRIDOR) status = RunAttempt(rank, false, attemptPaths[rank]);
+        }
+        if (status == ATTEMPT_FOUND) {
+            int best = bestFound;
+            while (rank < best && !bestFound.compare_exchange_weak(best, rank)) {}
+        }
+        attemptStatus[rank] = status;
+
+        attemptLog.Close();
+        g_PathCancelToken = savedToken;
+        g_PathSegmentAbort = savedAbort;
+        g_PathLogBlock = savedLog;
+        if (helper) g_NavMeshMutex.ReturnShared();
+    });
+
+    // Everything before bestFound failed, so it is the highest-priority path found
+    if (bestFound < FLIGHT_ATTEMPTS_TRIED && attemptStatus[bestFound] == ATTEMPT_FOUND) {
+        if (DEBUG_PATHFINDING) PathLog() << "Flight path taken from attempt " << (attemptOrder[bestFound] + 1) << std::endl;
+        return std::move(attemptPaths[bestFound]);
     }
 
-    if (DEBUG_PATHFINDING) g_LogFile << "!!! CRITICAL: All flight attempts failed." << std::endl;
+    if (DEBUG_PATHFINDING) PathLog() << "!!! CRITICAL: All flight attempts failed." << std::endl;
     return {};
 }
 
@@ -2605,7 +4278,7 @@ inline std::vector<PathNode> OptimizeFlightPath(const std::vector<PathNode>& pat
 // NEW FUNCTION TO CLEAN GROUND Z
 inline void CleanPathGroundZ(std::vector<PathNode>& path, int mapId) {
     if (DEBUG_PATHFINDING && !path.empty()) {
-        g_LogFile << "[CLEANUP] Cleaning ground Z for " << path.size() << " waypoints..." << std::endl;
+        PathLog() << "[CLEANUP] Cleaning ground Z for " << path.size() << " waypoints..." << std::endl;
     }
 
     for (auto& node : path) {
@@ -2633,7 +4306,7 @@ inline std::vector<PathNode> NudgeGroundPath(std::vector<PathNode> path, float a
     if (path.size() < 3) return path;
 
     if (DEBUG_PATHFINDING) {
-        g_LogFile << "[PathCleaner] Nudging ground path to prevent corner clipping..." << std::endl;
+        PathLog() << "[PathCleaner] Nudging ground path to prevent corner clipping..." << std::endl;
     }
 
     std::vector<PathNode> newPath = path;
@@ -2725,8 +4398,8 @@ inline std::vector<PathNode> CalculatePath(const std::vector<Vector3>& inputPath
     std::string mmapFolder = "C:/SMM/data/mmaps/";
 
     if (!std::filesystem::exists(mmapFolder)) {
-        g_LogFile << "[ERROR] CRITICAL: MMap folder does not exist: " << mmapFolder << std::endl;
-        g_LogFile << "[ERROR] Please update 'mmapFolder' in Pathfinding2.h to your correct path." << std::endl;
+        PathLog() << "[ERROR] CRITICAL: MMap folder does not exist: " << mmapFolder << std::endl;
+        PathLog() << "[ERROR] Please update 'mmapFolder' in Pathfinding2.h to your correct path." << std::endl;
         return {}; // Return empty path instead of crashing
     }
 
@@ -2749,7 +4422,7 @@ inline std::vector<PathNode> CalculatePath(const std::vector<Vector3>& inputPath
     bool attemptFlight = (canMount && canFly && inputPath.back().Dist3D(startPos) > 20.0f) || isFlying || (canFly && g_GameState->player.flyingMounted);
 
     if (DEBUG_PATHFINDING) {
-        g_LogFile << "[CalculatePath] mode=" << (attemptFlight ? "FLIGHT" : "GROUND")
+        PathLog() << "[CalculatePath] mode=" << (attemptFlight ? "FLIGHT" : "GROUND")
                   << " canFly=" << canFly << " isFlying=" << isFlying
                   << " canMount=" << canMount << " flyingMounted=" << (g_GameState ? g_GameState->player.flyingMounted : false)
                   << " startPos=(" << startPos.x << "," << startPos.y << "," << startPos.z << ")"
@@ -2794,70 +4467,122 @@ inline std::vector<PathNode> CalculatePath(const std::vector<Vector3>& inputPath
 
     // Sparse loading of only needed tiles
     if (DEBUG_PATHFINDING) {
-        g_LogFile << "[CalculatePath] LoadMap mapId=" << mapId << " loadPoints=" << mapLoadPoints.size() << std::endl;
+        PathLog() << "[CalculatePath] LoadMap mapId=" << mapId << " loadPoints=" << mapLoadPoints.size() << std::endl;
     }
+    NavMeshWriteLock meshWrite(g_NavMeshMutex);
     if (!globalNavMesh.LoadMap(mmapFolder, mapId, &mapLoadPoints, true)) {
-        g_LogFile << "[CalculatePath] LoadMap FAILED mapId=" << mapId << std::endl;
+        PathLog() << "[CalculatePath] LoadMap FAILED mapId=" << mapId << std::endl;
         return {};
     }
     if (DEBUG_PATHFINDING) {
-        g_LogFile << "[CalculatePath] LoadMap OK. NavMesh currentMapId=" << globalNavMesh.currentMapId << std::endl;
+        PathLog() << "[CalculatePath] LoadMap OK. NavMesh currentMapId=" << globalNavMesh.currentMapId << std::endl;
     }
 
+    // The tiles are in; plan on them alongside other searches, but keep writers out
+    // until we are done so none of them gets evicted under us
+    NavMeshReadLock meshRead = g_NavMeshMutex.Downgrade(meshWrite);
+
     size_t lookahead = modifiedInput.size() - 1;
 
-    for (size_t i = 0; i < lookahead; ++i) {
-        Vector3 start = modifiedInput[i];
-        Vector3 end = modifiedInput[i + 1];
+    // --- PLAN SEGMENTS ---
+    // Segments are independent, so the ones not in the cache are planned side by side on
+    // g_SegmentPlanner, then stitched in order below. Flight stays strict: the first
+    // segment that fails raises segmentAbort and the searches still running give up.
+    enum SegmentStatus { PLAN_OK, PLAN_SKIPPED, PLAN_FAILED, PLAN_ABORTED };
+    std::vector<std::vector<PathNode>> segments(lookahead);
+    std::vector<int> segmentStatus(lookahead, PLAN_OK);
+    std::vector<size_t> toPlan;
 
+    for (size_t i = 0; i < lookahead; ++i) {
         // Include mode in cache key to ensure we don't mix ground/flight paths
-        PathCacheKey key(start, end, attemptFlight, ignoreWater);
+        PathCacheKey key(modifiedInput[i], modifiedInput[i + 1], attemptFlight, ignoreWater);
+        if (!globalPathCache.Get(key, segments[i])) toPlan.push_back(i);
+    }
+
+    std::atomic<bool> segmentAbort{ false };
+    const std::atomic<bool>* jobToken = g_PathCancelToken;
+    PathLogBlock* jobLog = g_PathLogBlock;
+    std::thread::id caller = std::this_thread::get_id();
+
+    g_SegmentPlanner.ParallelFor(toPlan.size(), [&](size_t n) {
+        size_t i = toPlan[n];
+        bool helper = std::this_thread::get_id() != caller;
+
+        // Helpers plan under the caller's hold on the mesh, its cancel token and its log
+        const std::atomic<bool>* savedToken = g_PathCancelToken;
+        const std::atomic<bool>* savedAbort = g_PathSegmentAbort;
+        PathLogBlock* savedLog = g_PathLogBlock;
+        if (helper) g_NavMeshMutex.BorrowShared();
+        g_PathCancelToken = jobToken;
+        g_PathSegmentAbort = &segmentAbort;
+        g_PathLogBlock = jobLog;
 
-        std::vector<PathNode>* cached = globalPathCache.Get(key);
-        std::vector<PathNode> segment;
+        // This segment's lines come out together, not interleaved with the others
+        PathLogBlock segmentLog;
+        PathLog() << "[Pathfinding] Segment " << i << ":" << std::endl;
 
-        if (cached) {
-            segment = *cached;
+        Vector3 start = modifiedInput[i];
+        Vector3 end = modifiedInput[i + 1];
+        std::vector<PathNode>& segment = segments[i];
+        int& status = segmentStatus[i];
+
+        if (PathRequestCancelled()) {
+            status = PLAN_ABORTED;
+        }
+        else if (attemptFlight) {
+            // --- ATTEMPT FLIGHT PATH ---
+            // We pass 'true' for isFlying because we are in flight mode.
+            segment = Calculate3DFlightPath(start, end, mapId, true, true, 25.0f, checkGoal, airTarget);
+
+            // --- VALIDATION: Check Final Point ---
+            if (segment.empty() && PathRequestCancelled()) {
+                status = PLAN_ABORTED;
+            }
+            else if (segment.empty()) {
+                PathLog() << "[Pathfinding] Flight path failed (Empty path generated)." << std::endl;
+                status = PLAN_FAILED; // STRICT FAILURE -> Stop Script
+            }
+            else if (segment.back().pos.Dist3D(end) > pathThreshold) {
+                PathLog() << "[Pathfinding] Flight path incomplete. Final point is "
+                    << segment.back().pos.Dist3D(end) << " yards from destination (Threshold: " << pathThreshold << ")." << std::endl;
+                status = PLAN_FAILED; // STRICT FAILURE -> Stop Script
+            }
+            if (status == PLAN_FAILED) segmentAbort = true;
         }
         else {
-            if (attemptFlight) {
-                // --- ATTEMPT FLIGHT PATH ---
-                // We pass 'true' for isFlying because we are in flight mode.
-                segment = Calculate3DFlightPath(start, end, mapId, true, true, 25.0f, checkGoal, airTarget);
-
-                // --- VALIDATION: Check Final Point ---
-                if (segment.empty()) {
-                    g_LogFile << "[Pathfinding] Flight path failed (Empty path generated)." << std::endl;
-                    return {}; // STRICT FAILURE -> Stop Script
-                }
+            // --- ATTEMPT GROUND PATH ---
+            segment = FindPath(start, end, ignoreWater, true, zCheck, groundZExtent);
 
-                if (segment.back().pos.Dist3D(end) > pathThreshold) {
-                    g_LogFile << "[Pathfinding] Flight path incomplete. Final point is "
-                        << segment.back().pos.Dist3D(end) << " yards from destination (Threshold: " << pathThreshold << ")." << std::endl;
-                    return {}; // STRICT FAILURE -> Stop Script
-                }
+            // --- VALIDATION: Check Final Point ---
+            if (segment.empty()) {
+                if (DEBUG_PATHFINDING) PathLog() << "[Pathfinding] Ground segment " << i << " no NavMesh coverage, skipping." << std::endl;
+                status = PLAN_SKIPPED; // Skip this segment — don't abort the entire route
             }
-            else {
-                // --- ATTEMPT GROUND PATH ---
-                segment = FindPath(start, end, ignoreWater, true, zCheck, groundZExtent);
-
-                // --- VALIDATION: Check Final Point ---
-                if (segment.empty()) {
-                    if (DEBUG_PATHFINDING) g_LogFile << "[Pathfinding] Ground segment " << i << " no NavMesh coverage, skipping." << std::endl;
-                    continue; // Skip this segment — don't abort the entire route
-                }
-
-                if (segment.back().pos.Dist3D(end) > pathThreshold) {
-                    if (DEBUG_PATHFINDING) g_LogFile << "[Pathfinding] Ground segment " << i << " endpoint off by "
-                        << segment.back().pos.Dist3D(end) << " yards, skipping." << std::endl;
-                    continue; // Skip rather than abort
-                }
+            else if (segment.back().pos.Dist3D(end) > pathThreshold) {
+                if (DEBUG_PATHFINDING) PathLog() << "[Pathfinding] Ground segment " << i << " endpoint off by "
+                    << segment.back().pos.Dist3D(end) << " yards, skipping." << std::endl;
+                status = PLAN_SKIPPED; // Skip rather than abort
             }
+        }
 
-            // If valid, cache it
-            globalPathCache.Put(key, segment);
+        // If valid, cache it
+        if (status == PLAN_OK) {
+            globalPathCache.Put(PathCacheKey(start, end, attemptFlight, ignoreWater), segment);
         }
 
+        segmentLog.Close();
+        g_PathCancelToken = savedToken;
+        g_PathSegmentAbort = savedAbort;
+        g_PathLogBlock = savedLog;
+        if (helper) g_NavMeshMutex.ReturnShared();
+    });
+
+    if (segmentAbort || PathRequestCancelled()) return {};
+
+    for (size_t i = 0; i < lookahead; ++i) {
+        if (segmentStatus[i] != PLAN_OK) continue;
+        const std::vector<PathNode>& segment = segments[i];
+
         // Stitch segment to full path
         if (stitchedPath.empty()) {
             stitchedPath.insert(stitchedPath.end(), segment.begin(), segment.end());
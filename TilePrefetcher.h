@@ -0,0 +1,244 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <deque>
+#include <set>
+#include <map>
+#include <tuple>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <sstream>
+#include <iomanip>
+
+#include "Vector.h"
+#include "Pathfinding2.h"
+
+extern "C" bool PrefetchFMapTile(int mapId, float x, float y);
+
+// --- PREFETCH CONFIGURATION ---
+const float PREFETCH_ROUTE_DISTANCE = 1600.0f;  // How far ahead along the route to read (3 tiles)
+const float PREFETCH_SAMPLE_STEP = 100.0f;      // Spacing of the look-ahead samples
+const float PREFETCH_HEADING_SECONDS = 30.0f;   // Dead-reckoning horizon along the current heading
+const float PREFETCH_MIN_SPEED = 1.0f;          // Below this (yd/s) we don't extrapolate the heading
+const float PREFETCH_REPLAN_DISTANCE = 100.0f;  // Re-sample after moving this far on the same route
+const size_t PREFETCH_MAX_PENDING = 64;         // Bounded request queue
+const char* const PREFETCH_MMAP_DIR = "C:/SMM/data/mmaps/";
+
+// --- TILE PREFETCHER ---
+// Reads FMap tiles and NavMesh tile files on a background I/O thread before the bot
+// reaches them, so crossing a tile border does not stall the tick on disk.
+// Update() runs on the main loop: it samples the active route (and the current heading
+// at the measured speed), and queues the tiles under those samples nearest-first.
+// When the route changes, everything still queued for the old one is dropped.
+//   FMap:    the tile is loaded straight into FMapSystem (thread-safe cache).
+//   NavMesh: the file is staged in NavMesh::stagedTiles; LoadMap/AddTile on the tick
+//            then link it into the mesh without touching disk. Maps with a .mmpack
+//            are skipped: their tiles are mapped and paged in by the OS.
+class TilePrefetcher {
+private:
+    struct Request {
+        uint64_t generation;
+        int mapId;
+        bool navMesh;   // false = FMap tile
+        int tx, ty;
+        Vector3 pos;
+    };
+
+    std::thread worker;
+    std::mutex queueMutex;
+    std::condition_variable queueCv;
+    std::deque<Request> pending;
+    std::atomic<bool> running{ false };
+    std::atomic<uint64_t> generation{ 0 };
+
+    // Main-thread state
+    size_t routeSignature = 0;
+    Vector3 lastPlanPos;
+    bool hasPlan = false;
+    std::set<std::tuple<int, int, int>> requested; // (navMesh, tx, ty) for the current route
+
+    Vector3 lastSamplePos;
+    std::chrono::steady_clock::time_point lastSampleTime;
+    bool hasSample = false;
+    float speed = 0.0f; // Smoothed yd/s
+
+    static size_t RouteSignature(int mapId, const std::vector<PathNode>& path) {
+        size_t h = std::hash<int>()(mapId) ^ (std::hash<size_t>()(path.size()) << 1);
+        if (!path.empty()) {
+            const Vector3& a = path.front().pos;
+            const Vector3& b = path.back().pos;
+            for (float f : { a.x, a.y, a.z, b.x, b.y, b.z }) {
+                h = h * 31 + std::hash<float>()(f);
+            }
+        }
+        return h;
+    }
+
+    void UpdateSpeed(const Vector3& playerPos) {
+        auto now = std::chrono::steady_clock::now();
+        if (!hasSample) {
+            lastSamplePos = playerPos;
+            lastSampleTime = now;
+            hasSample = true;
+            return;
+        }
+
+        float dt = std::chrono::duration<float>(now - lastSampleTime).count();
+        if (dt < 0.25f) return;
+
+        float measured = playerPos.Dist3D(lastSamplePos) / dt;
+        speed = (speed * 0.7f) + (measured * 0.3f);
+        lastSamplePos = playerPos;
+        lastSampleTime = now;
+    }
+
+    // Points every PREFETCH_SAMPLE_STEP along the remaining route, then along the heading
+    std::vector<Vector3> SampleAhead(const std::vector<PathNode>& path, int activeIndex,
+        const Vector3& playerPos, float facing) const {
+        std::vector<Vector3> points;
+        points.push_back(playerPos);
+
+        float travelled = 0.0f;
+        Vector3 prev = playerPos;
+        for (size_t i = (size_t)(std::max)(activeIndex, 0); i < path.size() && travelled < PREFETCH_ROUTE_DISTANCE; ++i) {
+            Vector3 next = path[i].pos;
+            float segLen = prev.Dist3D(next);
+            for (float d = PREFETCH_SAMPLE_STEP; d < segLen && travelled + d < PREFETCH_ROUTE_DISTANCE; d += PREFETCH_SAMPLE_STEP) {
+                points.push_back(prev + (next - prev) * (d / segLen));
+            }
+            points.push_back(next);
+            travelled += segLen;
+            prev = next;
+        }
+
+        if (speed > PREFETCH_MIN_SPEED) {
+            Vector3 dir(std::cos(facing), std::sin(facing), 0.0f);
+            float range = (std::min)(speed * PREFETCH_HEADING_SECONDS, PREFETCH_ROUTE_DISTANCE);
+            for (float d = PREFETCH_SAMPLE_STEP; d <= range; d += PREFETCH_SAMPLE_STEP) {
+                points.push_back(playerPos + dir * d);
+            }
+        }
+
+        // Nearest first, so a full queue drops the most speculative reads
+        std::stable_sort(points.begin(), points.end(), [&](const Vector3& a, const Vector3& b) {
+            return a.Dist2D(playerPos) < b.Dist2D(playerPos);
+        });
+        return points;
+    }
+
+    void Enqueue(int mapId, const std::vector<Vector3>& points) {
+        uint64_t gen = generation;
+        std::lock_guard<std::mutex> lock(queueMutex);
+
+        auto push = [&](bool navMesh, int tx, int ty, const Vector3& pos) {
+            if (pending.size() >= PREFETCH_MAX_PENDING) return false;
+            if (!requested.insert({ navMesh ? 1 : 0, tx, ty }).second) return true;
+            pending.push_back(Request{ gen, mapId, navMesh, tx, ty, pos });
+            return true;
+        };
+
+        for (const Vector3& pt : points) {
+            // FMap tile under the point (tx from WoW Y, ty from WoW X)
+            int ftx = (int)(32 - (pt.y / 533.33333f));
+            int fty = (int)(32 - (pt.x / 533.33333f));
+            if (!push(false, ftx, fty, pt)) break;
+
+            // NavMesh tiles: same 3x3 neighbourhood LoadMap asks for
+            int tx, ty;
+            globalNavMesh.GetTileCoords(pt, tx, ty);
+            bool full = false;
+            for (int dx = -1; dx <= 1 && !full; ++dx) {
+                for (int dy = -1; dy <= 1 && !full; ++dy) {
+                    full = !push(true, tx + dx, ty + dy, pt);
+                }
+            }
+            if (full) break;
+        }
+        queueCv.notify_one();
+    }
+
+    void WorkerLoop() {
+        while (running) {
+            Request req;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueCv.wait(lock, [&]() { return !running || !pending.empty(); });
+                if (!running) break;
+                req = pending.front();
+                pending.pop_front();
+            }
+
+            if (req.generation != generation) continue; // Route changed since it was queued
+
+            try {
+                if (!req.navMesh) {
+                    PrefetchFMapTile(req.mapId, req.pos.x, req.pos.y);
+                }
+                else {
+                    auto index = globalNavMesh.tileIndex.Get(PREFETCH_MMAP_DIR, req.mapId);
+                    if (index) {
+                        MmapTileIndex::ForEachLayer(*index, req.tx, req.ty, [&](const std::tuple<int, int, int>&, const MmapTileLocation& location) {
+                            // Packed tiles are mapped, not read; the OS pages them in
+                            if (req.generation == generation && !MmapPackFile::IsPack(location.file)) globalNavMesh.StageTileFile(location.file);
+                        });
+                    }
+                }
+            }
+            catch (const std::exception& e) {
+                if (DEBUG_PATHFINDING) PathLog() << "[Prefetch] " << e.what() << std::endl;
+            }
+        }
+    }
+
+public:
+    TilePrefetcher() {}
+    ~TilePrefetcher() { Stop(); }
+
+    // Main loop, once per tick
+    void Update(int mapId, const std::vector<PathNode>& path, int activeIndex, const Vector3& playerPos, float facing) {
+        UpdateSpeed(playerPos);
+
+        size_t signature = RouteSignature(mapId, path);
+        bool routeChanged = !hasPlan || signature != routeSignature;
+        if (!routeChanged && playerPos.Dist3D(lastPlanPos) < PREFETCH_REPLAN_DISTANCE) return;
+
+        if (!running) {
+            running = true;
+            worker = std::thread(&TilePrefetcher::WorkerLoop, this);
+        }
+
+        if (routeChanged) {
+            routeSignature = signature;
+            Cancel();
+        }
+        hasPlan = true;
+        lastPlanPos = playerPos;
+
+        Enqueue(mapId, SampleAhead(path, activeIndex, playerPos, facing));
+    }
+
+    // Drops every queued read (the one in flight finishes)
+    void Cancel() {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        generation++;
+        pending.clear();
+        requested.clear();
+    }
+
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            running = false;
+            pending.clear();
+        }
+        queueCv.notify_all();
+        if (worker.joinable()) worker.join();
+    }
+};
+
+inline TilePrefetcher g_TilePrefetcher;
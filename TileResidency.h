@@ -0,0 +1,325 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+
+// --- TILE CACHE CONFIGURATION ---
+const size_t TILE_CACHE_DEFAULT_BUDGET = 768ull * 1024 * 1024; // Bytes across FMap + VMap + NavMesh
+const float TILE_CACHE_GRID_SIZE = 533.33333f;                 // ADT tile size, shared by all three
+const int TILE_CACHE_PIN_RADIUS = 1;                           // Tiles around each route point kept resident
+
+enum TileCacheKind {
+    TILE_CACHE_FMAP = 0,
+    TILE_CACHE_VMAP = 1,
+    TILE_CACHE_NAVMESH = 2,
+    TILE_CACHE_KINDS = 3
+};
+
+// Who a pin set belongs to. Each owner replaces only its own pins.
+enum TilePinOwner {
+    TILE_PIN_ROUTE = 0,    // Player and active route, set by the main loop
+    TILE_PIN_REQUEST = 1,  // Load points of the last path request that loaded NavMesh tiles
+    TILE_PIN_OWNERS = 2
+};
+
+// Kind masks for Trim()
+const unsigned TILE_CACHE_MASK_FMAP = 1u << TILE_CACHE_FMAP;
+const unsigned TILE_CACHE_MASK_VMAP = 1u << TILE_CACHE_VMAP;
+const unsigned TILE_CACHE_MASK_NAVMESH = 1u << TILE_CACHE_NAVMESH;
+const unsigned TILE_CACHE_MASK_ALL = TILE_CACHE_MASK_FMAP | TILE_CACHE_MASK_VMAP | TILE_CACHE_MASK_NAVMESH;
+
+inline const char* TileCacheKindName(int kind) {
+    switch (kind) {
+    case TILE_CACHE_FMAP: return "fmap";
+    case TILE_CACHE_VMAP: return "vmap";
+    case TILE_CACHE_NAVMESH: return "navmesh";
+    default: return "unknown";
+    }
+}
+
+struct TileCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t bytes = 0;
+    size_t tiles = 0;
+};
+
+// One resident tile. The owning cache keeps the handle next to its tile and calls
+// Touch() on every hit; that is lock-free so hot lookups never serialize here.
+struct TileResidency {
+    TileCacheKind kind;
+    uint64_t key;          // The owning cache's own tile key
+    int mapId;
+    int gridX, gridY;      // floor(worldX / tile size), floor(worldY / tile size)
+    size_t bytes;
+    std::atomic<uint64_t> lastUse{ 0 };
+};
+typedef std::shared_ptr<TileResidency> TileResidencyPtr;
+
+// --- TILE RESIDENCY MANAGER ---
+// Keeps the FMap, VMap and NavMesh tile caches under one byte budget. Each cache
+// registers its tiles with Add()/Remove() and an evictor that drops one tile by key.
+// Trim() then evicts least-recently-used tiles until the total fits the budget,
+// skipping tiles pinned around the active route and the last path request (PinRoute).
+// Evictors run without the manager lock held, so they may take their own cache's
+// locks, but a cache must not call Trim() while holding those locks itself.
+// Trim() only touches the kinds in its mask: the NavMesh is not thread-safe, so only
+// the main loop trims it.
+// Caches of results derived from tiles (FlightPointCache) register a listener that is
+// told, without the manager lock held, whenever a tile stops being resident.
+class TileResidencyManager {
+public:
+    typedef std::function<bool(uint64_t key)> Evictor; // False if the tile can't go right now
+    typedef std::function<void(const TileResidency& entry)> RemovalListener;
+
+private:
+    std::mutex mutex;
+    std::unordered_map<uint64_t, TileResidencyPtr> resident[TILE_CACHE_KINDS];
+    Evictor evictors[TILE_CACHE_KINDS];
+    std::vector<RemovalListener> listeners;
+    size_t bytesUsed[TILE_CACHE_KINDS] = {};
+    size_t totalBytes = 0;
+
+    struct PinSet {
+        int mapId = -1;
+        std::set<std::pair<int, int>> cells;
+    };
+    PinSet pins[TILE_PIN_OWNERS];
+
+    std::atomic<size_t> budget{ TILE_CACHE_DEFAULT_BUDGET };
+    std::atomic<uint64_t> clock{ 0 };
+    std::atomic<uint64_t> hits[TILE_CACHE_KINDS] = {};
+    std::atomic<uint64_t> misses[TILE_CACHE_KINDS] = {};
+    std::atomic<uint64_t> evictions[TILE_CACHE_KINDS] = {};
+
+    static int GridCoord(float world) {
+        return (int)std::floor(world / TILE_CACHE_GRID_SIZE);
+    }
+
+    bool IsPinnedLocked(const TileResidency& entry) const {
+        for (const PinSet& pin : pins) {
+            if (entry.mapId == pin.mapId && pin.cells.count({ entry.gridX, entry.gridY }) != 0) return true;
+        }
+        return false;
+    }
+
+    void Unlink(const TileResidencyPtr& entry) {
+        bytesUsed[entry->kind] -= entry->bytes;
+        totalBytes -= entry->bytes;
+    }
+
+    // Call with the lock released
+    void NotifyRemoved(const std::vector<RemovalListener>& targets, const std::vector<TileResidencyPtr>& removed) {
+        for (const RemovalListener& listener : targets) {
+            for (const TileResidencyPtr& entry : removed) listener(*entry);
+        }
+    }
+
+public:
+    void SetBudget(size_t bytes) { budget = bytes; }
+    size_t GetBudget() const { return budget; }
+
+    void SetEvictor(TileCacheKind kind, Evictor evictor) {
+        std::lock_guard<std::mutex> lock(mutex);
+        evictors[kind] = std::move(evictor);
+    }
+
+    void AddRemovalListener(RemovalListener listener) {
+        std::lock_guard<std::mutex> lock(mutex);
+        listeners.push_back(std::move(listener));
+    }
+
+    // A lookup that had to go to disk (whether or not the tile exists)
+    void RecordMiss(TileCacheKind kind) { misses[kind]++; }
+
+    // Registers a freshly loaded tile. worldX/worldY is any point inside it.
+    TileResidencyPtr Add(TileCacheKind kind, uint64_t key, int mapId, float worldX, float worldY, size_t bytes) {
+        TileResidencyPtr entry = std::make_shared<TileResidency>();
+        entry->kind = kind;
+        entry->key = key;
+        entry->mapId = mapId;
+        entry->gridX = GridCoord(worldX);
+        entry->gridY = GridCoord(worldY);
+        entry->bytes = bytes;
+        entry->lastUse = ++clock;
+
+        std::vector<TileResidencyPtr> replaced;
+        std::vector<RemovalListener> targets;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            TileResidencyPtr& slot = resident[kind][key];
+            if (slot) {
+                Unlink(slot);
+                replaced.push_back(slot);
+                targets = listeners;
+            }
+            slot = entry;
+            bytesUsed[kind] += bytes;
+            totalBytes += bytes;
+        }
+        NotifyRemoved(targets, replaced);
+        return entry;
+    }
+
+    void Touch(const TileResidencyPtr& entry) {
+        if (!entry) return;
+        entry->lastUse = ++clock;
+        hits[entry->kind]++;
+    }
+
+    // Something derived from a resident tile was built and now lives as long as it does
+    void AddBytes(const TileResidencyPtr& entry, size_t extra) {
+        if (!entry) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        entry->bytes += extra;
+
+        auto it = resident[entry->kind].find(entry->key);
+        if (it != resident[entry->kind].end() && it->second == entry) {
+            bytesUsed[entry->kind] += extra;
+            totalBytes += extra;
+        }
+    }
+
+    // The owning cache dropped the tile on its own (map change, Clear())
+    void Remove(TileCacheKind kind, uint64_t key) {
+        std::vector<TileResidencyPtr> removed;
+        std::vector<RemovalListener> targets;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = resident[kind].find(key);
+            if (it == resident[kind].end()) return;
+            Unlink(it->second);
+            removed.push_back(it->second);
+            resident[kind].erase(it);
+            targets = listeners;
+        }
+        NotifyRemoved(targets, removed);
+    }
+
+    void RemoveAll(TileCacheKind kind) {
+        std::vector<TileResidencyPtr> removed;
+        std::vector<RemovalListener> targets;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            totalBytes -= bytesUsed[kind];
+            bytesUsed[kind] = 0;
+            for (const auto& pair : resident[kind]) removed.push_back(pair.second);
+            resident[kind].clear();
+            targets = listeners;
+        }
+        NotifyRemoved(targets, removed);
+    }
+
+    // Pins every tile within TILE_CACHE_PIN_RADIUS of the given points (anything with
+    // .x/.y in world coordinates) on mapId. Replaces owner's previous pin set; the
+    // other owners' pins stay, so a side request never unpins the route.
+    template <typename Points>
+    void PinRoute(TilePinOwner owner, int mapId, const Points& points) {
+        std::set<std::pair<int, int>> cells;
+        for (const auto& pt : points) {
+            int gx = GridCoord(pt.x), gy = GridCoord(pt.y);
+            for (int dx = -TILE_CACHE_PIN_RADIUS; dx <= TILE_CACHE_PIN_RADIUS; ++dx) {
+                for (int dy = -TILE_CACHE_PIN_RADIUS; dy <= TILE_CACHE_PIN_RADIUS; ++dy) {
+                    cells.insert({ gx + dx, gy + dy });
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        pins[owner].mapId = mapId;
+        pins[owner].cells.swap(cells);
+    }
+
+    bool IsPinned(const TileResidencyPtr& entry) {
+        if (!entry) return false;
+        std::lock_guard<std::mutex> lock(mutex);
+        return IsPinnedLocked(*entry);
+    }
+
+    // Evicts least-recently-used, unpinned tiles of the kinds in kindMask until the
+    // total is back under budget. keep (the tile a loader just added) is never picked,
+    // so a budget smaller than one tile can't throw away what the caller is about to use.
+    // If the other kinds alone are over budget, nothing is evicted: emptying the masked
+    // caches couldn't fix that and would only make them reload. A trim over all kinds
+    // (the main loop's) sorts it out by LRU across the caches.
+    // A tile whose evictor refuses (still loading or in use) is skipped for the rest of
+    // the call and the next one is tried. Returns the number of bytes released.
+    size_t Trim(unsigned kindMask = TILE_CACHE_MASK_ALL, const TileResidencyPtr& keep = nullptr) {
+        size_t released = 0;
+        std::set<const TileResidency*> refused;
+
+        while (true) {
+            TileResidencyPtr victim;
+            Evictor evictor;
+            std::vector<RemovalListener> targets;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                size_t evictable = 0;
+                for (int kind = 0; kind < TILE_CACHE_KINDS; ++kind) {
+                    if ((kindMask & (1u << kind)) && evictors[kind]) evictable += bytesUsed[kind];
+                }
+                if (totalBytes <= budget || totalBytes - evictable > budget) break;
+
+                for (int kind = 0; kind < TILE_CACHE_KINDS; ++kind) {
+                    if (!(kindMask & (1u << kind)) || !evictors[kind]) continue;
+                    for (const auto& pair : resident[kind]) {
+                        const TileResidencyPtr& entry = pair.second;
+                        if (entry == keep || IsPinnedLocked(*entry) || refused.count(entry.get())) continue;
+                        if (!victim || entry->lastUse < victim->lastUse) victim = entry;
+                    }
+                }
+                if (!victim) break; // Everything left is pinned, busy or not ours to evict
+
+                evictor = evictors[victim->kind];
+                targets = listeners;
+                Unlink(victim);
+                resident[victim->kind].erase(victim->key);
+            }
+
+            if (evictor(victim->key)) {
+                evictions[victim->kind]++;
+                released += victim->bytes;
+                NotifyRemoved(targets, { victim });
+            }
+            else {
+                // Still in use; put it back as recently used and move on to the next one
+                refused.insert(victim.get());
+                std::lock_guard<std::mutex> lock(mutex);
+                victim->lastUse = ++clock;
+                TileResidencyPtr& slot = resident[victim->kind][victim->key];
+                if (!slot) {
+                    slot = victim;
+                    bytesUsed[victim->kind] += victim->bytes;
+                    totalBytes += victim->bytes;
+                }
+            }
+        }
+        return released;
+    }
+
+    TileCacheStats GetStats(TileCacheKind kind) {
+        TileCacheStats stats;
+        stats.hits = hits[kind];
+        stats.misses = misses[kind];
+        stats.evictions = evictions[kind];
+
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.bytes = bytesUsed[kind];
+        stats.tiles = resident[kind].size();
+        return stats;
+    }
+
+    size_t GetTotalBytes() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return totalBytes;
+    }
+};
+
+inline TileResidencyManager g_TileResidency;
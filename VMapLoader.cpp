@@ -5,6 +5,7 @@
 #include <cstdio>
 #include <vector>
 #include <map>
+#include <unordered_set>
 #include <string>
 #include <algorithm>
 #include <cmath>
@@ -12,6 +13,11 @@
 #include <fstream>
 #include <iomanip>
 #include <chrono>
+#include <memory>
+#include <mutex>
+#include <random>
+
+#include "TileResidency.h"
 
 // --- CONFIGURATION ---
 const float VMAP_FLIGHT_CLEARANCE = 25.0f;
@@ -21,6 +27,7 @@ const bool DEBUG_VMAP = true;  // Enable/disable VMap logging
 class VMapLogger {
 private:
     std::ofstream g_LogFile;
+    std::mutex logMutex;   // Line checks run on the path planning threads
     bool enabled;
 
 public:
@@ -45,6 +52,7 @@ public:
 
     void Log(const std::string& msg) {
         if (enabled && g_LogFile.is_open()) {
+            std::lock_guard<std::mutex> lock(logMutex);
             g_LogFile << "[VMAP] " << msg << std::endl;
             g_LogFile.flush(); // Ensure immediate write
         }
@@ -52,6 +60,7 @@ public:
 
     void LogCheck(int mapId, float x1, float y1, float z1, float x2, float y2, float z2, bool hit) {
         if (enabled && g_LogFile.is_open()) {
+            std::lock_guard<std::mutex> lock(logMutex);
             g_LogFile << "[CHECK] Map=" << mapId << " | ";
             g_LogFile << std::fixed << std::setprecision(2);
             g_LogFile << "Start=(" << x1 << ", " << y1 << ", " << z1 << ") ";
@@ -64,6 +73,7 @@ public:
 
     void LogTileLoad(const std::string& filename, bool success, int instanceCount = 0) {
         if (enabled && g_LogFile.is_open()) {
+            std::lock_guard<std::mutex> lock(logMutex);
             if (success) {
                 g_LogFile << "[TILE] Loaded: " << filename << " (" << instanceCount << " instances)" << std::endl;
             }
@@ -76,6 +86,7 @@ public:
 
     void LogCollision(int instanceIdx, const std::string& bounds) {
         if (enabled && g_LogFile.is_open()) {
+            std::lock_guard<std::mutex> lock(logMutex);
             g_LogFile << "  ├─ HIT Instance #" << instanceIdx << " " << bounds << std::endl;
             g_LogFile.flush();
         }
@@ -83,6 +94,7 @@ public:
 
     void LogClearance(float midZ, float threshold) {
         if (enabled && g_LogFile.is_open()) {
+            std::lock_guard<std::mutex> lock(logMutex);
             g_LogFile << "  ├─ High altitude flight detected (Z=" << midZ
                 << " > threshold=" << threshold << ") - SKIPPING VMap check" << std::endl;
             g_LogFile.flush();
@@ -107,6 +119,8 @@ struct Vector3 {
     Vector3 operator/(float s) const { return Vector3(x / s, y / s, z / s); }
 
     float length() const { return std::sqrt(x * x + y * y + z * z); }
+    float dot(const Vector3& v) const { return x * v.x + y * v.y + z * v.z; }
+    Vector3 cross(const Vector3& v) const { return Vector3(y * v.z - z * v.y, z * v.x - x * v.z, x * v.y - y * v.x); }
 
     bool isZero() const { return (x == 0 && y == 0 && z == 0); }
 
@@ -182,8 +196,475 @@ bool RayAABBIntersection(const Ray& r, const AABox& box, float maxDist, int inst
     return hit;
 }
 
+// Row-major 3x3 matrix, only what model placement needs
+struct Matrix3 {
+    float m[3][3];
+
+    Vector3 operator*(const Vector3& v) const {
+        return Vector3(m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+            m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+            m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z);
+    }
+
+    Matrix3 operator*(const Matrix3& o) const {
+        Matrix3 r;
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+                r.m[i][j] = m[i][0] * o.m[0][j] + m[i][1] * o.m[1][j] + m[i][2] * o.m[2][j];
+        return r;
+    }
+
+    // Same as G3D::Matrix3::fromEulerAnglesXYZ: Rx(x) * Ry(y) * Rz(z), radians
+    static Matrix3 fromEulerAnglesXYZ(float x, float y, float z) {
+        float cx = std::cos(x), sx = std::sin(x);
+        float cy = std::cos(y), sy = std::sin(y);
+        float cz = std::cos(z), sz = std::sin(z);
+        Matrix3 rx = { { { 1, 0, 0 }, { 0, cx, -sx }, { 0, sx, cx } } };
+        Matrix3 ry = { { { cy, 0, sy }, { 0, 1, 0 }, { -sy, 0, cy } } };
+        Matrix3 rz = { { { cz, -sz, 0 }, { sz, cz, 0 }, { 0, 0, 1 } } };
+        return rx * (ry * rz);
+    }
+};
+
+// Two-sided Moller-Trumbore: does the ray hit the triangle within maxDist?
+inline bool RayTriangleIntersection(const Ray& r, const Vector3& v0, const Vector3& v1, const Vector3& v2, float maxDist) {
+    const float EPS = 1e-7f;
+    Vector3 e1 = v1 - v0;
+    Vector3 e2 = v2 - v0;
+    Vector3 p = r.direction.cross(e2);
+    float det = e1.dot(p);
+    if (std::abs(det) < EPS) return false;
+
+    float invDet = 1.0f / det;
+    Vector3 s = r.origin - v0;
+    float u = s.dot(p) * invDet;
+    if (u < 0.0f || u > 1.0f) return false;
+
+    Vector3 q = s.cross(e1);
+    float v = r.direction.dot(q) * invDet;
+    if (v < 0.0f || u + v > 1.0f) return false;
+
+    float t = e2.dot(q) * invDet;
+    return t >= 0.0f && t <= maxDist;
+}
+
+// Same slab test as RayAABBIntersection with the inverse direction computed once per
+// ray. A box that contains another is hit whenever the inner one is, so BVH culling
+// never drops an instance the linear scan would have reported.
+inline bool RayHitsBox(const Vector3& origin, const Vector3& invDir, const AABox& box, float maxDist) {
+    float t1 = (box.lo.x - origin.x) * invDir.x;
+    float t2 = (box.hi.x - origin.x) * invDir.x;
+    float t3 = (box.lo.y - origin.y) * invDir.y;
+    float t4 = (box.hi.y - origin.y) * invDir.y;
+    float t5 = (box.lo.z - origin.z) * invDir.z;
+    float t6 = (box.hi.z - origin.z) * invDir.z;
+
+    float tmin = std::max(std::max(std::min(t1, t2), std::min(t3, t4)), std::min(t5, t6));
+    float tmax = std::min(std::min(std::max(t1, t2), std::max(t3, t4)), std::max(t5, t6));
+
+    return !(tmax < 0 || tmin > tmax || tmin > maxDist);
+}
+
+// ---------------------------------------------------------
+// 2. BOX BVH
+// ---------------------------------------------------------
+
+// Bounding volume hierarchy over a set of boxes (the instance bounds of a tile, or the
+// triangle bounds of a model), built once with a binned SAH split. Nodes are stored
+// depth-first in one array: an inner node's left child follows it directly and
+// 'offset' is its right child; a leaf covers order[offset .. offset + count), with
+// the boxes copied alongside.
+class BoxBVH {
+public:
+    struct Node {
+        AABox bound;
+        uint32_t offset;
+        uint16_t count;     // 0 = inner node
+        uint16_t axis;      // Split axis of an inner node
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> order;    // Instance indices, grouped by leaf
+    std::vector<AABox> boxes;       // bounds[order[i]]
+
+    static const int MAX_LEAF_SIZE = 4;
+    static const int BIN_COUNT = 12;
+    static const int MAX_DEPTH = 64;
+
+    void build(const std::vector<AABox>& bounds) {
+        nodes.clear();
+        order.resize(bounds.size());
+        for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+        if (bounds.empty()) return;
+
+        std::vector<Vector3> centers(bounds.size());
+        for (size_t i = 0; i < bounds.size(); ++i) centers[i] = bounds[i].center();
+
+        nodes.reserve(bounds.size() * 2 / MAX_LEAF_SIZE + 1);
+        buildNode(bounds, centers, 0, (uint32_t)bounds.size(), 0);
+
+        boxes.resize(order.size());
+        for (size_t i = 0; i < order.size(); ++i) boxes[i] = bounds[order[i]];
+    }
+
+    // Visits the boxes the ray hits within maxDist, nearest subtree first, skipping
+    // anything with its top below minTopZ. Stops at the first box accept(index) returns
+    // true for and returns that index; -1 if there is none.
+    template <typename Accept>
+    int intersect(const Ray& ray, float maxDist, float minTopZ, Accept&& accept) const {
+        if (nodes.empty()) return -1;
+
+        Vector3 invDir = ray.invDirection();
+        bool negative[3] = { ray.direction.x < 0, ray.direction.y < 0, ray.direction.z < 0 };
+
+        uint32_t stack[MAX_DEPTH];
+        int top = 0;
+        stack[top++] = 0;
+
+        while (top > 0) {
+            const Node& node = nodes[stack[--top]];
+            if (node.bound.hi.z < minTopZ) continue;
+            if (!RayHitsBox(ray.origin, invDir, node.bound, maxDist)) continue;
+
+            if (node.count > 0) {
+                for (uint32_t i = node.offset; i < node.offset + node.count; ++i) {
+                    if (boxes[i].hi.z < minTopZ) continue;
+                    if (RayHitsBox(ray.origin, invDir, boxes[i], maxDist) && accept(order[i])) return (int)order[i];
+                }
+                continue;
+            }
+
+            // Push the far child first so the near one is popped next
+            uint32_t left = (uint32_t)(&node - &nodes[0]) + 1;
+            uint32_t right = node.offset;
+            if (negative[node.axis]) {
+                stack[top++] = left;
+                stack[top++] = right;
+            }
+            else {
+                stack[top++] = right;
+                stack[top++] = left;
+            }
+        }
+        return -1;
+    }
+
+    size_t memoryBytes() const {
+        return nodes.capacity() * sizeof(Node) + order.capacity() * sizeof(uint32_t) + boxes.capacity() * sizeof(AABox);
+    }
+
+private:
+    static float axisOf(const Vector3& v, int axis) {
+        return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+    }
+
+    static void grow(AABox& box, const AABox& other) {
+        box.lo = Vector3(std::min(box.lo.x, other.lo.x), std::min(box.lo.y, other.lo.y), std::min(box.lo.z, other.lo.z));
+        box.hi = Vector3(std::max(box.hi.x, other.hi.x), std::max(box.hi.y, other.hi.y), std::max(box.hi.z, other.hi.z));
+    }
+
+    static float halfArea(const AABox& box) {
+        Vector3 s = box.size();
+        return s.x * s.y + s.y * s.z + s.z * s.x;
+    }
+
+    uint32_t buildNode(const std::vector<AABox>& bounds, const std::vector<Vector3>& centers,
+        uint32_t begin, uint32_t end, int depth) {
+        uint32_t index = (uint32_t)nodes.size();
+        nodes.emplace_back();
+
+        AABox box = bounds[order[begin]];
+        AABox centerBox(centers[order[begin]], centers[order[begin]]);
+        for (uint32_t i = begin + 1; i < end; ++i) {
+            grow(box, bounds[order[i]]);
+            grow(centerBox, AABox(centers[order[i]], centers[order[i]]));
+        }
+        nodes[index].bound = box;
+
+        uint32_t count = end - begin;
+        Vector3 extent = centerBox.size();
+        int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+        float axisLo = axisOf(centerBox.lo, axis);
+        float axisExtent = axisOf(extent, axis);
+
+        // Small enough, or out of stack depth for the traversal
+        if ((count <= MAX_LEAF_SIZE || depth >= MAX_DEPTH - 2) && count <= 0xFFFF) {
+            makeLeaf(index, begin, count);
+            return index;
+        }
+
+        uint32_t mid = begin;
+        if (axisExtent > 0.0f) {
+            // Binned SAH: cost of every split between bins, in units of the parent area
+            struct Bin { AABox bound; uint32_t count = 0; };
+            Bin bins[BIN_COUNT];
+            float scale = BIN_COUNT / axisExtent;
+            auto binOf = [&](uint32_t inst) {
+                return std::min(BIN_COUNT - 1, (int)((axisOf(centers[inst], axis) - axisLo) * scale));
+            };
+
+            for (uint32_t i = begin; i < end; ++i) {
+                Bin& bin = bins[binOf(order[i])];
+                if (bin.count++ == 0) bin.bound = bounds[order[i]];
+                else grow(bin.bound, bounds[order[i]]);
+            }
+
+            float rightArea[BIN_COUNT];
+            uint32_t rightCount[BIN_COUNT];
+            AABox acc;
+            uint32_t n = 0;
+            for (int b = BIN_COUNT - 1; b > 0; --b) {
+                if (bins[b].count) {
+                    if (n == 0) acc = bins[b].bound;
+                    else grow(acc, bins[b].bound);
+                    n += bins[b].count;
+                }
+                rightArea[b] = n ? halfArea(acc) : 0.0f;
+                rightCount[b] = n;
+            }
+
+            float bestCost = std::numeric_limits<float>::max();
+            int bestSplit = -1;
+            n = 0;
+            for (int b = 0; b < BIN_COUNT - 1; ++b) {
+                if (bins[b].count) {
+                    if (n == 0) acc = bins[b].bound;
+                    else grow(acc, bins[b].bound);
+                    n += bins[b].count;
+                }
+                if (n == 0 || rightCount[b + 1] == 0) continue;
+                float cost = n * halfArea(acc) + rightCount[b + 1] * rightArea[b + 1];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestSplit = b;
+                }
+            }
+
+            // Leaf if no split beats testing everything here
+            if (bestSplit >= 0 && count <= MAX_LEAF_SIZE * 4 && bestCost >= count * halfArea(box)) {
+                makeLeaf(index, begin, count);
+                return index;
+            }
+
+            if (bestSplit >= 0) {
+                mid = (uint32_t)(std::partition(order.begin() + begin, order.begin() + end,
+                    [&](uint32_t inst) { return binOf(inst) <= bestSplit; }) - order.begin());
+            }
+        }
+
+        // Identical centers: halve by index
+        if (mid == begin || mid == end) mid = begin + count / 2;
+
+        buildNode(bounds, centers, begin, mid, depth + 1);
+        uint32_t right = buildNode(bounds, centers, mid, end, depth + 1);
+        nodes[index].offset = right;
+        nodes[index].count = 0;
+        nodes[index].axis = (uint16_t)axis;
+        return index;
+    }
+
+    void makeLeaf(uint32_t index, uint32_t begin, uint32_t count) {
+        nodes[index].offset = begin;
+        nodes[index].count = (uint16_t)count;
+        nodes[index].axis = 0;
+    }
+};
+
+// ---------------------------------------------------------
+// 3. MODEL GEOMETRY (EXACT MODE)
+// ---------------------------------------------------------
+// Exact checks test the triangles of the models that pass the instance BVH instead of
+// their boxes. Geometry comes from the vmap4_extractor output (Buildings/): dir_bin
+// names the model and gives the placement of every spawn, and each model's raw file
+// holds its collision triangles, group by group.
+
+namespace VMParser {
+    // Collision triangles of one model (all groups), in model space
+    class CollisionModel {
+    public:
+        std::vector<Vector3> vertices;
+        std::vector<uint32_t> indices;  // 3 per triangle
+        BoxBVH bvh;                     // Over the triangle bounds
+
+        size_t memoryBytes() const {
+            return sizeof(CollisionModel) + vertices.capacity() * sizeof(Vector3) +
+                indices.capacity() * sizeof(uint32_t) + bvh.memoryBytes();
+        }
+
+        // Raw model as written by Model::ConvertToVMAPModel / WMOGroup::ConvertToVMAPGroupWmo
+        bool readRawFile(const std::string& fname) {
+            FILE* rf = fopen(fname.c_str(), "rb");
+            if (!rf) return false;
+
+            char magic[8];
+            uint32_t header[3]; // nVectors, nGroups, rootWMOID
+            if (fread(magic, 1, 8, rf) != 8 || strncmp(magic, "VMAP", 4) != 0 ||
+                fread(header, sizeof(uint32_t), 3, rf) != 3) {
+                fclose(rf);
+                return false;
+            }
+
+            bool ok = true;
+            for (uint32_t g = 0; g < header[1] && ok; ++g) {
+                // mogpFlags, groupWMOID, bound lo/hi, liquidFlags
+                uint32_t groupHeader[9];
+                char tag[4];
+                uint32_t size = 0, nIndexes = 0, nVertices = 0;
+                ok = fread(groupHeader, 4, 9, rf) == 9 &&
+                    fread(tag, 1, 4, rf) == 4 && strncmp(tag, "GRP ", 4) == 0 &&
+                    fread(&size, 4, 1, rf) == 1 && fseek(rf, size, SEEK_CUR) == 0 &&
+                    fread(tag, 1, 4, rf) == 4 && strncmp(tag, "INDX", 4) == 0 &&
+                    fread(&size, 4, 1, rf) == 1 && fread(&nIndexes, 4, 1, rf) == 1;
+                if (!ok) break;
+
+                std::vector<uint16_t> groupIndices(nIndexes);
+                ok = (nIndexes == 0 || fread(&groupIndices[0], sizeof(uint16_t), nIndexes, rf) == nIndexes) &&
+                    fread(tag, 1, 4, rf) == 4 && strncmp(tag, "VERT", 4) == 0 &&
+                    fread(&size, 4, 1, rf) == 1 && fread(&nVertices, 4, 1, rf) == 1;
+                if (!ok) break;
+
+                uint32_t base = (uint32_t)vertices.size();
+                vertices.resize(base + nVertices);
+                ok = nVertices == 0 || fread(&vertices[base], sizeof(float) * 3, nVertices, rf) == nVertices;
+
+                for (uint32_t i = 0; ok && i + 2 < nIndexes; i += 3) {
+                    if (groupIndices[i] >= nVertices || groupIndices[i + 1] >= nVertices || groupIndices[i + 2] >= nVertices) continue;
+                    for (int k = 0; k < 3; ++k) indices.push_back(base + groupIndices[i + k]);
+                }
+
+                // Liquid follows only some groups; we don't need it
+                if (ok && fread(tag, 1, 4, rf) == 4) {
+                    if (strncmp(tag, "LIQU", 4) == 0) ok = fread(&size, 4, 1, rf) == 1 && fseek(rf, size, SEEK_CUR) == 0;
+                    else fseek(rf, -4, SEEK_CUR);
+                }
+            }
+            fclose(rf);
+            if (!ok) return false;
+
+            std::vector<AABox> bounds(indices.size() / 3);
+            for (size_t t = 0; t < bounds.size(); ++t) {
+                const Vector3& a = vertices[indices[t * 3]];
+                const Vector3& b = vertices[indices[t * 3 + 1]];
+                const Vector3& c = vertices[indices[t * 3 + 2]];
+                bounds[t] = AABox(Vector3(std::min(a.x, std::min(b.x, c.x)), std::min(a.y, std::min(b.y, c.y)), std::min(a.z, std::min(b.z, c.z))),
+                    Vector3(std::max(a.x, std::max(b.x, c.x)), std::max(a.y, std::max(b.y, c.y)), std::max(a.z, std::max(b.z, c.z))));
+            }
+            bvh.build(bounds);
+            return true;
+        }
+
+        // Does the (model space) ray hit any triangle within maxDist?
+        bool intersectRay(const Ray& ray, float maxDist) const {
+            return bvh.intersect(ray, maxDist, -std::numeric_limits<float>::max(), [&](uint32_t tri) {
+                return RayTriangleIntersection(ray, vertices[indices[tri * 3]], vertices[indices[tri * 3 + 1]],
+                    vertices[indices[tri * 3 + 2]], maxDist);
+            }) >= 0;
+        }
+    };
+
+    // One spawn from dir_bin (extractor coordinates)
+    struct ModelSpawn {
+        std::string name;
+        Vector3 pos;
+        Vector3 rot;    // Degrees
+        float scale;
+    };
+
+    // Reads the dir_bin records of one map (see ModelInstance/WMOInstance in the
+    // extractor), keyed by spawn ID
+    inline bool ReadSpawnIndex(const std::string& fname, int mapId, std::map<uint32_t, ModelSpawn>& spawns) {
+        FILE* rf = fopen(fname.c_str(), "rb");
+        if (!rf) return false;
+
+        const uint32_t MOD_HAS_BOUND = 1 << 2;
+        while (true) {
+            uint32_t mapTileFlags[4]; // mapID, tileX, tileY, flags
+            uint16_t adtId;
+            uint32_t id, nameLen;
+            float placement[7];       // pos, rot, scale
+            float bound[6];
+            char name[512];
+
+            if (fread(mapTileFlags, 4, 4, rf) != 4) break;
+            if (fread(&adtId, 2, 1, rf) != 1 || fread(&id, 4, 1, rf) != 1 || fread(placement, 4, 7, rf) != 7) break;
+            if ((mapTileFlags[3] & MOD_HAS_BOUND) && fread(bound, 4, 6, rf) != 6) break;
+            if (fread(&nameLen, 4, 1, rf) != 1 || nameLen >= sizeof(name) || fread(name, 1, nameLen, rf) != nameLen) break;
+
+            if ((int)mapTileFlags[0] != mapId) continue;
+            ModelSpawn& spawn = spawns[id];
+            spawn.name.assign(name, nameLen);
+            spawn.pos = Vector3(placement[0], placement[1], placement[2]);
+            spawn.rot = Vector3(placement[3], placement[4], placement[5]);
+            spawn.scale = placement[6];
+        }
+        fclose(rf);
+        return true;
+    }
+
+    // Models are shared by every tile that places them and freed with the last one
+    class ModelCache {
+        std::mutex mutex;
+        std::string basePath;
+        std::map<std::string, std::weak_ptr<CollisionModel>> models;
+        std::map<std::string, bool> missing;
+
+    public:
+        void Init(const std::string& path) { basePath = path; }
+
+        std::shared_ptr<const CollisionModel> Acquire(const std::string& name) {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::shared_ptr<CollisionModel> model = models[name].lock();
+            if (model || missing.count(name)) return model;
+
+            model = std::make_shared<CollisionModel>();
+            bool loaded = model->readRawFile(basePath + name);
+
+            // The extractor stores some .mdx spawns under their .m2 name
+            if (!loaded && name.size() > 4 && name.compare(name.size() - 4, 4, ".mdx") == 0) {
+                model = std::make_shared<CollisionModel>();
+                loaded = model->readRawFile(basePath + name.substr(0, name.size() - 4) + ".m2");
+            }
+
+            if (!loaded) {
+                missing[name] = true;
+                g_Logger.Log("Exact mode: no model geometry for " + name);
+                return nullptr;
+            }
+            models[name] = model;
+            return model;
+        }
+    };
+
+    // Where an instance's model sits in the world. Same transform TerrainBuilder::loadVMap
+    // uses to put models into the navmesh:
+    //   world = mirrorXY(R^T * v * scale + pos - (32 * GRID, 32 * GRID, 0))
+    // with R = fromEulerAnglesXYZ(-rot.z, -rot.x, -rot.y). Rays are taken the other way.
+    struct ModelPlacement {
+        std::shared_ptr<const CollisionModel> model;  // Null: box test only
+        Matrix3 rotation;
+        Vector3 offset;
+        float scale = 1.0f;
+
+        void set(const ModelSpawn& spawn, std::shared_ptr<const CollisionModel> m) {
+            const float degToRad = 3.14159265f / 180.0f;
+            const float mid = 32.0f * 533.33333f;
+            model = std::move(m);
+            rotation = Matrix3::fromEulerAnglesXYZ(-spawn.rot.z * degToRad, -spawn.rot.x * degToRad, -spawn.rot.y * degToRad);
+            offset = Vector3(spawn.pos.x - mid, spawn.pos.y - mid, spawn.pos.z);
+            scale = spawn.scale > 0.0f ? spawn.scale : 1.0f;
+        }
+
+        bool intersectRay(const Ray& ray, float maxDist) const {
+            Vector3 origin(-ray.origin.x, -ray.origin.y, ray.origin.z);
+            Vector3 dir(-ray.direction.x, -ray.direction.y, ray.direction.z);
+            Ray local(rotation * (origin - offset) / scale, rotation * dir);
+            return model->intersectRay(local, maxDist / scale);
+        }
+    };
+}
+
 // ---------------------------------------------------------
-// 2. VMAP DATA PARSER
+// 4. VMAP DATA PARSER
 // ---------------------------------------------------------
 
 namespace VMParser {
@@ -200,8 +681,17 @@ namespace VMParser {
     class WorldModel {
     public:
         std::vector<ModelInstance> instances;
+        BoxBVH bvh;
         std::string filename;
 
+        // Exact mode: each instance's model, attached on the first exact check
+        std::once_flag placementsOnce;
+        std::vector<ModelPlacement> placements;
+
+        size_t memoryBytes() const {
+            return sizeof(WorldModel) + instances.capacity() * sizeof(ModelInstance) + bvh.memoryBytes() + filename.capacity();
+        }
+
         bool readFile(const std::string& fname) {
             filename = fname;
             FILE* rf = fopen(filename.c_str(), "rb");
@@ -295,6 +785,11 @@ namespace VMParser {
             }
 
             fclose(rf);
+
+            std::vector<AABox> bounds(instances.size());
+            for (size_t i = 0; i < instances.size(); ++i) bounds[i] = instances[i].bound;
+            bvh.build(bounds);
+
             g_Logger.LogTileLoad(filename, true, count);
 
             if (DEBUG_VMAP && count > 0) {
@@ -309,12 +804,26 @@ namespace VMParser {
 }
 
 // ---------------------------------------------------------
-// 3. SYSTEM MANAGER
+// 5. SYSTEM MANAGER
 // ---------------------------------------------------------
 
 class VMapSystem {
     std::string basePath;
-    std::map<uint64_t, VMParser::WorldModel*> loadedTiles;
+    std::string modelPath;
+
+    // Exact mode: dir_bin spawns per map, and the models they place
+    VMParser::ModelCache modelCache;
+    std::mutex spawnMutex;
+    std::map<int, std::map<uint32_t, VMParser::ModelSpawn>> spawnIndex;
+
+    // Null model = tile file missing or invalid. Models are shared with running checks,
+    // so an eviction never frees one out from under a caller.
+    struct LoadedTile {
+        std::shared_ptr<VMParser::WorldModel> model;
+        TileResidencyPtr residency;
+    };
+    std::mutex tileMutex;
+    std::map<uint64_t, LoadedTile> loadedTiles;
     int totalChecks = 0;
     int totalHits = 0;
     int totalSkipped = 0;
@@ -323,10 +832,106 @@ class VMapSystem {
         return ((uint64_t)mapId << 32) | ((uint64_t)x << 16) | (uint64_t)y;
     }
 
+    // Tile under (x, y), loaded (and its BVH built) on first use. Null if there is no
+    // valid tile file. Must not be called with tileMutex held.
+    std::shared_ptr<VMParser::WorldModel> GetTile(int mapId, float x, float y, TileResidencyPtr* residency = nullptr) {
+        int tx = (int)(32 - (x / 533.33333f));
+        int ty = (int)(32 - (y / 533.33333f));
+
+        uint64_t tid = Pack(mapId, tx, ty);
+
+        // Load if missing
+        std::shared_ptr<VMParser::WorldModel> tile;
+        TileResidencyPtr loaded;
+        {
+            std::lock_guard<std::mutex> lock(tileMutex);
+            auto found = loadedTiles.find(tid);
+            if (found == loadedTiles.end()) {
+                g_TileResidency.RecordMiss(TILE_CACHE_VMAP);
+
+                char buf[64];
+                sprintf(buf, "%04u_%02d_%02d.vmtile", mapId, ty, tx);
+
+                LoadedTile& entry = loadedTiles[tid];
+                std::shared_ptr<VMParser::WorldModel> m = std::make_shared<VMParser::WorldModel>();
+                if (m->readFile(basePath + buf)) {
+                    entry.model = m;
+                    entry.residency = g_TileResidency.Add(TILE_CACHE_VMAP, tid, mapId, x, y, m->memoryBytes());
+                }
+                tile = entry.model;
+                loaded = entry.residency;
+                if (residency) *residency = entry.residency;
+            }
+            else {
+                g_TileResidency.Touch(found->second.residency);
+                tile = found->second.model;
+                if (residency) *residency = found->second.residency;
+            }
+        }
+
+        // Outside tileMutex: our evictor takes it
+        if (loaded) g_TileResidency.Trim(TILE_CACHE_MASK_VMAP, loaded);
+        return tile;
+    }
+
+    const std::map<uint32_t, VMParser::ModelSpawn>& GetSpawns(int mapId) {
+        std::lock_guard<std::mutex> lock(spawnMutex);
+        auto found = spawnIndex.find(mapId);
+        if (found != spawnIndex.end()) return found->second;
+
+        std::map<uint32_t, VMParser::ModelSpawn>& spawns = spawnIndex[mapId];
+        if (!VMParser::ReadSpawnIndex(modelPath + "dir_bin", mapId, spawns)) {
+            g_Logger.Log("Exact mode: can't read " + modelPath + "dir_bin, using instance boxes");
+        }
+        return spawns;
+    }
+
+    // Looks up the model of every instance in the tile, once. Instances without one
+    // (not in dir_bin, model file missing) keep the box test.
+    void AttachModels(int mapId, VMParser::WorldModel& tile, const TileResidencyPtr& residency) {
+        std::call_once(tile.placementsOnce, [&]() {
+            const std::map<uint32_t, VMParser::ModelSpawn>& spawns = GetSpawns(mapId);
+            tile.placements.resize(tile.instances.size());
+
+            int attached = 0;
+            for (size_t i = 0; i < tile.instances.size(); ++i) {
+                auto spawn = spawns.find(tile.instances[i].id);
+                if (spawn == spawns.end()) continue;
+                std::shared_ptr<const VMParser::CollisionModel> model = modelCache.Acquire(spawn->second.name);
+                if (!model) continue;
+                tile.placements[i].set(spawn->second, std::move(model));
+                attached++;
+            }
+
+            // Models are shared between tiles and counted by none of them
+            g_TileResidency.AddBytes(residency, tile.placements.capacity() * sizeof(VMParser::ModelPlacement));
+
+            if (DEBUG_VMAP) {
+                char msg[256];
+                sprintf(msg, "Exact mode: %s has geometry for %d of %zu instances",
+                    tile.filename.c_str(), attached, tile.instances.size());
+                g_Logger.Log(msg);
+            }
+        });
+    }
+
 public:
-    void Init(const std::string& path) {
+    // path: assembled .vmtile files. buildingsPath: the extractor's Buildings/ output
+    // (dir_bin and raw models) that exact checks read their geometry from.
+    void Init(const std::string& path, const std::string& buildingsPath) {
         basePath = path;
-        g_Logger.Log("Initialized with path: " + basePath);
+        modelPath = buildingsPath;
+        modelCache.Init(buildingsPath);
+        g_Logger.Log("Initialized with path: " + basePath + " (models: " + modelPath + ")");
+
+        g_TileResidency.SetEvictor(TILE_CACHE_VMAP, [this](uint64_t key) { return EvictTile(key); });
+    }
+
+    // Residency manager evictor
+    bool EvictTile(uint64_t key) {
+        std::lock_guard<std::mutex> lock(tileMutex);
+        loadedTiles.erase(key);
+        return true;
     }
 
     ~VMapSystem() {
@@ -340,7 +945,10 @@ public:
         }
     }
 
-    bool Check(int mapId, float x1, float y1, float z1, float x2, float y2, float z2) {
+    // Box mode tests the instance bounds and skips segments above 50 and obstacles far
+    // below them. Exact mode tests the triangles of each instance whose box is hit, with
+    // neither shortcut; instances without model geometry fall back to their box.
+    bool Check(int mapId, float x1, float y1, float z1, float x2, float y2, float z2, bool exact = false) {
         totalChecks++;
 
         Vector3 start(x1, y1, z1);
@@ -351,7 +959,7 @@ public:
         float midZ = (z1 + z2) * 0.5f;
 
         // High altitude check
-        if (midZ > 50.0f) {
+        if (!exact && midZ > 50.0f) {
             totalSkipped++;
             if (DEBUG_VMAP && (totalSkipped % 100 == 1)) { // Log every 100th skip
                 g_Logger.LogClearance(midZ, 50.0f);
@@ -367,95 +975,186 @@ public:
         }
 
         Ray ray(start, dirVec.normalize());
-
-        int tx = (int)(32 - (x1 / 533.33333f));
-        int ty = (int)(32 - (y1 / 533.33333f));
-
-        uint64_t tid = Pack(mapId, tx, ty);
-
-        // Load if missing
-        if (loadedTiles.find(tid) == loadedTiles.end()) {
-            char buf[64];
-            sprintf(buf, "%04u_%02d_%02d.vmtile", mapId, ty, tx);
-
-            VMParser::WorldModel* m = new VMParser::WorldModel();
-            if (m->readFile(basePath + buf)) {
-                loadedTiles[tid] = m;
-            }
-            else {
-                delete m;
-                loadedTiles[tid] = nullptr;
+        float minTopZ = exact ? -std::numeric_limits<float>::max() : midZ - VMAP_FLIGHT_CLEARANCE;
+
+        // Walk the ADT tiles under the segment in order, testing each tile's instances
+        // only over the part of the segment inside it: nearest instances first, stopping
+        // at the first hit, obstacles far below culled with their whole subtree.
+        // An instance spanning several tiles is listed in each of them; the first tile
+        // that reaches its box tests it against the whole segment and later ones skip it.
+        const float gridSize = 533.33333f;
+        int cellX = (int)std::floor(x1 / gridSize), cellY = (int)std::floor(y1 / gridSize);
+        int endCellX = (int)std::floor(x2 / gridSize), endCellY = (int)std::floor(y2 / gridSize);
+        bool multiTile = cellX != endCellX || cellY != endCellY;
+
+        Vector3 invDir = ray.invDirection();
+        int stepX = ray.direction.x < 0 ? -1 : 1;
+        int stepY = ray.direction.y < 0 ? -1 : 1;
+        float nextX = ((cellX + (stepX > 0 ? 1 : 0)) * gridSize - x1) * invDir.x;
+        float nextY = ((cellY + (stepY > 0 ? 1 : 0)) * gridSize - y1) * invDir.y;
+        float deltaX = gridSize * std::abs(invDir.x);
+        float deltaY = gridSize * std::abs(invDir.y);
+
+        std::unordered_set<uint32_t> tested;
+        std::shared_ptr<VMParser::WorldModel> hitTile;
+        int hitIdx = -1;
+        size_t instancesSeen = 0;
+        int tilesSeen = 0;
+        float tEnter = 0.0f;
+
+        while (true) {
+            float tExit = std::min(std::min(nextX, nextY), dist);
+
+            TileResidencyPtr residency;
+            std::shared_ptr<VMParser::WorldModel> tile = GetTile(mapId, (cellX + 0.5f) * gridSize, (cellY + 0.5f) * gridSize, &residency);
+            if (tile) {
+                if (exact) AttachModels(mapId, *tile, residency);
+                instancesSeen += tile->instances.size();
+                tilesSeen++;
+
+                Ray part(ray.origin + ray.direction * tEnter, ray.direction);
+                hitIdx = tile->bvh.intersect(part, tExit - tEnter, minTopZ, [&](uint32_t inst) {
+                    if (multiTile && !tested.insert(tile->instances[inst].id).second) return false;
+                    if (!exact || !tile->placements[inst].model) return true;
+                    return tile->placements[inst].intersectRay(ray, dist);
+                });
+                if (hitIdx >= 0) {
+                    hitTile = tile;
+                    break;
+                }
             }
-        }
-
-        VMParser::WorldModel* tile = loadedTiles[tid];
-        if (!tile) {
-            g_Logger.LogCheck(mapId, x1, y1, z1, x2, y2, z2, false);
-            return false;
-        }
-
-        // Check Collision
-        bool hitDetected = false;
-        int hitCount = 0;
 
-        for (size_t i = 0; i < tile->instances.size(); ++i) {
-            const auto& inst = tile->instances[i];
-
-            // Skip obstacles far below
-            if (inst.bound.hi.z < midZ - VMAP_FLIGHT_CLEARANCE) {
-                continue;
+            if (tExit >= dist || (cellX == endCellX && cellY == endCellY)) break;
+            if (nextX < nextY) {
+                cellX += stepX;
+                nextX += deltaX;
             }
-
-            if (RayAABBIntersection(ray, inst.bound, dist, (int)i)) {
-                hitDetected = true;
-                hitCount++;
-
-                if (DEBUG_VMAP) {
-                    char msg[512];
-                    Vector3 center = inst.bound.center();
-                    Vector3 size = inst.bound.size();
-                    sprintf(msg, "  ├─ Collision #%d: Instance #%zu | Center=%s | Size=%.1fx%.1fx%.1f | Flags=0x%X",
-                        hitCount, i, center.toString().c_str(),
-                        size.x, size.y, size.z, inst.flags);
-                    g_Logger.Log(msg);
-                }
+            else {
+                cellY += stepY;
+                nextY += deltaY;
             }
+            tEnter = tExit;
         }
+        bool hitDetected = hitIdx >= 0;
 
         if (hitDetected) {
             totalHits++;
             g_Logger.LogCheck(mapId, x1, y1, z1, x2, y2, z2, true);
 
             if (DEBUG_VMAP) {
-                char msg[128];
-                sprintf(msg, "  └─ Total collisions: %d obstacle(s) detected", hitCount);
+                const auto& inst = hitTile->instances[hitIdx];
+                char msg[512];
+                Vector3 center = inst.bound.center();
+                Vector3 size = inst.bound.size();
+                sprintf(msg, "  └─ Collision: Instance #%d | Center=%s | Size=%.1fx%.1fx%.1f | Flags=0x%X",
+                    hitIdx, center.toString().c_str(),
+                    size.x, size.y, size.z, inst.flags);
                 g_Logger.Log(msg);
             }
         }
         else {
             g_Logger.LogCheck(mapId, x1, y1, z1, x2, y2, z2, false);
 
-            if (DEBUG_VMAP && tile->instances.size() > 0) {
+            if (DEBUG_VMAP && instancesSeen > 0) {
                 char msg[128];
-                sprintf(msg, "  └─ No collision (checked %zu instances)", tile->instances.size());
+                sprintf(msg, "  └─ No collision (%zu instances in %d tiles)", instancesSeen, tilesSeen);
                 g_Logger.Log(msg);
             }
         }
 
         return hitDetected;
     }
+
+    // Times the instance BVH against the old linear scan on the tile under (x, y) with
+    // rayCount random segments (5-200 yd) starting anywhere inside the tile's instance
+    // bounds, and checks both agree.
+    // Logs the result; returns the speedup (linear time / BVH time), 0 if there is no tile.
+    float Benchmark(int mapId, float x, float y, int rayCount) {
+        std::shared_ptr<VMParser::WorldModel> tile = GetTile(mapId, x, y);
+        if (!tile || tile->instances.empty() || rayCount <= 0) return 0.0f;
+
+        const std::vector<VMParser::ModelInstance>& instances = tile->instances;
+        const AABox& box = tile->bvh.nodes[0].bound;
+        Vector3 size = box.size();
+        std::mt19937 rng(12345);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        struct Segment { Vector3 start; Vector3 dir; float dist; float minTopZ; };
+        std::vector<Segment> segments(rayCount);
+        for (Segment& seg : segments) {
+            seg.start = box.lo + Vector3(size.x * unit(rng), size.y * unit(rng), size.z * unit(rng));
+            float yaw = unit(rng) * 6.2831853f, pitch = (unit(rng) - 0.5f) * 1.0f;
+            seg.dir = Vector3(std::cos(yaw) * std::cos(pitch), std::sin(yaw) * std::cos(pitch), std::sin(pitch));
+            seg.dist = 5.0f + unit(rng) * 195.0f;
+            seg.minTopZ = seg.start.z + seg.dir.z * seg.dist * 0.5f - VMAP_FLIGHT_CLEARANCE;
+        }
+
+        std::vector<char> linearHits(rayCount), bvhHits(rayCount);
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < rayCount; ++r) {
+            const Segment& seg = segments[r];
+            Vector3 invDir = Ray(seg.start, seg.dir).invDirection();
+            char hit = 0;
+            for (const auto& inst : instances) {
+                if (inst.bound.hi.z < seg.minTopZ) continue;
+                if (RayHitsBox(seg.start, invDir, inst.bound, seg.dist)) {
+                    hit = 1;
+                    break;
+                }
+            }
+            linearHits[r] = hit;
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        for (int r = 0; r < rayCount; ++r) {
+            const Segment& seg = segments[r];
+            bvhHits[r] = tile->bvh.intersect(Ray(seg.start, seg.dir), seg.dist, seg.minTopZ,
+                [](uint32_t) { return true; }) >= 0;
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        int hits = 0, mismatches = 0;
+        for (int r = 0; r < rayCount; ++r) {
+            hits += linearHits[r];
+            if (linearHits[r] != bvhHits[r]) mismatches++;
+        }
+
+        double linearUs = std::chrono::duration<double, std::micro>(t1 - t0).count() / rayCount;
+        double bvhUs = std::chrono::duration<double, std::micro>(t2 - t1).count() / rayCount;
+        float speedup = bvhUs > 0.0 ? (float)(linearUs / bvhUs) : 0.0f;
+
+        char msg[384];
+        sprintf(msg, "[BENCH] %s: %zu instances, %zu BVH nodes | %d rays, %d hits | linear %.3f us/ray, BVH %.3f us/ray (%.1fx) | %d mismatches",
+            tile->filename.c_str(), instances.size(), tile->bvh.nodes.size(), rayCount, hits,
+            linearUs, bvhUs, speedup, mismatches);
+        g_Logger.Log(msg);
+        return speedup;
+    }
 };
 
 VMapSystem g_Sys;
 
 // ---------------------------------------------------------
-// 4. EXPORT
+// 6. EXPORT
 // ---------------------------------------------------------
+static VMapSystem& VMapSys() {
+    static bool initialized = (g_Sys.Init("C:/SMM/data/vmaps/", "C:/SMM/data/Buildings/"), true);
+    (void)initialized;
+    return g_Sys;
+}
+
 extern "C" __declspec(dllexport) bool CheckVMapLine(int mapId, float x1, float y1, float z1, float x2, float y2, float z2) {
-    static bool init = false;
-    if (!init) {
-        g_Sys.Init("C:/SMM/data/vmaps/");
-        init = true;
-    }
-    return g_Sys.Check(mapId, x1, y1, z1, x2, y2, z2);
+    return VMapSys().Check(mapId, x1, y1, z1, x2, y2, z2);
+}
+
+// Triangle-accurate CheckVMapLine (see VMapSystem::Check). Slower; meant for indoor/outdoor
+// line of sight around big WMOs, where instance boxes block far too much.
+extern "C" __declspec(dllexport) bool CheckVMapLineExact(int mapId, float x1, float y1, float z1, float x2, float y2, float z2) {
+    return VMapSys().Check(mapId, x1, y1, z1, x2, y2, z2, true);
+}
+
+// Instance BVH vs linear scan on the tile under (x, y); see VMapSystem::Benchmark.
+// Meant for the city tiles that are the collision hot spot, e.g. Stormwind (0, -8900, 560).
+extern "C" __declspec(dllexport) float BenchmarkVMapTile(int mapId, float x, float y, int rayCount) {
+    return VMapSys().Benchmark(mapId, x, y, rayCount);
 }
\ No newline at end of file
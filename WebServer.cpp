@@ -68,6 +68,7 @@ static std::string s_navMeshCache;
 static std::string s_navMeshCacheKey;
 
 static std::string SerializeNavMeshGeometry() {
+    NavMeshReadLock meshLock(g_NavMeshMutex);
     if (!globalNavMesh.mesh) {
         return "{\"key\":\"\",\"verts\":[],\"indices\":[],\"areas\":[]}";
     }
@@ -452,6 +453,13 @@ void WebServer::LoadConfig() {
                     autoLoad = false;
                 }
             }
+            else if (line.find("TileCacheBudgetMB=") != std::string::npos) {
+                try {
+                    size_t mb = std::stoull(line.substr(line.find('=') + 1));
+                    if (mb > 0) g_TileResidency.SetBudget(mb * 1024 * 1024);
+                }
+                catch (...) {}
+            }
         }
     }
 }
@@ -459,6 +467,7 @@ void WebServer::LoadConfig() {
 void WebServer::SaveConfig() {
     std::ofstream f("C:\\SMM\\WebConfig.ini");
     f << "AutoLoad=" << (autoLoad ? "1" : "0") << "\n";
+    f << "TileCacheBudgetMB=" << (g_TileResidency.GetBudget() / (1024 * 1024)) << "\n";
 }
 
 // =============================================================
@@ -754,6 +763,37 @@ void WebServer::HandleClient(unsigned __int64 clientSocketRaw) {
             }
         }
     }
+    // --- TILE CACHE ENDPOINTS ---
+    else if (requestData.find("GET /api/tilecache") != std::string::npos) {
+        json j;
+        j["budget"] = g_TileResidency.GetBudget();
+        j["bytes"] = g_TileResidency.GetTotalBytes();
+        for (int kind = 0; kind < TILE_CACHE_KINDS; ++kind) {
+            TileCacheStats stats = g_TileResidency.GetStats((TileCacheKind)kind);
+            j[TileCacheKindName(kind)] = {
+                { "tiles", stats.tiles }, { "bytes", stats.bytes },
+                { "hits", stats.hits }, { "misses", stats.misses }, { "evictions", stats.evictions }
+            };
+        }
+        responseBody = j.dump();
+        contentType = "application/json";
+    }
+    else if (requestData.find("POST /api/tilecache/budget") != std::string::npos) {
+        size_t bodyPos = requestData.find("\r\n\r\n");
+        if (bodyPos != std::string::npos) {
+            std::string body = requestData.substr(bodyPos + 4);
+            try {
+                auto j = json::parse(body);
+                size_t mb = j["budgetMB"];
+                if (mb == 0) throw std::invalid_argument("budgetMB");
+                g_TileResidency.SetBudget(mb * 1024 * 1024);
+                SaveConfig();
+                responseBody = "{\"status\":\"ok\"}";
+            }
+            catch (...) { responseBody = "{\"status\":\"error\"}"; }
+            contentType = "application/json";
+        }
+    }
     else if (requestData.find("GET /api/navmesh") != std::string::npos) {
         std::lock_guard<std::mutex> lock(g_EntityMutex);
         responseBody = SerializeNavMeshGeometry();
@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+"""
+FMap Tile Converter (v1 -> v2)
+Rewrites byte-packed "PAMF" v1 .fmtile files into the v2 layout that
+FMapLoader.cpp maps read-only and queries in place (no parsing on load).
+
+v2 layout (little-endian):
+    0   char[4]   magic "PAMF"
+    4   uint32    version (2)
+    8   uint32    cell count (160 * 160)
+    12  uint32    total layer count
+    16  float     cell size X
+    20  float     cell size Y
+    24  uint32    byte offset of the cell offset index
+    28  uint32    byte offset of the layer array
+    32  uint32[cells + 1]   offset index (layers of cell i = [idx[i], idx[i+1]))
+    ..  (uint16 floor, uint16 ceiling)[layer count]
+
+Usage:
+    # Convert every tile in the fmaps directory in place
+    python convert_fmtile.py
+
+    # Convert one map into a separate directory
+    python convert_fmtile.py --map 571 --out D:/fmaps_v2
+
+    # Different source directory
+    python convert_fmtile.py --dir D:/fmaps
+"""
+
+import struct
+import os
+import glob
+import argparse
+import sys
+
+# ---------------------------------------------------------------------------
+# Constants
+# ---------------------------------------------------------------------------
+
+FMAPS_DIR = "C:\\SMM\\data\\fmaps"
+
+FMAP_MAGIC = b"PAMF"
+FMAP_VERSION_V2 = 2
+GRID_WIDTH = 160
+GRID_HEIGHT = 160
+TOTAL_CELLS = GRID_WIDTH * GRID_HEIGHT
+
+V1_HEADER_SIZE = 24
+V2_HEADER_SIZE = 32
+LAYER_SIZE = 4  # uint16 floor + uint16 ceiling
+
+
+# ---------------------------------------------------------------------------
+# Conversion
+# ---------------------------------------------------------------------------
+
+def read_v1(data, path):
+    """Returns (cell_size_x, cell_size_y, offsets, layer_bytes) or None."""
+    if len(data) < V1_HEADER_SIZE or data[0:4] != FMAP_MAGIC:
+        print(f"  [SKIP] {path}: bad header")
+        return None
+
+    cell_size_x, cell_size_y = struct.unpack_from("<ff", data, 16)
+
+    offsets = [0] * (TOTAL_CELLS + 1)
+    layers = bytearray()
+    pos = V1_HEADER_SIZE
+    total = 0
+
+    for i in range(TOTAL_CELLS):
+        if pos >= len(data):
+            print(f"  [SKIP] {path}: truncated at cell {i}")
+            return None
+        count = data[pos]
+        pos += 1
+        end = pos + count * LAYER_SIZE
+        if end > len(data):
+            print(f"  [SKIP] {path}: truncated layers at cell {i}")
+            return None
+        layers += data[pos:end]
+        pos = end
+        total += count
+        offsets[i + 1] = total
+
+    return cell_size_x, cell_size_y, offsets, bytes(layers)
+
+
+def build_v2(cell_size_x, cell_size_y, offsets, layer_bytes):
+    layer_count = offsets[-1]
+    index_offset = V2_HEADER_SIZE
+    layers_offset = index_offset + (TOTAL_CELLS + 1) * 4
+
+    header = FMAP_MAGIC + struct.pack("<IIIffII",
+                                      FMAP_VERSION_V2, TOTAL_CELLS, layer_count,
+                                      cell_size_x, cell_size_y,
+                                      index_offset, layers_offset)
+    index = struct.pack(f"<{TOTAL_CELLS + 1}I", *offsets)
+    return header + index + layer_bytes
+
+
+def convert_file(src, dst):
+    with open(src, "rb") as f:
+        data = f.read()
+
+    if len(data) >= 8 and data[0:4] == FMAP_MAGIC:
+        version = struct.unpack_from("<I", data, 4)[0]
+        if version == FMAP_VERSION_V2:
+            if src != dst:
+                with open(dst, "wb") as f:
+                    f.write(data)
+            return "already v2"
+
+    parsed = read_v1(data, src)
+    if parsed is None:
+        return None
+
+    out = build_v2(*parsed)
+
+    # Write next to the destination first so an interrupted run never leaves a
+    # half-written tile behind
+    tmp = dst + ".tmp"
+    with open(tmp, "wb") as f:
+        f.write(out)
+    os.replace(tmp, dst)
+    return f"{len(data)} -> {len(out)} bytes, {parsed[2][-1]} layers"
+
+
+# ---------------------------------------------------------------------------
+# Entry point
+# ---------------------------------------------------------------------------
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Convert SMM .fmtile files from v1 to the mappable v2 layout",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__
+    )
+    parser.add_argument("--dir", type=str, default=FMAPS_DIR, help="Path to fmaps directory")
+    parser.add_argument("--out", type=str, default=None,
+                        help="Output directory (default: convert in place)")
+    parser.add_argument("--map", type=int, default=None, help="Only convert this map ID")
+    args = parser.parse_args()
+
+    pattern = f"{args.map:04d}_*.fmtile" if args.map is not None else "*.fmtile"
+    files = sorted(glob.glob(os.path.join(args.dir, pattern)))
+    if not files:
+        print(f"No .fmtile files matching {pattern} in {args.dir}")
+        sys.exit(1)
+
+    out_dir = args.out or args.dir
+    os.makedirs(out_dir, exist_ok=True)
+
+    converted = 0
+    failed = 0
+    for src in files:
+        dst = os.path.join(out_dir, os.path.basename(src))
+        result = convert_file(src, dst)
+        if result is None:
+            failed += 1
+            continue
+        converted += 1
+        print(f"  {os.path.basename(src)}: {result}")
+
+    print()
+    print(f"Converted {converted} tile(s), {failed} failed")
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -20,6 +20,8 @@
 #include "SimpleKeyboardClient.h"
 #include "GameGui.h"
 #include "PathFinding2.h"
+#include "TilePrefetcher.h"
+#include "PathService.h"
 #include "Movement.h"
 #include "Vector.h"
 #include "Database.h"
@@ -862,6 +864,9 @@ void MainThread(HMODULE hModule) {
         ConsoleInput console(kbd);
         bool wasPaused = false;
 
+        // NavMesh reads from this loop don't queue behind PathService workers waiting to load tiles
+        g_NavMeshMutex.MarkTickThread();
+
         // --- OUTER LOOP: RE-INITIALIZATION LOOP ---
         // This loop allows the bot to "Restart" finding the process if "GAME_REBOOTED" is received
         while (g_IsRunning) {
@@ -1202,7 +1207,27 @@ void MainThread(HMODULE hModule) {
                                             // while the Agent is modifying/resizing them (e.g. during pathfinding).
                                             std::lock_guard<std::mutex> lock(g_EntityMutex);
                                             agent.Tick();
+
+                                            // Keep tile memory under budget, never evicting around the rest of the route.
+                                            // NavMesh tiles are only dropped when nobody is searching the mesh;
+                                            // the tick never waits for a PathService worker.
+                                            std::vector<Vector3> pinnedPoints = { g_GameState->player.position };
+                                            const auto& route = g_GameState->globalState.activePath;
+                                            for (size_t i = (size_t)(std::max)(g_GameState->globalState.activeIndex, 0); i < route.size(); ++i) {
+                                                pinnedPoints.push_back(route[i].pos);
+                                            }
+                                            g_TileResidency.PinRoute(TILE_PIN_ROUTE, g_GameState->globalState.mapId, pinnedPoints);
+                                            NavMeshWriteLock meshLock(g_NavMeshMutex, std::try_to_lock);
+                                            if (meshLock.owns_lock()) globalNavMesh.EvictFarTiles(g_GameState->globalState.mapId, pinnedPoints);
+                                            g_TileResidency.Trim(meshLock.owns_lock() ? TILE_CACHE_MASK_ALL : (TILE_CACHE_MASK_FMAP | TILE_CACHE_MASK_VMAP));
                                         }
+
+                                        // Read ahead FMap/NavMesh tiles along the route on the prefetch thread
+                                        g_TilePrefetcher.Update(g_GameState->globalState.mapId,
+                                            g_GameState->globalState.activePath,
+                                            g_GameState->globalState.activeIndex,
+                                            g_GameState->player.position,
+                                            g_GameState->player.rotation);
                                     }
                                     else {
                                         Sleep(100); // Sleep longer when idle to save CPU
@@ -1212,6 +1237,8 @@ void MainThread(HMODULE hModule) {
                                     g_LogFile << "Agent Tick Fail" << std::endl;
                                 }
                             }
+                            // Write out what the PathService workers logged since last frame
+                            FlushPathLog();
                             Sleep(10); // Prevent high CPU usage
                         }
                         catch (const std::exception& e) {
@@ -1229,6 +1256,10 @@ void MainThread(HMODULE hModule) {
             // Safety sleep between re-init attempts
             Sleep(2000);
         }
+        g_PathService.Stop();
+        g_SegmentPlanner.Stop();
+        g_TilePrefetcher.Stop();
+        FlushPathLog();
         g_LogFile << "Exiting" << std::endl;
         RaiseException(0xDEADBEEF, 0, 0, nullptr); // Forcibly exit all threads (including GUI)
     }